@@ -60,20 +60,24 @@ INCLUDEPATH += ./../common/src
 
 SOURCES += \
     src/GenericBridgePlatform.cpp \
+    ../../common/src/CommandDispatcher.cpp \
     ../../common/src/ITransportServer.cpp \
     ../../common/src/TCPSocketServer.cpp \
     ../../common/src/TCPSocketClient.cpp \
+    ../../common/src/TransportFrameParser.cpp \
     src/main.cpp \
     src/QABridge.cpp \
 # SOURCES
 
 HEADERS += \
     src/GenericBridgePlatform.hpp \
+    ../../common/src/CommandDispatcher.hpp \
     src/IBridgePlatform.hpp \
     ../../common/src/ITransportClient.hpp \
     ../../common/src/ITransportServer.hpp \
     ../../common/src/TCPSocketClient.hpp \
     ../../common/src/TCPSocketServer.hpp \
+    ../../common/src/TransportFrameParser.hpp \
     src/QABridge.hpp \
 # HEADERS
 
@@ -1,11 +1,11 @@
 // Copyright (c) 2019-2020 Open Mobile Platform LLC.
 #include "GenericBridgePlatform.hpp"
+#include "CommandDispatcher.hpp"
 #include "ITransportServer.hpp"
 #include "QABridge.hpp"
 
 #include <ITransportClient.hpp>
 #include <QDateTime>
-#include <QEventLoop>
 #include <QFile>
 #include <QFileInfo>
 #include <QJsonDocument>
@@ -16,11 +16,19 @@
 #include <QTimer>
 #include <QVariantList>
 
+#include <algorithm>
+
 #include <QDebug>
 
+namespace {
+
+const int c_appReplyTimeout = 30000;
+const int c_appConnectTimeout = 30000;
+
+}
+
 GenericBridgePlatform::GenericBridgePlatform(QObject *parent)
     : IBridgePlatform(parent)
-    , m_connectLoop(new QEventLoop(this))
 {
     qDebug()
         << Q_FUNC_INFO;
@@ -38,28 +46,135 @@ void GenericBridgePlatform::appConnect(ITransportClient *socket, const QString &
         m_socketAppName.remove(socket);
     }
 
-    if (m_applicationSocket.value(appName) == nullptr && m_connectLoop->isRunning()) {
-        m_connectLoop->quit();
-    }
-
     m_applicationSocket.insert(appName, socket);
+
+    const QList<QPointer<ITransportClient>> waiters = m_launchWaiters.take(appName);
+    for (ITransportClient *client : waiters) {
+        if (client) {
+            socketReply(client, QString());
+        }
+    }
 }
 
 void GenericBridgePlatform::appReply(ITransportClient *socket, const QByteArray &cmd)
 {
     qDebug()
         << Q_FUNC_INFO
-        << socket << cmd;
+        << socket << cmd.size();
 
-    const QString appName = m_applicationSocket.key(socket);
-    if (appName.isEmpty()) {
+    const QJsonObject reply = QJsonDocument::fromJson(cmd).object();
+
+    const QJsonValue replyId = reply.value(QStringLiteral("id"));
+    const int requestId = pendingRequestId(socket, replyId);
+    if (!m_pendingReplies.contains(requestId)) {
         qWarning()
             << Q_FUNC_INFO
-            << "No app for" << socket;
+            << "Unexpected reply from" << socket << replyId;
+        return;
+    }
+
+    completeAppReply(requestId, reply);
+}
+
+void GenericBridgePlatform::appReplyPart(ITransportClient *socket, const QByteArray &part, bool first, bool last)
+{
+    qDebug()
+        << Q_FUNC_INFO
+        << socket << part.size() << first << last;
+
+    if (first) {
+        // header frame with status, id and offset of the value in the reply
+        const QJsonObject header = QJsonDocument::fromJson(part).object();
+        const int requestId = pendingRequestId(socket, header.value(QStringLiteral("id")));
+        if (!header.contains(QStringLiteral("status")) || !m_pendingReplies.contains(requestId)) {
+            qWarning()
+                << Q_FUNC_INFO
+                << "Unexpected reply from" << socket << header.value(QStringLiteral("id"));
+            m_streamingReplies.insert(socket, -1);
+            return;
+        }
+        m_streamingReplies.insert(socket, requestId);
+
+        PendingAppReply &pending = m_pendingReplies[requestId];
+        pending.streaming = true;
+        if (pending.forward && pending.client && m_queuedReplies.contains(pending.client)) {
+            // client is receiving another reply in parts, this one waits joined
+            pending.forward = false;
+        }
+        if (pending.forward && pending.client && pending.client->isOpen()) {
+            m_queuedReplies.insert(pending.client, QList<QByteArray>());
+
+            // same reply start with the client's own id
+            QJsonObject clientHeader;
+            clientHeader.insert(QStringLiteral("status"), header.value(QStringLiteral("status")));
+            if (!pending.clientRequestId.isUndefined()) {
+                clientHeader.insert(QStringLiteral("id"), pending.clientRequestId);
+            }
+            QByteArray clientPart = QJsonDocument(clientHeader).toJson(QJsonDocument::Compact);
+            clientPart.chop(1);
+            clientPart.append(",\"value\":");
+            pending.client->writeFramePart(clientPart, false);
+            pending.skip = header.value(QStringLiteral("valueOffset")).toInt();
+        }
+        if (pending.timer) {
+            pending.timer->start(c_appReplyTimeout);
+        }
+        return;
+    }
+
+    const int requestId = m_streamingReplies.value(socket, -1);
+    if (last) {
+        m_streamingReplies.remove(socket);
+    }
+    if (!m_pendingReplies.contains(requestId)) {
+        return;
+    }
+
+    PendingAppReply &pending = m_pendingReplies[requestId];
+    if (pending.forward) {
+        // engine's own reply start is replaced with the one written to the client
+        const int skip = qMin(pending.skip, part.size());
+        pending.skip -= skip;
+        if (pending.client && pending.client->isOpen()) {
+            pending.client->writeFramePart(part.mid(skip), last);
+        }
+    } else if (pending.parts.size() + part.size() > TransportFrameParser::maxMessageSize()) {
+        qWarning()
+            << Q_FUNC_INFO
+            << "Reply size limit exceeded:" << requestId;
+        m_streamingReplies.remove(socket);
+        pending.streaming = false;
+        pending.parts.clear();
+        completeAppReply(requestId, QJsonObject());
+        return;
+    } else {
+        pending.parts.append(part);
+    }
+
+    if (!last) {
+        // timeout applies to the gaps between parts
+        if (pending.timer) {
+            pending.timer->start(c_appReplyTimeout);
+        }
+        return;
+    }
+
+    if (pending.forward) {
+        const PendingAppReply complete = m_pendingReplies.take(requestId);
+        if (complete.timer) {
+            complete.timer->deleteLater();
+        }
+        if (complete.client) {
+            complete.client->flush();
+            writeQueuedReplies(complete.client);
+        }
         return;
     }
 
-    emit applicationReply(socket, appName, cmd);
+    const QByteArray reply = pending.parts;
+    pending.streaming = false;
+    pending.parts.clear();
+    completeAppReply(requestId, QJsonDocument::fromJson(reply).object());
 }
 
 void GenericBridgePlatform::removeClient(ITransportClient *socket)
@@ -79,14 +194,30 @@ void GenericBridgePlatform::removeClient(ITransportClient *socket)
             << Q_FUNC_INFO
             << "removing application socket:" << appName << m_applicationSocket.take(appName);
     }
+
+    m_streamingReplies.remove(socket);
+    m_queuedReplies.remove(socket);
+
+    QList<int> lostReplies;
+    for (auto it = m_pendingReplies.constBegin(); it != m_pendingReplies.constEnd(); ++it) {
+        if (it.value().appSocket == socket) {
+            lostReplies.append(it.key());
+        }
+    }
+    std::sort(lostReplies.begin(), lostReplies.end());
+    for (int requestId : lostReplies) {
+        completeAppReply(requestId, QJsonObject());
+    }
 }
 
 void GenericBridgePlatform::execute(ITransportClient *socket, const QString &methodName, const QVariantList &params)
 {
-    bool handled = false;
-    bool success = QABridge::metaInvoke(socket, this, methodName, params, &handled);
+    QString error;
+    const CommandDispatcher::Result result = CommandDispatcher::invoke(socket, this, methodName, params, &error);
 
-    if (!handled || !success) {
+    if (result == CommandDispatcher::InvalidArguments) {
+        socketReply(socket, error, 400);
+    } else if (result != CommandDispatcher::Invoked) {
         qWarning()
             << Q_FUNC_INFO
             << methodName << "not handled!";
@@ -139,20 +270,33 @@ void GenericBridgePlatform::appDisconnectCommand(ITransportClient *socket, bool
         << Q_FUNC_INFO
         << socket << autoLaunch << appName;
 
-    if (m_applicationSocket.value(appName) != nullptr) {
-        if (autoLaunch) {
-            sendToAppSocket(appName, actionData(QStringLiteral("closeApp"), QStringList({appName})));
+    QPointer<ITransportClient> client(socket);
+    auto disconnectClient = [this, client]() {
+        if (!client) {
+            return;
         }
 
+        socketReply(client, QString());
+
+        if (client->isOpen()) {
+            client->close();
+        }
+    };
+
+    if (m_applicationSocket.value(appName) != nullptr) {
         m_socketAppName.remove(socket);
         qDebug() << Q_FUNC_INFO << appName;
-    }
-
-    socketReply(socket, QString());
 
-    if (socket->isOpen()) {
-        socket->close();
+        if (autoLaunch) {
+            sendToAppSocket(appName, actionData(QStringLiteral("closeApp"), QStringList({appName})),
+                            [disconnectClient](const QByteArray &) {
+                disconnectClient();
+            });
+            return;
+        }
     }
+
+    disconnectClient();
 }
 
 void GenericBridgePlatform::startActivityCommand(ITransportClient *socket, const QString &appName, const QVariantList &params)
@@ -194,12 +338,10 @@ void GenericBridgePlatform::activateAppCommand(ITransportClient *socket, const Q
     qDebug() << Q_FUNC_INFO << appName << appId;
     if (m_applicationSocket.value(appName, nullptr) == nullptr) {
         lauchAppPlatform(socket);
+        socketReply(socket, QString());
     } else {
         forwardToApp(socket, QStringLiteral("activateApp"), QStringList({appName}));
     }
-
-    socketReply(socket, QString());
-
 }
 
 void GenericBridgePlatform::terminateAppCommand(ITransportClient *socket, const QString &appId)
@@ -341,22 +483,9 @@ void GenericBridgePlatform::launchAppCommand(ITransportClient *socket)
         qDebug()
             << Q_FUNC_INFO
             << appName;
+        waitForAppConnect(socket, appName);
         lauchAppPlatform(socket);
-
-        QTimer maxTimer;
-        connect(&maxTimer, &QTimer::timeout, m_connectLoop, &QEventLoop::quit);
-        maxTimer.start(30000);
-        qDebug()
-            << Q_FUNC_INFO
-            << "Starting eventloop connect";
-        m_connectLoop->exec();
-        qDebug()
-            << Q_FUNC_INFO
-            << "Exiting eventloop connect";
-        maxTimer.stop();
     }
-
-    socketReply(socket, QString());
 }
 
 void GenericBridgePlatform::closeAppCommand(ITransportClient *socket)
@@ -367,25 +496,26 @@ void GenericBridgePlatform::closeAppCommand(ITransportClient *socket)
 
     const QString appName = m_socketAppName.value(socket);
     if (m_applicationSocket.value(appName) != nullptr) {
-        QByteArray appReplyData = sendToAppSocket(appName, actionData(QStringLiteral("closeApp"), QStringList({appName})));
-        qDebug() << Q_FUNC_INFO << appReplyData;
-
-        QEventLoop loop;
-        QTimer timer;
-        int counter = 0;
-        connect(&timer, &QTimer::timeout, [this, &loop, &counter, appName]() {
-            if (!m_applicationSocket.contains(appName)) {
-                loop.quit();
-            } else {
+        QPointer<ITransportClient> client(socket);
+        sendToAppSocket(appName, actionData(QStringLiteral("closeApp"), QStringList({appName})),
+                        [this, client, appName](const QByteArray &appReplyData) {
+            qDebug() << Q_FUNC_INFO << appReplyData;
+
+            // give the application some time to disconnect
+            QTimer *timer = new QTimer(this);
+            int counter = 0;
+            connect(timer, &QTimer::timeout, this, [this, timer, client, appName, counter]() mutable {
                 counter++;
-                if (counter > 10) {
-                    loop.quit();
+                if (m_applicationSocket.contains(appName) && counter <= 10) {
+                    return;
                 }
-            }
+                timer->deleteLater();
+                if (client) {
+                    socketReply(client, QString());
+                }
+            });
+            timer->start(500);
         });
-        timer.start(500);
-        loop.exec();
-        socketReply(socket, QString());
     } else {
         qWarning()
             << Q_FUNC_INFO
@@ -455,7 +585,13 @@ void GenericBridgePlatform::getSettingsCommand(ITransportClient *socket)
     qDebug()
         << Q_FUNC_INFO
         << socket;
-    socketReply(socket, QString());
+
+    // settings are kept by the engine, updateSettings is forwarded as unknown command
+    if (!m_socketAppName.contains(socket)) {
+        socketReply(socket, QVariantMap());
+        return;
+    }
+    forwardToApp(socket, QStringLiteral("getSettings"), QVariantList());
 }
 
 void GenericBridgePlatform::getContextsCommand(ITransportClient *socket)
@@ -616,8 +752,33 @@ void GenericBridgePlatform::socketReply(ITransportClient *socket, const QVariant
         << reply.size()
         << "Reply is:" << reply;
 
-    socket->write(QJsonDocument(reply).toJson(QJsonDocument::Compact));
-    socket->flush();
+    writeReply(socket, QJsonDocument(reply).toJson(QJsonDocument::Compact));
+}
+
+void GenericBridgePlatform::writeReply(ITransportClient *client, const QByteArray &reply)
+{
+    // nothing is written into a reply the client is receiving in parts
+    auto queued = m_queuedReplies.find(client);
+    if (queued != m_queuedReplies.end()) {
+        queued->append(reply);
+        return;
+    }
+
+    client->writeFrame(reply);
+    client->flush();
+}
+
+void GenericBridgePlatform::writeQueuedReplies(ITransportClient *client)
+{
+    const QList<QByteArray> replies = m_queuedReplies.take(client);
+    if (replies.isEmpty() || !client->isOpen()) {
+        return;
+    }
+
+    for (const QByteArray &reply : replies) {
+        client->writeFrame(reply);
+    }
+    client->flush();
 }
 
 void GenericBridgePlatform::forwardToApp(ITransportClient *socket, const QByteArray &data)
@@ -648,17 +809,21 @@ void GenericBridgePlatform::forwardToApp(ITransportClient *socket, const QString
         << Q_FUNC_INFO
         << socket << appName << data;
 
-    QByteArray appReplyData = sendToAppSocket(appName, data);
-    qDebug()
-        << Q_FUNC_INFO
-        << appReplyData;
+    QPointer<ITransportClient> client(socket);
+    sendToAppSocket(appName, data, [this, client](const QByteArray &appReplyData) {
+        qDebug()
+            << Q_FUNC_INFO
+            << client << appReplyData.size();
 
-    socket->write(appReplyData);
-    auto bytes = socket->waitForBytesWritten();
-    qWarning()
-        << Q_FUNC_INFO
-        << "Writing to appium socket:"
-        << bytes;
+        if (!client || !client->isOpen()) {
+            qWarning()
+                << Q_FUNC_INFO
+                << "Appium client is gone, dropping reply";
+            return;
+        }
+
+        writeReply(client, appReplyData);
+    }, socket);
 }
 
 void GenericBridgePlatform::forwardToApp(ITransportClient *socket, const QString &action, const QVariant &params)
@@ -666,83 +831,121 @@ void GenericBridgePlatform::forwardToApp(ITransportClient *socket, const QString
     forwardToApp(socket, actionData(action, params));
 }
 
-QByteArray GenericBridgePlatform::sendToAppSocket(const QString &appName, const QByteArray &data)
+void GenericBridgePlatform::sendToAppSocket(const QString &appName, const QByteArray &data, const AppReplyCallback &callback, ITransportClient *client)
 {
     qDebug()
         << Q_FUNC_INFO
         << appName << data.length();
 
-    QJsonObject reply = {
-        {QStringLiteral("status"), 1},
-        {QStringLiteral("value"), QString()}
-    };
-    QByteArray appReplyData = QJsonDocument(reply).toJson(QJsonDocument::Compact);
-    bool haveData = false;
+    QJsonObject request = QJsonDocument::fromJson(data).object();
+
+    // requests are tagged with bridge-wide ids, client's own id is restored in the reply
+    const int requestId = ++m_lastRequestId;
+    PendingAppReply pending;
+    pending.clientRequestId = request.value(QStringLiteral("id"));
+    pending.callback = callback;
+    pending.forward = client != nullptr;
+    pending.client = client;
 
     ITransportClient *socket = m_applicationSocket.value(appName, nullptr);
-    if (!socket) {
-        qDebug()
+    if (!socket || !socket->isOpen()) {
+        qWarning()
             << Q_FUNC_INFO
-            << "No app socket for" << appName;
+            << "Can't connect to app socket:" << appName << socket;
+        m_pendingReplies.insert(requestId, pending);
+        completeAppReply(requestId, QJsonObject());
+        return;
     }
-    qDebug()
-        << Q_FUNC_INFO
-        << socket;
 
-    if (!socket || !socket->isOpen()) {
+    pending.appSocket = socket;
+    pending.timer = new QTimer(this);
+    pending.timer->setSingleShot(true);
+    connect(pending.timer, &QTimer::timeout, this, [this, requestId]() {
         qWarning()
             << Q_FUNC_INFO
-            << "Can't connect to app socket:" << socket;
-        return appReplyData;
-    }
-
-    QEventLoop loop;
-    QTimer timer;
-    timer.setSingleShot(true);
-    timer.setInterval(30000);
-    connect(&timer, &QTimer::timeout, &loop, &QEventLoop::quit);
-
-    QMetaObject::Connection readyReadConnection = connect(
-        this, &GenericBridgePlatform::applicationReply,
-        [&appReplyData, &loop, &timer, &haveData]
-        (ITransportClient *appSocket, const QString &appName, const QByteArray &data)
-    {
-        if (!haveData) {
-            haveData = true;
-            appReplyData.clear();
+            << "Timeout waiting for reply:" << requestId;
+        completeAppReply(requestId, QJsonObject());
+    });
+    pending.timer->start(c_appReplyTimeout);
+    m_pendingReplies.insert(requestId, pending);
+
+    request.insert(QStringLiteral("id"), requestId);
+    socket->writeFrame(QJsonDocument(request).toJson(QJsonDocument::Compact));
+    socket->flush();
+}
+
+int GenericBridgePlatform::pendingRequestId(ITransportClient *appSocket, const QJsonValue &replyId) const
+{
+    if (replyId.isDouble()) {
+        return replyId.toInt();
+    }
+
+    // engine without request ids, it replies in order
+    int requestId = -1;
+    for (auto it = m_pendingReplies.constBegin(); it != m_pendingReplies.constEnd(); ++it) {
+        if (it.value().appSocket == appSocket && (requestId < 0 || it.key() < requestId)) {
+            requestId = it.key();
         }
-        qDebug()
+    }
+    return requestId;
+}
+
+void GenericBridgePlatform::completeAppReply(int requestId, QJsonObject reply)
+{
+    if (!m_pendingReplies.contains(requestId)) {
+        return;
+    }
+    const PendingAppReply pending = m_pendingReplies.take(requestId);
+    if (pending.timer) {
+        pending.timer->deleteLater();
+    }
+
+    if (pending.streaming && pending.forward) {
+        // client has a part of the reply already, nothing else fits in that message
+        qWarning()
             << Q_FUNC_INFO
-            << "Received bytes from app:" << appName << appSocket;
-        appReplyData.append(data);
-
-        QJsonParseError jsonError;
-        QJsonDocument::fromJson(appReplyData, &jsonError);
-        if (jsonError.error == QJsonParseError::NoError) {
-            loop.quit();
-        } else {
-            timer.start();
+            << "Reply broken off, closing:" << pending.client;
+        if (pending.client) {
+            m_queuedReplies.remove(pending.client);
+            pending.client->close();
         }
+        return;
+    }
 
-    });
+    if (reply.isEmpty()) {
+        reply.insert(QStringLiteral("status"), 1);
+        reply.insert(QStringLiteral("value"), QString());
+    }
 
-    QMetaObject::Connection stateChangedConnection = connect(socket, &ITransportClient::disconnected, this, [&loop, &timer](ITransportClient*) {
-        loop.quit();
-        timer.stop();
-    });
+    if (pending.clientRequestId.isUndefined()) {
+        reply.remove(QStringLiteral("id"));
+    } else {
+        reply.insert(QStringLiteral("id"), pending.clientRequestId);
+    }
 
-    socket->write(data);
-    socket->waitForBytesWritten();
+    pending.callback(QJsonDocument(reply).toJson(QJsonDocument::Compact));
+}
 
-    if (socket->isConnected()) {
-        timer.start();
-        loop.exec();
-    }
+void GenericBridgePlatform::waitForAppConnect(ITransportClient *socket, const QString &appName)
+{
+    QPointer<ITransportClient> client(socket);
+    m_launchWaiters[appName].append(client);
 
-    disconnect(readyReadConnection);
-    disconnect(stateChangedConnection);
+    QTimer::singleShot(c_appConnectTimeout, this, [this, client, appName]() {
+        if (!m_launchWaiters.contains(appName) || !m_launchWaiters[appName].removeOne(client)) {
+            return;
+        }
+        if (m_launchWaiters.value(appName).isEmpty()) {
+            m_launchWaiters.remove(appName);
+        }
 
-    return appReplyData;
+        qWarning()
+            << Q_FUNC_INFO
+            << "App" << appName << "did not connect in time";
+        if (client) {
+            socketReply(client, QString());
+        }
+    });
 }
 
 QByteArray GenericBridgePlatform::actionData(const QString &action, const QVariant &params)
@@ -3,10 +3,14 @@
 
 #include "IBridgePlatform.hpp"
 #include "QABridge.hpp"
+#include <QJsonObject>
 #include <QObject>
+#include <QPointer>
+
+#include <functional>
 
 class QABridge;
-class QEventLoop;
+class QTimer;
 class GenericBridgePlatform : public IBridgePlatform
 {
     Q_OBJECT
@@ -15,8 +19,10 @@ public:
 
     virtual void appConnect(ITransportClient *client, const QString &appName) override;
     virtual void appReply(ITransportClient *client, const QByteArray &cmd) override;
+    virtual void appReplyPart(ITransportClient *client, const QByteArray &part, bool first, bool last) override;
 
     void removeClient(ITransportClient *client) override;
+    void writeReply(ITransportClient *client, const QByteArray &reply) override;
 
 private:
     void execute(ITransportClient *client, const QString &methodName, const QVariantList &paramsArg);
@@ -65,18 +71,47 @@ private slots:
     void forwardToApp(ITransportClient *client, const QByteArray &data);
     void forwardToApp(ITransportClient *client, const QString &appName, const QByteArray &data);
     void forwardToApp(ITransportClient *client, const QString &action, const QVariant &params);
-    QByteArray sendToAppSocket(const QString &appName, const QByteArray &data);
 
 protected:
+    typedef std::function<void(const QByteArray &reply)> AppReplyCallback;
+
+    struct PendingAppReply {
+        ITransportClient *appSocket = nullptr;
+        QJsonValue clientRequestId;
+        QTimer *timer = nullptr;
+        AppReplyCallback callback;
+        // forwarded reply parts are written to the client as they arrive,
+        // others are joined and passed to callback
+        bool forward = false;
+        QPointer<ITransportClient> client;
+        bool streaming = false;
+        // bytes of the engine's reply start not passed to the client yet
+        int skip = 0;
+        QByteArray parts;
+    };
+
+    void sendToAppSocket(const QString &appName, const QByteArray &data, const AppReplyCallback &callback, ITransportClient *client = nullptr);
+    int pendingRequestId(ITransportClient *appSocket, const QJsonValue &replyId) const;
+    void completeAppReply(int requestId, QJsonObject reply);
+    void waitForAppConnect(ITransportClient *client, const QString &appName);
+
     virtual bool lauchAppPlatform(ITransportClient *client) = 0;
     virtual bool lauchAppStandalone(const QString &appName, const QStringList &arguments = {}) = 0;
     void socketReply(ITransportClient *client, const QVariant &value, int status = 0);
+    void writeQueuedReplies(ITransportClient *client);
     QByteArray actionData(const QString &action, const QVariant &params);
 
     QHash<ITransportClient*, QString> m_socketAppName;
     QHash<QString, ITransportClient*> m_applicationSocket;
     QHash<ITransportClient*, QString> m_clientFullPath;
-    QEventLoop *m_connectLoop;
+
+    QHash<int, PendingAppReply> m_pendingReplies;
+    // request of the reply each application socket is sending in parts
+    QHash<ITransportClient*, int> m_streamingReplies;
+    // replies waiting for the end of a reply a client is receiving in parts
+    QHash<ITransportClient*, QList<QByteArray>> m_queuedReplies;
+    int m_lastRequestId = 0;
+    QHash<QString, QList<QPointer<ITransportClient>>> m_launchWaiters;
 
     QABridge *m_bridge = nullptr;
 };
@@ -21,11 +21,11 @@ public:
 
     virtual void appConnect(ITransportClient *client, const QString &appName) = 0;
     virtual void appReply(ITransportClient *client, const QByteArray &cmd) = 0;
+    virtual void appReplyPart(ITransportClient *client, const QByteArray &part, bool first, bool last) = 0;
 
     virtual void removeClient(ITransportClient *client) = 0;
-
-signals:
-    void applicationReply(ITransportClient *client, const QString &appName, const QByteArray &data);
+    // complete reply to an appium client, held back while the client is receiving another one in parts
+    virtual void writeReply(ITransportClient *client, const QByteArray &reply) = 0;
 
 private slots:
     virtual void initializeCommand(ITransportClient *client, const QString &appName) = 0;
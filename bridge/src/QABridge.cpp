@@ -12,6 +12,7 @@
 #include "GenericBridgePlatform.hpp"
 #endif
 
+#include "CommandDispatcher.hpp"
 #include "ITransportClient.hpp"
 #include "TCPSocketServer.hpp"
 
@@ -21,23 +22,11 @@
 #include <QDateTime>
 #include <QDir>
 #include <QFile>
-#include <QMetaMethod>
 #include <QTimer>
 
 #include <QJsonObject>
 #include <QJsonDocument>
 
-namespace {
-
-inline QGenericArgument qVariantToArgument(const QVariant &variant) {
-    if (variant.isValid() && !variant.isNull()) {
-        return QGenericArgument(variant.typeName(), variant.constData());
-    }
-    return QGenericArgument();
-}
-
-}
-
 QABridge::QABridge(QObject *parent)
     : QObject(parent)
 #if defined Q_OS_SAILFISH
@@ -66,56 +55,26 @@ QABridge::QABridge(QObject *parent)
 
     connect(m_socketServer, &ITransportServer::commandReceived,
             this, &QABridge::processCommand);
+    connect(m_socketServer, &ITransportServer::commandPartReceived,
+            this, &QABridge::processCommandPart);
     connect(m_socketServer, &ITransportServer::clientLost,
             this, &QABridge::removeClient);
 }
 
 bool QABridge::metaInvoke(ITransportClient *client, QObject *object, const QString &methodName, const QVariantList &params, bool *implemented)
 {
-    auto mo = object->metaObject();
-    do {
-        for (int i = mo->methodOffset(); i < mo->methodOffset() + mo->methodCount(); i++) {
-            if (mo->method(i).name() == methodName.toLatin1()) {
-                const QMetaMethod method = mo->method(i);
-                QGenericArgument arguments[9] = { QGenericArgument() };
-                for (int i = 0; i < (method.parameterCount() - 1) && params.count() > i; i++) {
-                    if (method.parameterType(i + 1) == QMetaType::QVariant) {
-                        arguments[i] = Q_ARG(QVariant, params[i]);
-                    } else {
-                        arguments[i] = qVariantToArgument(params[i]);
-                    }
-                }
-                qDebug()
-                    << Q_FUNC_INFO
-                    << "found" << methodName
-                    << "in" << mo->className();
-
-                if (implemented) {
-                    *implemented = true;
-                }
-
-                return QMetaObject::invokeMethod(
-                    object,
-                    methodName.toLatin1().constData(),
-                    Qt::DirectConnection,
-                    Q_ARG(ITransportClient*, client),
-                    arguments[0],
-                    arguments[1],
-                    arguments[2],
-                    arguments[3],
-                    arguments[4],
-                    arguments[5],
-                    arguments[6],
-                    arguments[7],
-                    arguments[8]);
-            }
-        }
-    } while ((mo = mo->superClass()));
+    const CommandDispatcher::Result result = CommandDispatcher::invoke(client, object, methodName, params);
+    if (result != CommandDispatcher::NotImplemented) {
+        qDebug()
+            << Q_FUNC_INFO
+            << "found" << methodName
+            << "in" << object->metaObject()->className();
+    }
 
     if (implemented) {
-        *implemented = false;
+        *implemented = result != CommandDispatcher::NotImplemented;
     }
-    return false;
+    return result == CommandDispatcher::Invoked;
 }
 
 void QABridge::start()
@@ -163,7 +122,7 @@ void QABridge::processCommand(ITransportClient *client, const QByteArray &cmd)
     }
 
     const QString action = object.value(QStringLiteral("action")).toVariant().toString();
-    const QVariantList params = object.value(QStringLiteral("params")).toVariant().toList();
+    const QJsonArray params = object.value(QStringLiteral("params")).toArray();
 
     if (!processAppiumCommand(client, action, params)) {
         qDebug()
@@ -179,6 +138,16 @@ void QABridge::processCommand(ITransportClient *client, const QByteArray &cmd)
     }
 }
 
+void QABridge::processCommandPart(ITransportClient *client, const QByteArray &part, bool first, bool last)
+{
+    qDebug()
+        << Q_FUNC_INFO
+        << client << part.size() << first << last;
+
+    // only long replies of applications are sent in parts
+    m_platform->appReplyPart(client, part, first, last);
+}
+
 void QABridge::processAppConnectCommand(ITransportClient *client, const QJsonObject &app)
 {
     qDebug()
@@ -189,48 +158,22 @@ void QABridge::processAppConnectCommand(ITransportClient *client, const QJsonObj
     m_platform->appConnect(client, appName);
 }
 
-bool QABridge::processAppiumCommand(ITransportClient *client, const QString &action, const QVariantList &params)
+bool QABridge::processAppiumCommand(ITransportClient *client, const QString &action, const QJsonArray &params)
 {
     const QString methodName = QStringLiteral("%1Command").arg(action);
     qDebug()
         << Q_FUNC_INFO
         << client << methodName << params;
 
-    auto mo = m_platform->metaObject();
-    do {
-        for (int i = mo->methodOffset(); i < mo->methodOffset() + mo->methodCount(); i++) {
-            if (mo->method(i).name() == methodName.toLatin1()) {
-                const QMetaMethod method = mo->method(i);
-                QGenericArgument arguments[9] = { QGenericArgument() };
-                for (int i = 0; i < (method.parameterCount() - 1) && params.count() > i; i++) {
-                    if (method.parameterType(i + 1) == QMetaType::QVariant) {
-                        arguments[i] = Q_ARG(QVariant, params[i]);
-                    } else {
-                        arguments[i] = qVariantToArgument(params[i]);
-                    }
-                }
-                qDebug()
-                    << Q_FUNC_INFO
-                    << "found" << methodName
-                    << "in" << mo->className();
-
-                return QMetaObject::invokeMethod(
-                    m_platform,
-                    methodName.toLatin1().constData(),
-                    Qt::DirectConnection,
-                    Q_ARG(ITransportClient*, client),
-                    arguments[0],
-                    arguments[1],
-                    arguments[2],
-                    arguments[3],
-                    arguments[4],
-                    arguments[5],
-                    arguments[6],
-                    arguments[7],
-                    arguments[8]);
-            }
-        }
-    } while ((mo = mo->superClass()));
-
-    return false;
+    QString error;
+    const CommandDispatcher::Result result = CommandDispatcher::invoke(client, m_platform, methodName, params, &error);
+    if (result == CommandDispatcher::InvalidArguments) {
+        QJsonObject reply;
+        reply.insert(QStringLiteral("status"), 400);
+        reply.insert(QStringLiteral("value"), error);
+
+        m_platform->writeReply(client, QJsonDocument(reply).toJson(QJsonDocument::Compact));
+    }
+
+    return result != CommandDispatcher::NotImplemented;
 }
@@ -2,6 +2,7 @@
 #ifndef QASERVICE_HPP
 #define QASERVICE_HPP
 
+#include <QJsonArray>
 #include <QObject>
 #include <QVariant>
 
@@ -21,8 +22,9 @@ public slots:
     void removeClient(ITransportClient *client);
 
     void processCommand(ITransportClient *client, const QByteArray &cmd);
+    void processCommandPart(ITransportClient *client, const QByteArray &part, bool first, bool last);
     void processAppConnectCommand(ITransportClient *client, const QJsonObject &app);
-    bool processAppiumCommand(ITransportClient *client, const QString &action, const QVariantList &params);
+    bool processAppiumCommand(ITransportClient *client, const QString &action, const QJsonArray &params);
 
 private:
     IBridgePlatform *m_platform = nullptr;
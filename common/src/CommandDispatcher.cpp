@@ -0,0 +1,333 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#include "CommandDispatcher.hpp"
+#include "ITransportClient.hpp"
+
+#include <QDebug>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QStringList>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+const int c_maxArguments = 9;
+
+// typed storage for one argument, only the member of declared type is used
+struct ArgumentStorage {
+    QString string;
+    QStringList stringList;
+    QVariant variant;
+    QVariantList list;
+    QVariantMap map;
+    double number = 0;
+    int integer = 0;
+    bool boolean = false;
+};
+
+QString typeName(const QJsonValue &value)
+{
+    switch (value.type()) {
+    case QJsonValue::Null:
+        return QStringLiteral("null");
+    case QJsonValue::Bool:
+        return QStringLiteral("bool");
+    case QJsonValue::Double:
+        return QStringLiteral("number");
+    case QJsonValue::String:
+        return QStringLiteral("string");
+    case QJsonValue::Array:
+        return QStringLiteral("array");
+    case QJsonValue::Object:
+        return QStringLiteral("object");
+    default:
+        return QStringLiteral("undefined");
+    }
+}
+
+// int parameters take only numbers without fraction, toInt() would silently turn 1.5 into 0
+bool isInteger(double number)
+{
+    return std::trunc(number) == number
+        && number >= std::numeric_limits<int>::min()
+        && number <= std::numeric_limits<int>::max();
+}
+
+bool isNumeric(int type)
+{
+    switch (type) {
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong:
+    case QMetaType::Double:
+    case QMetaType::Float:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool accepts(int type, const QJsonValue &value)
+{
+    if (type == QMetaType::QVariant || value.isNull() || value.isUndefined()) {
+        return true;
+    }
+
+    switch (type) {
+    case QMetaType::QString:
+        return value.isString();
+    case QMetaType::Double:
+        return value.isDouble();
+    case QMetaType::Int:
+        return value.isDouble() && isInteger(value.toDouble());
+    case QMetaType::Bool:
+        return value.isBool();
+    case QMetaType::QVariantList:
+        return value.isArray();
+    case QMetaType::QStringList:
+        if (!value.isArray()) {
+            return false;
+        }
+        for (const QJsonValue &item : value.toArray()) {
+            if (!item.isString()) {
+                return false;
+            }
+        }
+        return true;
+    case QMetaType::QVariantMap:
+        return value.isObject();
+    default:
+        return false;
+    }
+}
+
+bool accepts(int type, const QVariant &value)
+{
+    if (type == QMetaType::QVariant || value.userType() == type || value.isNull()) {
+        return true;
+    }
+    if (!isNumeric(type) || !isNumeric(value.userType()) || !value.canConvert(type)) {
+        return false;
+    }
+    return type != QMetaType::Int || isInteger(value.toDouble());
+}
+
+QString typeName(const QVariant &value)
+{
+    return QString::fromLatin1(value.typeName());
+}
+
+QGenericArgument marshal(int type, const QJsonValue &value, ArgumentStorage *storage)
+{
+    const bool null = value.isNull() || value.isUndefined();
+
+    switch (type) {
+    case QMetaType::QVariant:
+        storage->variant = value.toVariant();
+        return Q_ARG(QVariant, storage->variant);
+    case QMetaType::QString:
+        storage->string = value.toString();
+        return Q_ARG(QString, storage->string);
+    case QMetaType::Double:
+        storage->number = value.toDouble();
+        return Q_ARG(double, storage->number);
+    case QMetaType::Int:
+        storage->integer = value.toInt();
+        return Q_ARG(int, storage->integer);
+    case QMetaType::Bool:
+        storage->boolean = value.toBool();
+        return Q_ARG(bool, storage->boolean);
+    case QMetaType::QVariantList:
+        if (!null) {
+            storage->list = value.toArray().toVariantList();
+        }
+        return Q_ARG(QVariantList, storage->list);
+    case QMetaType::QStringList:
+        for (const QJsonValue &item : value.toArray()) {
+            storage->stringList.append(item.toString());
+        }
+        return Q_ARG(QStringList, storage->stringList);
+    case QMetaType::QVariantMap:
+        if (!null) {
+            storage->map = value.toObject().toVariantMap();
+        }
+        return Q_ARG(QVariantMap, storage->map);
+    default:
+        // only reachable for null, default constructed value of declared type
+        storage->variant = QVariant(type, nullptr);
+        return QGenericArgument(storage->variant.typeName(), storage->variant.constData());
+    }
+}
+
+QGenericArgument marshal(int type, const QVariant &value, ArgumentStorage *storage)
+{
+    if (type == QMetaType::QVariant) {
+        return Q_ARG(QVariant, value);
+    }
+    if (value.userType() == type) {
+        return QGenericArgument(value.typeName(), value.constData());
+    }
+    if (!value.isNull() && isNumeric(value.userType())) {
+        // other numeric types are converted, accepts() has checked the value fits
+        storage->variant = value;
+        storage->variant.convert(type);
+        return QGenericArgument(storage->variant.typeName(), storage->variant.constData());
+    }
+    // null parameter, pass default constructed value of declared type
+    storage->variant = QVariant(type, nullptr);
+    return QGenericArgument(storage->variant.typeName(), storage->variant.constData());
+}
+
+template <typename Params>
+bool invokeCommand(const QMetaMethod &method, const QVector<int> &parameterTypes, QObject *object, ITransportClient *client, const Params &params)
+{
+    ArgumentStorage storage[c_maxArguments];
+    QGenericArgument arguments[c_maxArguments];
+    for (int i = 0; i < parameterTypes.size(); i++) {
+        arguments[i] = marshal(parameterTypes.at(i), params.at(i), &storage[i]);
+    }
+
+    return method.invoke(
+        object,
+        Qt::DirectConnection,
+        Q_ARG(ITransportClient*, client),
+        arguments[0],
+        arguments[1],
+        arguments[2],
+        arguments[3],
+        arguments[4],
+        arguments[5],
+        arguments[6],
+        arguments[7],
+        arguments[8]);
+}
+
+}
+
+template <typename Params>
+const CommandDispatcher::Command *CommandDispatcher::resolve(const QVector<Command> &overloads, const Params &params, const QString &methodName, QString *error)
+{
+    QString mismatch;
+    for (const Command &command : overloads) {
+        if (command.parameterTypes.size() > params.size()) {
+            if (mismatch.isEmpty()) {
+                mismatch = QStringLiteral("expected %1 arguments, got %2")
+                        .arg(command.parameterTypes.size())
+                        .arg(params.size());
+            }
+            continue;
+        }
+
+        bool accepted = true;
+        for (int i = 0; i < command.parameterTypes.size(); i++) {
+            const int type = command.parameterTypes.at(i);
+            if (accepts(type, params.at(i))) {
+                continue;
+            }
+            if (mismatch.isEmpty()) {
+                mismatch = QStringLiteral("argument %1 should be %2, got %3")
+                        .arg(i + 1)
+                        .arg(QString::fromLatin1(QMetaType::typeName(type)))
+                        .arg(typeName(params.at(i)));
+            }
+            accepted = false;
+            break;
+        }
+
+        if (accepted) {
+            return &command;
+        }
+    }
+
+    const QString message = QStringLiteral("%1: %2").arg(methodName, mismatch);
+    qWarning()
+        << Q_FUNC_INFO
+        << message;
+    if (error) {
+        *error = message;
+    }
+    return nullptr;
+}
+
+CommandDispatcher::Result CommandDispatcher::invoke(ITransportClient *client, QObject *object, const QString &methodName, const QJsonArray &params, QString *error)
+{
+    const QVector<Command> *commands = overloads(object, methodName);
+    if (!commands) {
+        return NotImplemented;
+    }
+
+    const Command *command = resolve(*commands, params, methodName, error);
+    if (!command) {
+        return InvalidArguments;
+    }
+
+    invokeCommand(command->method, command->parameterTypes, object, client, params);
+    return Invoked;
+}
+
+CommandDispatcher::Result CommandDispatcher::invoke(ITransportClient *client, QObject *object, const QString &methodName, const QVariantList &params, QString *error)
+{
+    const QVector<Command> *commands = overloads(object, methodName);
+    if (!commands) {
+        return NotImplemented;
+    }
+
+    const Command *command = resolve(*commands, params, methodName, error);
+    if (!command) {
+        return InvalidArguments;
+    }
+
+    invokeCommand(command->method, command->parameterTypes, object, client, params);
+    return Invoked;
+}
+
+const CommandDispatcher::CommandTable &CommandDispatcher::commandTable(const QMetaObject *metaObject)
+{
+    static QHash<const QMetaObject*, CommandTable> s_commandTables;
+
+    auto it = s_commandTables.constFind(metaObject);
+    if (it != s_commandTables.constEnd()) {
+        return it.value();
+    }
+
+    CommandTable table;
+    // walk from the most derived class, so subclass methods are preferred
+    for (int i = metaObject->methodCount() - 1; i >= 0; i--) {
+        const QMetaMethod method = metaObject->method(i);
+        if (method.parameterCount() < 1 || method.parameterCount() > c_maxArguments + 1) {
+            continue;
+        }
+        if (method.parameterTypes().first() != QByteArrayLiteral("ITransportClient*")) {
+            continue;
+        }
+
+        Command command;
+        command.method = method;
+        for (int p = 1; p < method.parameterCount(); p++) {
+            command.parameterTypes.append(method.parameterType(p));
+        }
+        table[method.name()].append(command);
+    }
+
+    // overloads consuming more parameters first, clones with default arguments last
+    for (QVector<Command> &overloads : table) {
+        std::stable_sort(overloads.begin(), overloads.end(), [](const Command &a, const Command &b) {
+            return a.parameterTypes.size() > b.parameterTypes.size();
+        });
+    }
+
+    return s_commandTables.insert(metaObject, table).value();
+}
+
+const QVector<CommandDispatcher::Command> *CommandDispatcher::overloads(QObject *object, const QString &methodName)
+{
+    const CommandTable &table = commandTable(object->metaObject());
+    const auto it = table.constFind(methodName.toLatin1());
+    if (it == table.constEnd()) {
+        return nullptr;
+    }
+    return &it.value();
+}
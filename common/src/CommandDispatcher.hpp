@@ -0,0 +1,38 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QJsonArray>
+#include <QMetaMethod>
+#include <QVariant>
+#include <QVector>
+
+class ITransportClient;
+class CommandDispatcher
+{
+public:
+    enum Result {
+        Invoked,
+        NotImplemented,
+        InvalidArguments,
+    };
+
+    // parameters as received from the wire, converted straight into declared types
+    static Result invoke(ITransportClient *client, QObject *object, const QString &methodName, const QJsonArray &params, QString *error = nullptr);
+    // parameters built inside the process
+    static Result invoke(ITransportClient *client, QObject *object, const QString &methodName, const QVariantList &params, QString *error = nullptr);
+
+private:
+    struct Command {
+        QMetaMethod method;
+        QVector<int> parameterTypes; // without leading ITransportClient*
+    };
+    typedef QHash<QByteArray, QVector<Command>> CommandTable;
+
+    static const CommandTable &commandTable(const QMetaObject *metaObject);
+    static const QVector<Command> *overloads(QObject *object, const QString &methodName);
+
+    template <typename Params>
+    static const Command *resolve(const QVector<Command> &overloads, const Params &params, const QString &methodName, QString *error);
+};
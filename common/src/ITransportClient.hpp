@@ -1,6 +1,8 @@
 // Copyright (c) 2019-2020 Open Mobile Platform LLC.
 #pragma once
 
+#include "TransportFrameParser.hpp"
+
 #include <QObject>
 
 class ITransportClient : public QObject
@@ -22,8 +24,44 @@ public:
     virtual bool waitForBytesWritten(int msecs = 30000) = 0;
     virtual bool waitForReadyRead(int msecs = 30000) = 0;
 
+    TransportFrameParser *frameParser() { return &m_frameParser; }
+
+    // writes one message using the framing negotiated for this connection
+    qint64 writeFrame(const QByteArray &data)
+    {
+        if (m_frameParser.writeMode() == TransportFrameParser::LengthPrefixedMode) {
+            write(TransportFrameParser::frameHeader(data.size()));
+        }
+        return write(data);
+    }
+
+    // writes a part of one message, receiver joins the parts up to the last one,
+    // so long replies are sent while they are produced instead of built as a whole.
+    // Legacy receivers scan JSON documents and need no part boundaries at all
+    virtual qint64 writeFramePart(const QByteArray &data, bool last)
+    {
+        if (m_frameParser.writeMode() == TransportFrameParser::LengthPrefixedMode) {
+            write(TransportFrameParser::frameHeader(data.size(), !last));
+        }
+        return write(data);
+    }
+
+    // writes the header of a message sent in parts, a small JSON object describing
+    // the message. Receivers handling parts get it as the first part, joined messages
+    // do not contain it. Legacy receivers get the message only
+    virtual qint64 writeFrameHeader(const QByteArray &data)
+    {
+        if (m_frameParser.writeMode() != TransportFrameParser::LengthPrefixedMode) {
+            return 0;
+        }
+        return write(TransportFrameParser::headerFrame(data));
+    }
+
 signals:
     void readyRead(ITransportClient *client);
     void connected(ITransportClient *client);
     void disconnected(ITransportClient *client);
+
+private:
+    TransportFrameParser m_frameParser;
 };
@@ -3,8 +3,6 @@
 #include "ITransportServer.hpp"
 
 #include <QDebug>
-#include <QJsonDocument>
-#include <QJsonParseError>
 
 void ITransportServer::registerClient(ITransportClient *client)
 {
@@ -19,40 +17,61 @@ void ITransportServer::readData(ITransportClient *client)
         << Q_FUNC_INFO
         << client << bytes;
 
-    static QByteArray requestData;
-    requestData.append(client->readAll());
-    qDebug().noquote() << requestData;
+    TransportFrameParser *parser = client->frameParser();
+    parser->append(client->readAll());
 
-    requestData.replace("}{", "}\n{"); // workaround packets join
-
-    const QList<QByteArray> commands = requestData.split('\n');
-    qDebug()
-        << Q_FUNC_INFO
-        << "Commands count:" << commands.length();
+    QByteArray cmd;
+    bool first = false;
+    bool last = false;
+    while (parser->takeFramePart(&cmd, &first, &last)) {
+        if (!first || !last) {
+            qDebug()
+                << Q_FUNC_INFO
+                << "Command part:" << cmd.size() << first << last;
 
-    requestData.clear();
-    for (const QByteArray &cmd : commands) {
-        if (cmd.isEmpty()) {
+            emit commandPartReceived(client, cmd, first, last);
             continue;
         }
-        qDebug()
-            << Q_FUNC_INFO
-            << "Command:";
-        qDebug().noquote() << cmd;
 
-        QJsonParseError error;
-        QJsonDocument::fromJson(cmd, &error);
-        if (error.error != QJsonParseError::NoError) {
+        if (parser->frameCount() == 1 && TransportFrameParser::isHandshake(cmd)) {
             qDebug()
                 << Q_FUNC_INFO
-                << "Partial data, waiting for more";
-            qDebug().noquote() << error.errorString();
+                << "Switching to length-prefixed framing:" << client;
+
+            // acknowledge with legacy framing, everything written after it is length-prefixed
+            client->write(TransportFrameParser::handshake());
+            client->flush();
+            parser->setWriteMode(TransportFrameParser::LengthPrefixedMode);
+            // deferred peers do not wait for the acknowledgement and confirm the switch later
+            if (!TransportFrameParser::isDeferredHandshake(cmd)) {
+                parser->setMode(TransportFrameParser::LengthPrefixedMode);
+            }
+            continue;
+        }
 
-            requestData = cmd;
-            break;
+        if (parser->mode() == TransportFrameParser::JsonMode
+                && parser->writeMode() == TransportFrameParser::LengthPrefixedMode
+                && TransportFrameParser::isHandshake(cmd)) {
+            qDebug()
+                << Q_FUNC_INFO
+                << "Deferred framing switch confirmed:" << client;
+            parser->setMode(TransportFrameParser::LengthPrefixedMode);
+            continue;
         }
 
+        qDebug()
+            << Q_FUNC_INFO
+            << "Command:" << cmd.size();
+        qDebug().noquote() << cmd;
+
         emit commandReceived(client, cmd);
     }
 
+    if (parser->hasError()) {
+        qWarning()
+            << Q_FUNC_INFO
+            << "Message size limit exceeded, closing:" << client;
+        parser->clear();
+        client->close();
+    }
 }
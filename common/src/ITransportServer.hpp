@@ -20,6 +20,8 @@ public slots:
 
 signals:
     void commandReceived(ITransportClient *client, const QByteArray &cmd);
+    // message sent in several parts, parts are not joined
+    void commandPartReceived(ITransportClient *client, const QByteArray &part, bool first, bool last);
     void clientLost(ITransportClient *client);
 
 private:
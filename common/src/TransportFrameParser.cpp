@@ -0,0 +1,280 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#include "TransportFrameParser.hpp"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtEndian>
+
+namespace {
+
+const int c_headerSize = sizeof(quint32);
+const quint32 c_partialFlag = 0x80000000;
+const quint32 c_headerFlag = 0x40000000;
+// no command or reply comes close to it, larger sizes mean a broken or hostile peer
+const int c_maxMessageSize = 64 * 1024 * 1024;
+const int c_handshakeMaxSize = 64;
+
+}
+
+TransportFrameParser::Mode TransportFrameParser::mode() const
+{
+    return m_mode;
+}
+
+void TransportFrameParser::setMode(TransportFrameParser::Mode mode)
+{
+    m_mode = mode;
+
+    m_scanPosition = m_frameStart;
+    m_depth = 0;
+    m_inString = false;
+    m_escaped = false;
+}
+
+TransportFrameParser::Mode TransportFrameParser::writeMode() const
+{
+    return m_writeMode;
+}
+
+void TransportFrameParser::setWriteMode(TransportFrameParser::Mode mode)
+{
+    m_writeMode = mode;
+}
+
+void TransportFrameParser::append(const QByteArray &data)
+{
+    if (m_frameStart > 0) {
+        m_buffer.remove(0, m_frameStart);
+        m_scanPosition -= m_frameStart;
+        m_frameStart = 0;
+    }
+    m_buffer.append(data);
+}
+
+bool TransportFrameParser::takeFrame(QByteArray *frame)
+{
+    if (m_error) {
+        return false;
+    }
+    if (m_mode == LengthPrefixedMode) {
+        return takeLengthPrefixedFrame(frame);
+    }
+    return takeJsonFrame(frame);
+}
+
+bool TransportFrameParser::takeFramePart(QByteArray *part, bool *first, bool *last)
+{
+    if (m_error) {
+        return false;
+    }
+    if (m_mode != LengthPrefixedMode) {
+        *first = true;
+        *last = true;
+        return takeJsonFrame(part);
+    }
+
+    // parts are not kept, so only each of them is limited
+    bool header = false;
+    if (!takeLengthPrefixedPart(part, last, &header, c_maxMessageSize)) {
+        return false;
+    }
+    *first = !m_inMessage;
+    m_inMessage = !*last;
+    return true;
+}
+
+quint64 TransportFrameParser::frameCount() const
+{
+    return m_frameCount;
+}
+
+bool TransportFrameParser::hasError() const
+{
+    return m_error;
+}
+
+void TransportFrameParser::clear()
+{
+    m_buffer.clear();
+    m_parts.clear();
+    m_inMessage = false;
+    m_error = false;
+    m_frameStart = 0;
+    m_scanPosition = 0;
+    m_depth = 0;
+    m_inString = false;
+    m_escaped = false;
+}
+
+int TransportFrameParser::maxMessageSize()
+{
+    return c_maxMessageSize;
+}
+
+QByteArray TransportFrameParser::frameHeader(int size, bool partial)
+{
+    QByteArray header(c_headerSize, Qt::Uninitialized);
+    qToBigEndian<quint32>(partial ? quint32(size) | c_partialFlag : quint32(size), reinterpret_cast<uchar*>(header.data()));
+    return header;
+}
+
+QByteArray TransportFrameParser::headerFrame(const QByteArray &data)
+{
+    QByteArray frame(c_headerSize, Qt::Uninitialized);
+    qToBigEndian<quint32>(quint32(data.size()) | c_headerFlag, reinterpret_cast<uchar*>(frame.data()));
+    frame.append(data);
+    return frame;
+}
+
+QByteArray TransportFrameParser::handshake()
+{
+    return QByteArrayLiteral("{\"framing\":\"length\"}");
+}
+
+QByteArray TransportFrameParser::deferredHandshake()
+{
+    return QByteArrayLiteral("{\"framing\":\"length\",\"deferred\":true}");
+}
+
+bool TransportFrameParser::isHandshake(const QByteArray &frame)
+{
+    if (frame.size() > c_handshakeMaxSize) {
+        return false;
+    }
+    const QJsonObject object = QJsonDocument::fromJson(frame).object();
+    return object.value(QStringLiteral("framing")).toString() == QLatin1String("length");
+}
+
+bool TransportFrameParser::isDeferredHandshake(const QByteArray &frame)
+{
+    if (!isHandshake(frame)) {
+        return false;
+    }
+    return QJsonDocument::fromJson(frame).object().value(QStringLiteral("deferred")).toBool();
+}
+
+bool TransportFrameParser::takeJsonFrame(QByteArray *frame)
+{
+    const char *data = m_buffer.constData();
+    const int size = m_buffer.size();
+
+    int position = m_scanPosition;
+    while (position < size) {
+        const char c = data[position++];
+
+        if (m_depth == 0) {
+            // skip separators and garbage between documents
+            if (c == '{' || c == '[') {
+                m_frameStart = position - 1;
+                m_depth = 1;
+            } else {
+                m_frameStart = position;
+            }
+            continue;
+        }
+
+        if (m_inString) {
+            if (m_escaped) {
+                m_escaped = false;
+            } else if (c == '\\') {
+                m_escaped = true;
+            } else if (c == '"') {
+                m_inString = false;
+            }
+            continue;
+        }
+
+        switch (c) {
+        case '"':
+            m_inString = true;
+            break;
+        case '{':
+        case '[':
+            m_depth++;
+            break;
+        case '}':
+        case ']':
+            if (--m_depth == 0) {
+                m_scanPosition = position;
+                extractFrame(position, frame);
+                return true;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    m_scanPosition = position;
+    if (m_depth > 0 && size - m_frameStart > c_maxMessageSize) {
+        m_error = true;
+    }
+    return false;
+}
+
+bool TransportFrameParser::takeLengthPrefixedFrame(QByteArray *frame)
+{
+    QByteArray part;
+    bool last = false;
+    bool header = false;
+    while (takeLengthPrefixedPart(&part, &last, &header, c_maxMessageSize - m_parts.size())) {
+        if (header) {
+            continue;
+        }
+        if (!last) {
+            m_parts.append(part);
+            continue;
+        }
+
+        if (m_parts.isEmpty()) {
+            *frame = part;
+        } else {
+            m_parts.append(part);
+            *frame = m_parts;
+            m_parts.clear();
+        }
+        return true;
+    }
+    return false;
+}
+
+bool TransportFrameParser::takeLengthPrefixedPart(QByteArray *part, bool *last, bool *header, int maxSize)
+{
+    if (m_buffer.size() - m_frameStart < c_headerSize) {
+        return false;
+    }
+    const int available = m_buffer.size() - m_frameStart;
+    const quint32 size = qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(m_buffer.constData() + m_frameStart));
+    const quint32 frameSize = size & ~(c_partialFlag | c_headerFlag);
+    if (frameSize > quint32(maxSize)) {
+        m_error = true;
+        return false;
+    }
+    if (quint32(available - c_headerSize) < frameSize) {
+        return false;
+    }
+
+    m_frameStart += c_headerSize;
+    extractFrame(m_frameStart + frameSize, part);
+    m_scanPosition = m_frameStart;
+    // header frame is followed by the parts of its message
+    *header = size & c_headerFlag;
+    *last = !*header && !(size & c_partialFlag);
+    return true;
+}
+
+void TransportFrameParser::extractFrame(int end, QByteArray *frame)
+{
+    m_frameCount++;
+
+    if (m_frameStart == 0 && end == m_buffer.size()) {
+        // whole buffer is a single frame, hand it over without copying
+        *frame = m_buffer;
+        m_buffer.clear();
+        m_scanPosition = 0;
+        return;
+    }
+
+    *frame = m_buffer.mid(m_frameStart, end - m_frameStart);
+    m_frameStart = end;
+}
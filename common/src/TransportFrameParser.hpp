@@ -0,0 +1,69 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#pragma once
+
+#include <QByteArray>
+
+class TransportFrameParser
+{
+public:
+    enum Mode {
+        JsonMode,           // legacy clients: bare JSON documents written back to back
+        LengthPrefixedMode, // 32-bit big endian payload size followed by payload,
+                            // high bit of the size marks a part of a longer message,
+                            // the next one marks a header frame describing the message
+    };
+
+    // framing of received data
+    Mode mode() const;
+    void setMode(Mode mode);
+    // framing of written data, switched separately during a deferred handshake
+    Mode writeMode() const;
+    void setWriteMode(Mode mode);
+
+    void append(const QByteArray &data);
+    // parts of a message are joined, a frame is a complete message
+    bool takeFrame(QByteArray *frame);
+    // parts are handed over as they arrive, so they can be passed on without
+    // keeping the whole message. Complete messages are a single part being
+    // both first and last, a header frame is the first part of its message.
+    // Not to be mixed with takeFrame on one connection
+    bool takeFramePart(QByteArray *part, bool *first, bool *last);
+    quint64 frameCount() const;
+    // set once a message exceeds the size limit, connection should be closed
+    bool hasError() const;
+    void clear();
+
+    static int maxMessageSize();
+    static QByteArray frameHeader(int size, bool partial = false);
+    // complete header frame, takeFrame drops it from the joined message
+    static QByteArray headerFrame(const QByteArray &data);
+    static QByteArray handshake();
+    // sender keeps writing legacy frames after it until it has seen the
+    // acknowledgement, then confirms the switch with a plain handshake
+    static QByteArray deferredHandshake();
+    static bool isHandshake(const QByteArray &frame);
+    static bool isDeferredHandshake(const QByteArray &frame);
+
+private:
+    bool takeJsonFrame(QByteArray *frame);
+    bool takeLengthPrefixedFrame(QByteArray *frame);
+    bool takeLengthPrefixedPart(QByteArray *part, bool *last, bool *header, int maxSize);
+    void extractFrame(int end, QByteArray *frame);
+
+    Mode m_mode = JsonMode;
+    Mode m_writeMode = JsonMode;
+    QByteArray m_buffer;
+    quint64 m_frameCount = 0;
+    bool m_error = false;
+    // leading parts of a message which is not received completely yet
+    QByteArray m_parts;
+    // a part without the last one was handed over by takeFramePart
+    bool m_inMessage = false;
+
+    // incremental JSON scanner state, kept between reads so every byte is scanned once
+    int m_frameStart = 0;
+    int m_scanPosition = 0;
+    int m_depth = 0;
+    bool m_inString = false;
+    bool m_escaped = false;
+};
@@ -4,6 +4,7 @@ QT = core network quick quick-private core-private xmlpatterns
 CONFIG += plugin
 CONFIG += c++11
 CONFIG += link_pkgconfig
+PKGCONFIG += zlib
 
 isEmpty(PROJECT_PACKAGE_VERSION) {
     QAPRELOAD_VERSION = "2.0.0-dev"
@@ -57,25 +58,57 @@ INCLUDEPATH += ../../common/src
 SOURCES += \
     src/engine.cpp \
     src/QAEngine.cpp \
+    src/QABatchClient.cpp \
+    src/QAConditionWatcher.cpp \
+    ../../common/src/CommandDispatcher.cpp \
     ../../common/src/TCPSocketClient.cpp \
+    ../../common/src/TransportFrameParser.cpp \
     src/QAEngineSocketClient.cpp \
     src/GenericEnginePlatform.cpp \
     src/QuickEnginePlatform.cpp \
     src/QAMouseEngine.cpp \
+    src/QAHandleTable.cpp \
     src/QAKeyEngine.cpp \
-    src/QAPendingEvent.cpp
+    src/QAMatcher.cpp \
+    src/QAObjectIndex.cpp \
+    src/QAPendingEvent.cpp \
+    src/QAPropertySchema.cpp \
+    src/QAPropertyWatchRegistry.cpp \
+    src/QAReplyStream.cpp \
+    src/QARequestClient.cpp \
+    src/QASnapshotSearch.cpp \
+    src/QASpatialIndex.cpp \
+    src/QATreeSnapshot.cpp \
+    src/QAWaitClient.cpp \
+    src/QAXPathEvaluator.cpp
 
 HEADERS += \
     src/QAEngine.hpp \
+    src/QABatchClient.hpp \
+    src/QAConditionWatcher.hpp \
+    ../../common/src/CommandDispatcher.hpp \
     ../../common/src/ITransportClient.hpp \
     ../../common/src/TCPSocketClient.hpp \
+    ../../common/src/TransportFrameParser.hpp \
     src/QAEngineSocketClient.hpp \
     src/IEnginePlatform.hpp \
     src/GenericEnginePlatform.hpp \
     src/QuickEnginePlatform.hpp \
     src/QAMouseEngine.hpp \
+    src/QAHandleTable.hpp \
     src/QAKeyEngine.hpp \
-    src/QAPendingEvent.hpp
+    src/QAMatcher.hpp \
+    src/QAObjectIndex.hpp \
+    src/QAPendingEvent.hpp \
+    src/QAPropertySchema.hpp \
+    src/QAPropertyWatchRegistry.hpp \
+    src/QAReplyStream.hpp \
+    src/QARequestClient.hpp \
+    src/QASnapshotSearch.hpp \
+    src/QASpatialIndex.hpp \
+    src/QATreeSnapshot.hpp \
+    src/QAWaitClient.hpp \
+    src/QAXPathEvaluator.hpp
 
 TARGET = qaengine
 TARGETPATH = $$[QT_INSTALL_LIBS]
@@ -1,9 +1,17 @@
 // Copyright (c) 2019-2020 Open Mobile Platform LLC.
 #include "GenericEnginePlatform.hpp"
+#include "CommandDispatcher.hpp"
+#include "QAConditionWatcher.hpp"
 #include "QAEngine.hpp"
 #include "QAKeyEngine.hpp"
 #include "QAMouseEngine.hpp"
 #include "QAPendingEvent.hpp"
+#include "QAPropertyWatchRegistry.hpp"
+#include "QAReplyStream.hpp"
+#include "QARequestClient.hpp"
+#include "QASnapshotSearch.hpp"
+#include "QAWaitClient.hpp"
+#include "QAXPathEvaluator.hpp"
 #include "ITransportClient.hpp"
 
 #include <QClipboard>
@@ -12,7 +20,11 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonValue>
+#include <QPointer>
+#include <QThread>
+#include <QThreadPool>
 #include <QTimer>
+#include <QWindow>
 #include <QMetaMethod>
 #include <QJsonArray>
 #include <QXmlStreamWriter>
@@ -24,15 +36,130 @@
 
 Q_LOGGING_CATEGORY(categoryGenericEnginePlatform, "omp.qaengine.platform.generic", QtWarningMsg)
 
+namespace {
+
+// upper bound for changes not reported by platforms or notify signals
+const int c_treeMaxAge = 1000;
+const int c_waitPollInterval = 100;
+// time given to the window manager to activate the window before input is delivered
+const int c_activationDelay = 100;
+// trees kept for dumpTreeDelta, clients falling further behind get a full resync
+const int c_dumpStatesLimit = 4;
+
+QJsonObject diffProperties(const QJsonObject &before, const QJsonObject &after)
+{
+    QJsonObject diff;
+    for (auto it = after.constBegin(); it != after.constEnd(); ++it) {
+        if (before.value(it.key()) != it.value()) {
+            diff.insert(it.key(), it.value());
+        }
+    }
+    for (auto it = before.constBegin(); it != before.constEnd(); ++it) {
+        if (!after.contains(it.key())) {
+            diff.insert(it.key(), QJsonValue());
+        }
+    }
+    return diff;
+}
+
+}
+
+// Exposes the visual tree to QAXPathEvaluator the same way recursiveDumpXml writes it
+class GenericXPathModel : public QAXPathEvaluator::Model
+{
+public:
+    explicit GenericXPathModel(GenericEnginePlatform *platform)
+        : m_platform(platform)
+    {
+    }
+
+    QObjectList children(QObject *item) override
+    {
+        return m_platform->childrenList(item);
+    }
+
+    QObject *parent(QObject *item) override
+    {
+        return m_platform->getParent(item);
+    }
+
+    QString name(QObject *item) override
+    {
+        return GenericEnginePlatform::getClassName(item);
+    }
+
+    QString text(QObject *item) override
+    {
+        return m_platform->getText(item);
+    }
+
+    bool attribute(QObject *item, const QString &name, QString *value) override
+    {
+        if (name == QLatin1String("id")) {
+            *value = m_platform->markupId(item);
+            return true;
+        }
+        if (name == QLatin1String("abs_x")) {
+            *value = QString::number(m_platform->getAbsPosition(item).x());
+            return true;
+        }
+        if (name == QLatin1String("abs_y")) {
+            *value = QString::number(m_platform->getAbsPosition(item).y());
+            return true;
+        }
+        if (name == QLatin1String("mainTextProperty")) {
+            *value = m_platform->getText(item);
+            return true;
+        }
+
+        const QSharedPointer<const QAPropertySchema> schema = m_platform->propertySchema(item);
+        if (schema->isBlacklisted(name)) {
+            return false;
+        }
+
+        const int propertyIndex = schema->indexOfProperty(name);
+        if (propertyIndex < 0) {
+            return false;
+        }
+        const QVariant property = item->metaObject()->property(propertyIndex).read(item);
+        if (!property.canConvert<QString>()) {
+            return false;
+        }
+        *value = property.toString();
+        return true;
+    }
+
+private:
+    GenericEnginePlatform *m_platform = nullptr;
+};
+
 GenericEnginePlatform::GenericEnginePlatform(QWindow *window)
     : IEnginePlatform(window)
     , m_rootWindow(window)
     , m_mouseEngine(new QAMouseEngine(this))
     , m_keyEngine(new QAKeyEngine(this))
+    , m_snapshotPool(new QThreadPool(this))
+    , m_waitPollTimer(new QTimer(this))
+    , m_propertyWatches(new QAPropertyWatchRegistry(this))
+    , m_activationTimer(new QTimer(this))
 {
     qCDebug(categoryGenericEnginePlatform)
         << Q_FUNC_INFO;
 
+    m_activationTimer->setSingleShot(true);
+    m_activationTimer->setInterval(c_activationDelay);
+    connect(m_activationTimer, &QTimer::timeout, this, &GenericEnginePlatform::flushInput);
+    if (m_rootWindow) {
+        connect(m_rootWindow, &QWindow::activeChanged, this, [this]() {
+            if (!m_rootWindow->isActive()) {
+                m_inputActivated = false;
+            }
+        });
+    }
+
+    m_waitPollTimer->setInterval(c_waitPollInterval);
+    connect(m_waitPollTimer, &QTimer::timeout, this, &GenericEnginePlatform::collectTreeChanges);
+
     connect(m_mouseEngine, &QAMouseEngine::touchEvent, this, &GenericEnginePlatform::onTouchEvent);
     connect(m_mouseEngine, &QAMouseEngine::mouseEvent, this, &GenericEnginePlatform::onMouseEvent);
     connect(m_keyEngine, &QAKeyEngine::triggered, this, &GenericEnginePlatform::onKeyEvent);
@@ -53,6 +180,9 @@ void GenericEnginePlatform::socketReply(ITransportClient *socket, const QVariant
     QJsonObject reply;
     reply.insert(QStringLiteral("status"), status);
     reply.insert(QStringLiteral("value"), QJsonValue::fromVariant(value));
+    if (auto request = qobject_cast<QARequestClient*>(socket)) {
+        reply.insert(QStringLiteral("id"), request->requestId());
+    }
 
     const QByteArray data = QJsonDocument(reply).toJson(QJsonDocument::Compact);
 
@@ -64,22 +194,44 @@ void GenericEnginePlatform::socketReply(ITransportClient *socket, const QVariant
     qCDebug(categoryGenericEnginePlatform).noquote()
         << data;
 
-    socket->write(data);
+    socket->writeFrame(data);
     socket->flush();
 }
 
 void GenericEnginePlatform::elementReply(ITransportClient *socket, QObjectList elements, bool multiple)
 {
+    const bool descriptors = setting(QStringLiteral("elementDescriptors")).toBool();
+    // snapshot searches reply with items of the current snapshot, reuse values it already holds
+    const QATreeSnapshot *snapshot = descriptors && m_snapshot && m_snapshot->generation() == m_treeGeneration
+        ? m_snapshot.data()
+        : nullptr;
+
     QVariantList value;
     for (QObject *item : elements) {
         if (!item) {
             continue;
         }
         const QString uId = uniqueId(item);
-        m_items.insert(uId, item);
 
         QVariantMap element;
         element.insert(QStringLiteral("ELEMENT"), uId);
+        if (descriptors) {
+            const int node = snapshot ? snapshot->indexOf(item) : -1;
+            const QRect geometry = node < 0 ? getAbsGeometry(item) : snapshot->absGeometry(node);
+
+            QVariantMap rect;
+            rect.insert(QStringLiteral("x"), geometry.x());
+            rect.insert(QStringLiteral("y"), geometry.y());
+            rect.insert(QStringLiteral("width"), geometry.width());
+            rect.insert(QStringLiteral("height"), geometry.height());
+
+            element.insert(QStringLiteral("className"), node < 0 ? getClassName(item) : snapshot->className(node));
+            element.insert(QStringLiteral("objectName"), node < 0 ? item->objectName() : snapshot->objectName(node));
+            element.insert(QStringLiteral("text"), node < 0 ? getText(item) : snapshot->text(node));
+            element.insert(QStringLiteral("rect"), rect);
+            element.insert(QStringLiteral("displayed"), node < 0 ? isItemVisible(item) : snapshot->isVisible(node));
+            element.insert(QStringLiteral("enabled"), node < 0 ? isItemEnabled(item) : snapshot->isEnabled(node));
+        }
         value.append(element);
     }
 
@@ -95,19 +247,23 @@ void GenericEnginePlatform::elementReply(ITransportClient *socket, QObjectList e
 void GenericEnginePlatform::addItem(QObject *o)
 {
     Q_UNUSED(o)
+    m_treeDirty.store(1);
 }
 
 void GenericEnginePlatform::removeItem(QObject *o)
 {
-    QHash<QString, QObject*>::iterator i = m_items.begin();
-    while (i != m_items.end()) {
-        if (i.value() == o) {
-            i = m_items.erase(i);
-            break;
-        } else {
-            ++i;
-        }
+    m_treeDirty.store(1);
+
+    // objects destroyed in other threads are detected by the handle table on lookup
+    if (QThread::currentThread() != thread()) {
+        return;
     }
+    m_items.remove(o);
+    m_watchedItems.remove(o);
+    m_changedItems.remove(o);
+    m_itemGenerations.remove(o);
+    m_subtreeGenerations.remove(o);
+    m_pageSourceCache.remove(o);
 }
 
 void GenericEnginePlatform::findElement(ITransportClient *socket, const QString &strategy, const QString &selector, bool multiple, QObject *item)
@@ -116,120 +272,289 @@ void GenericEnginePlatform::findElement(ITransportClient *socket, const QString
         << Q_FUNC_INFO
         << socket << strategy << selector << multiple << item;
 
+    if (m_implicitWait > 0 && !qobject_cast<QAWaitClient*>(socket)) {
+        waitForElement(socket, strategy, selector, multiple, item);
+        return;
+    }
+
     QString fixStrategy = strategy;
     fixStrategy = fixStrategy.remove(QChar(u' '));
+    if (findInSnapshot(socket, fixStrategy, selector, multiple, item)) {
+        return;
+    }
+
     const QString methodName = QStringLiteral("findStrategy_%1").arg(fixStrategy);
     if (!QAEngine::metaInvoke(socket, this, methodName, {selector, multiple, QVariant::fromValue(item)})) {
         findByProperty(socket, fixStrategy, selector, multiple, item);
     }
 }
 
+void GenericEnginePlatform::waitForElement(ITransportClient *socket, const QString &strategy, const QString &selector, bool multiple, QObject *item)
+{
+    qCDebug(categoryGenericEnginePlatform)
+        << Q_FUNC_INFO
+        << socket << strategy << selector << multiple << item << m_implicitWait;
+
+    QAWaitClient *wait = new QAWaitClient(socket, m_implicitWait);
+    const bool fromElement = item;
+    QPointer<QObject> parentItem(item);
+    connect(wait, &QAWaitClient::attemptRequested, this, [this, strategy, selector, multiple, fromElement, parentItem](ITransportClient *waitSocket) {
+        if (fromElement && !parentItem) {
+            elementReply(waitSocket, {}, multiple);
+            return;
+        }
+        collectTreeChanges();
+        qobject_cast<QAWaitClient*>(waitSocket)->setGeneration(m_treeGeneration);
+        findElement(waitSocket, strategy, selector, multiple, parentItem);
+    });
+    connect(wait, &QAWaitClient::finished, this, [this](ITransportClient *client, const QJsonValue &value, int status) {
+        socketReply(client, value.toVariant(), status);
+    });
+    connect(this, &GenericEnginePlatform::treeChanged, wait, &QAWaitClient::onTreeChanged);
+
+    startWaitPolling(wait);
+    wait->start();
+}
+
+void GenericEnginePlatform::startWaitPolling(QObject *wait)
+{
+    connect(wait, &QObject::destroyed, this, [this]() {
+        if (--m_waitCount == 0) {
+            m_waitPollTimer->stop();
+        }
+    });
+    if (m_waitCount++ == 0) {
+        m_waitPollTimer->start();
+    }
+}
+
+QObjectList GenericEnginePlatform::findItems(const QString &strategy, const QString &selector, QObject *parentItem, int limit)
+{
+    QString fixStrategy = strategy;
+    fixStrategy = fixStrategy.remove(QChar(u' '));
+
+    if (fixStrategy == QLatin1String("id") || fixStrategy == QLatin1String("objectName")) {
+        QObjectList items = findIndexedItems(QAObjectIndex::ObjectNameKey, selector, parentItem, limit);
+        if (items.isEmpty()) {
+            // object could be renamed after it was indexed
+            QObject *item = findItemByObjectName(selector, parentItem);
+            if (item) {
+                items.append(item);
+            }
+        }
+        return items;
+    } else if (fixStrategy == QLatin1String("classname")) {
+        return findIndexedItems(QAObjectIndex::ClassNameKey, selector, parentItem, limit);
+    } else if (fixStrategy == QLatin1String("name")) {
+        return findItemsByText(QAMatcher::cached(selector), parentItem, limit);
+    } else if (fixStrategy == QLatin1String("xpath")) {
+        return findItemsByXpath(selector, parentItem, limit);
+    }
+    return findItemsByProperty(fixStrategy, selector, parentItem, limit);
+}
+
 void GenericEnginePlatform::findByProperty(ITransportClient *socket, const QString &propertyName, const QVariant &propertyValue, bool multiple, QObject *parentItem)
 {
     qCDebug(categoryGenericEnginePlatform)
         << Q_FUNC_INFO
         << socket << propertyName << propertyValue << multiple << parentItem;
 
-    QObjectList items = findItemsByProperty(propertyName, propertyValue, parentItem);
+    QObjectList items = findItemsByProperty(propertyName, propertyValue, parentItem, multiple ? -1 : 1);
     elementReply(socket, items, multiple);
 }
 
-QObject *GenericEnginePlatform::findItemByObjectName(const QString &objectName, QObject *parentItem)
+bool GenericEnginePlatform::findInSnapshot(ITransportClient *socket, const QString &strategy, const QString &selector, bool multiple, QObject *parentItem)
 {
-    if (!parentItem) {
-        parentItem = m_rootObject;
+    if (!m_rootObject || !setting(QStringLiteral("snapshotMode")).toBool()) {
+        return false;
     }
 
-    if (checkMatch(objectName, parentItem->objectName())) {
-        return parentItem;
+    const QSharedPointer<const QATreeSnapshot> snapshot = treeSnapshot();
+    const int root = parentItem ? snapshot->indexOf(parentItem) : 0;
+    if (root < 0) {
+        return false;
     }
 
-    QList<QObject*> childItems = childrenList(parentItem);
-    for (QObject *child : childItems) {
-        QObject *item = findItemByObjectName(objectName, child);
-        if (item) {
-            return item;
+    // matchers are copied into the predicates, QAMatcher::cached is not thread safe
+    QASnapshotSearch *search = nullptr;
+    if (strategy == QLatin1String("id") || strategy == QLatin1String("objectName")) {
+        const QAMatcher matcher = QAMatcher::cached(selector);
+        search = QASnapshotSearch::match(snapshot, root, [matcher](const QATreeSnapshot *snapshot, int node) {
+            return matcher.match(snapshot->objectName(node));
+        }, 1);
+    } else if (strategy == QLatin1String("classname")) {
+        const QAMatcher matcher = QAMatcher::cached(selector);
+        QVector<bool> classMatches;
+        for (const QString &className : snapshot->classNames()) {
+            classMatches.append(matcher.match(className));
+        }
+        search = QASnapshotSearch::match(snapshot, root, [classMatches](const QATreeSnapshot *snapshot, int node) {
+            return classMatches.at(snapshot->classId(node));
+        }, multiple ? -1 : 1);
+    } else if (strategy == QLatin1String("name")) {
+        const QAMatcher matcher = QAMatcher::cached(selector);
+        search = QASnapshotSearch::match(snapshot, root, [matcher](const QATreeSnapshot *snapshot, int node) {
+            return matcher.match(snapshot->text(node));
+        }, multiple ? -1 : 1);
+    } else if (strategy == QLatin1String("xpath")) {
+        // element ids are handed out by the live handle table
+        QAXPathEvaluator evaluator;
+        if (selector.contains(QLatin1String("@id")) || !evaluator.setQuery(selector)) {
+            return false;
+        }
+        const int limit = multiple ? -1 : 1;
+        search = QASnapshotSearch::evaluate(snapshot, [evaluator, root, limit](const QATreeSnapshot *snapshot) {
+            QATreeSnapshot::XPathModel model(snapshot);
+            QVector<int> nodes;
+            for (QObject *item : evaluator.evaluate(&model, snapshot->item(root), limit)) {
+                nodes.append(snapshot->indexOf(item));
+            }
+            return nodes;
+        });
+    } else {
+        const int property = snapshot->propertyIndex(strategy);
+        if (property < 0) {
+            return false;
         }
+        const QAMatcher matcher = QAMatcher::isPattern(selector) ? QAMatcher::cached(selector) : QAMatcher::exact(selector);
+        search = QASnapshotSearch::match(snapshot, root, [matcher, property](const QATreeSnapshot *snapshot, int node) {
+            const QString value = snapshot->property(node, property);
+            return !value.isNull() && matcher.match(value);
+        }, multiple ? -1 : 1);
     }
-    return nullptr;
-}
 
-QObjectList GenericEnginePlatform::findItemsByClassName(const QString &className, QObject *parentItem)
-{
     qCDebug(categoryGenericEnginePlatform)
         << Q_FUNC_INFO
-        << className << parentItem;
+        << strategy << selector << multiple << root << snapshot->size();
 
-    QObjectList items;
+    QPointer<ITransportClient> client(socket);
+    connect(search, &QASnapshotSearch::finished, this, [this, client, multiple](const QObjectList &items) {
+        if (!client) {
+            qCWarning(categoryGenericEnginePlatform)
+                << Q_FUNC_INFO
+                << "Client is gone, dropping reply";
+            return;
+        }
+        elementReply(client, items, multiple);
+    });
+    search->start(m_snapshotPool);
+    return true;
+}
 
+void GenericEnginePlatform::collectItems(QObject *parentItem, const std::function<bool(QObject*)> &predicate, QObjectList *items, int limit)
+{
     if (!parentItem) {
         parentItem = m_rootObject;
     }
 
+    // preorder walk, matches are appended in document order
+    QObjectList stack = {parentItem};
+    while (!stack.isEmpty()) {
+        QObject *item = stack.takeLast();
+        if (predicate(item)) {
+            items->append(item);
+            if (limit >= 0 && items->size() >= limit) {
+                return;
+            }
+        }
 
-    if (checkMatch(className, getClassName(parentItem))) {
-        items.append(parentItem);
+        const QObjectList children = childrenList(item);
+        for (int i = children.size() - 1; i >= 0; i--) {
+            stack.append(children.at(i));
+        }
     }
+}
 
-    for (QObject *child : childrenList(parentItem)) {
-        QObjectList recursiveItems = findItemsByClassName(className, child);
-        items.append(recursiveItems);
-    }
-    return items;
+QObject *GenericEnginePlatform::findItemByObjectName(const QString &objectName, QObject *parentItem)
+{
+    return findItemByObjectName(QAMatcher::cached(objectName), parentItem);
 }
 
-QObjectList GenericEnginePlatform::findItemsByProperty(const QString &propertyName, const QVariant &propertyValue, QObject *parentItem)
+QObject *GenericEnginePlatform::findItemByObjectName(const QAMatcher &matcher, QObject *parentItem)
+{
+    QObjectList items;
+    collectItems(parentItem, [&matcher](QObject *item) {
+        return matcher.match(item->objectName());
+    }, &items, 1);
+    return items.value(0);
+}
+
+QObjectList GenericEnginePlatform::findItemsByClassName(const QString &className, QObject *parentItem, int limit)
 {
     qCDebug(categoryGenericEnginePlatform)
         << Q_FUNC_INFO
-        << propertyName << propertyValue << parentItem;
+        << className << parentItem << limit;
+
+    return findItemsByClassName(QAMatcher::cached(className), parentItem, limit);
+}
 
+QObjectList GenericEnginePlatform::findItemsByClassName(const QAMatcher &matcher, QObject *parentItem, int limit)
+{
     QObjectList items;
+    collectItems(parentItem, [&matcher](QObject *item) {
+        return matcher.match(getClassName(item));
+    }, &items, limit);
+    return items;
+}
 
-    if (!parentItem) {
-        parentItem = m_rootObject;
-    }
+QObjectList GenericEnginePlatform::findItemsByProperty(const QString &propertyName, const QVariant &propertyValue, QObject *parentItem, int limit)
+{
+    qCDebug(categoryGenericEnginePlatform)
+        << Q_FUNC_INFO
+        << propertyName << propertyValue << parentItem << limit;
 
-    if (parentItem->property(propertyName.toLatin1().constData()) == propertyValue) {
-        items.append(parentItem);
-    }
+    const QByteArray name = propertyName.toLatin1();
 
-    for (QObject *child : childrenList(parentItem)) {
-        QObjectList recursiveItems = findItemsByProperty(propertyName, propertyValue, child);
-        items.append(recursiveItems);
+    // string selectors for property strategies may be patterns
+    if (propertyValue.type() == QVariant::String && QAMatcher::isPattern(propertyValue.toString())) {
+        return findItemsByProperty(name, QAMatcher::cached(propertyValue.toString()), parentItem, limit);
     }
+
+    QObjectList items;
+    collectItems(parentItem, [&name, &propertyValue](QObject *item) {
+        return item->property(name.constData()) == propertyValue;
+    }, &items, limit);
     return items;
 }
 
-QObjectList GenericEnginePlatform::findItemsByText(const QString &text, bool partial, QObject *parentItem)
+QObjectList GenericEnginePlatform::findItemsByProperty(const QByteArray &propertyName, const QAMatcher &matcher, QObject *parentItem, int limit)
+{
+    QObjectList items;
+    collectItems(parentItem, [&propertyName, &matcher](QObject *item) {
+        const QVariant value = item->property(propertyName.constData());
+        return value.isValid() && matcher.match(value.toString());
+    }, &items, limit);
+    return items;
+}
+
+QObjectList GenericEnginePlatform::findItemsByText(const QString &text, bool partial, QObject *parentItem, int limit)
 {
     qCDebug(categoryGenericEnginePlatform)
         << Q_FUNC_INFO
-        << text << partial << parentItem;
-
-    QObjectList items;
+        << text << partial << parentItem << limit;
 
-    if (!parentItem) {
-        parentItem = m_rootObject;
-    }
+    return findItemsByText(partial ? QAMatcher::contains(text) : QAMatcher::exact(text), parentItem, limit);
+}
 
-    const QString &itemText = getText(parentItem);
-    if ((partial && itemText.contains(text)) || (!partial && itemText == text)) {
-        items.append(parentItem);
+QObjectList GenericEnginePlatform::findItemsByText(const QAMatcher &matcher, QObject *parentItem, int limit)
+{
+    QAObjectIndex *index = QAEngine::instance()->objectIndex();
+    if (index && index->hasTextKey()) {
+        return findIndexedItems(QAObjectIndex::TextKey, matcher, parentItem, limit);
     }
 
-    for (QObject *child : childrenList(parentItem)) {
-        QObjectList recursiveItems = findItemsByText(text, partial, child);
-        items.append(recursiveItems);
-    }
+    QObjectList items;
+    collectItems(parentItem, [this, &matcher](QObject *item) {
+        return matcher.match(getText(item));
+    }, &items, limit);
     return items;
 }
 
-QObjectList GenericEnginePlatform::findItemsByXpath(const QString &xpath, QObject *parentItem)
+QObjectList GenericEnginePlatform::findItemsByXpath(const QString &xpath, QObject *parentItem, int limit)
 {
     qCDebug(categoryGenericEnginePlatform)
         << Q_FUNC_INFO
-        << xpath << parentItem;
+        << xpath << parentItem << limit;
 
     QObjectList items;
 
@@ -237,6 +562,18 @@ QObjectList GenericEnginePlatform::findItemsByXpath(const QString &xpath, QObjec
         parentItem = m_rootObject;
     }
 
+    QAXPathEvaluator evaluator;
+    if (evaluator.setQuery(xpath)) {
+        GenericXPathModel model(this);
+        return evaluator.evaluate(&model, parentItem, limit);
+    }
+
+    // queries outside of supported subset are evaluated by QXmlQuery over the xml dump
+    qCDebug(categoryGenericEnginePlatform)
+        << Q_FUNC_INFO
+        << "Falling back to QXmlQuery:"
+        << evaluator.errorString();
+
     QString out;
     QXmlStreamWriter writer(&out);
     writer.setAutoFormatting(true);
@@ -269,10 +606,9 @@ QObjectList GenericEnginePlatform::findItemsByXpath(const QString &xpath, QObjec
         reader.readNext();
         if (reader.isStartElement()) {
             const QString elementId = reader.attributes().value(QStringLiteral("id")).toString();
-            const QString address = elementId.section(QChar(u'x'), -1);
-            const qulonglong integer = address.toULongLong(NULL, 16);
-            QObject *item = reinterpret_cast<QObject*>(integer);
-            items.append(item);
+            if (QObject *item = m_items.object(elementId)) {
+                items.append(item);
+            }
             reader.skipCurrentElement();
         }
     }
@@ -280,6 +616,118 @@ QObjectList GenericEnginePlatform::findItemsByXpath(const QString &xpath, QObjec
     return items;
 }
 
+QObjectList GenericEnginePlatform::findIndexedItems(QAObjectIndex::Key key, const QString &pattern, QObject *parentItem, int limit)
+{
+    return findIndexedItems(key, QAMatcher::cached(pattern), parentItem, limit);
+}
+
+QObjectList GenericEnginePlatform::findIndexedItems(QAObjectIndex::Key key, const QAMatcher &matcher, QObject *parentItem, int limit)
+{
+    qCDebug(categoryGenericEnginePlatform)
+        << Q_FUNC_INFO
+        << key << matcher.pattern() << parentItem << limit;
+
+    if (!parentItem) {
+        parentItem = m_rootObject;
+    }
+
+    QAObjectIndex *index = QAEngine::instance()->objectIndex();
+    if (!index) {
+        switch (key) {
+        case QAObjectIndex::ClassNameKey:
+            return findItemsByClassName(matcher, parentItem, limit);
+        case QAObjectIndex::TextKey:
+            return findItemsByText(matcher, parentItem, limit);
+        default:
+            return QObjectList({findItemByObjectName(matcher, parentItem)});
+        }
+    }
+
+    QObjectList candidates;
+    if (matcher.type() != QAMatcher::Exact) {
+        for (const QString &value : index->values(key)) {
+            if (matcher.match(value)) {
+                candidates.append(index->objects(key, value));
+            }
+        }
+    } else {
+        candidates = index->objects(key, matcher.pattern());
+    }
+
+    // objectName could be changed after the object was indexed,
+    // text could be changed through a property without notify signal
+    if (key != QAObjectIndex::ClassNameKey) {
+        QObjectList::iterator it = candidates.begin();
+        while (it != candidates.end()) {
+            const QString value = key == QAObjectIndex::ObjectNameKey ? (*it)->objectName() : getText(*it);
+            if (matcher.match(value)) {
+                ++it;
+            } else {
+                it = candidates.erase(it);
+            }
+        }
+    }
+
+    QObjectList items = sortInTreeOrder(candidates, parentItem);
+    if (limit >= 0 && items.size() > limit) {
+        items.erase(items.begin() + limit, items.end());
+    }
+    return items;
+}
+
+QObjectList GenericEnginePlatform::sortInTreeOrder(const QObjectList &items, QObject *parentItem)
+{
+    // position of every item is a path of child indexes from parentItem,
+    // items outside of parentItem subtree are dropped
+    QHash<QObject*, QHash<QObject*, int>> childIndexes;
+    std::vector<std::pair<QVector<int>, QObject*>> positions;
+    positions.reserve(items.size());
+
+    for (QObject *item : items) {
+        QVector<int> path;
+        QObject *child = item;
+        while (child && child != parentItem) {
+            QObject *parent = getParent(child);
+            if (!parent) {
+                child = nullptr;
+                break;
+            }
+
+            QHash<QObject*, QHash<QObject*, int>>::iterator indexes = childIndexes.find(parent);
+            if (indexes == childIndexes.end()) {
+                indexes = childIndexes.insert(parent, QHash<QObject*, int>());
+                const QObjectList children = childrenList(parent);
+                for (int i = 0; i < children.size(); i++) {
+                    indexes->insert(children.at(i), i);
+                }
+            }
+
+            const int childIndex = indexes->value(child, -1);
+            if (childIndex < 0) {
+                child = nullptr;
+                break;
+            }
+            path.prepend(childIndex);
+            child = parent;
+        }
+
+        if (child) {
+            positions.emplace_back(path, item);
+        }
+    }
+
+    std::sort(positions.begin(), positions.end(), [](const std::pair<QVector<int>, QObject*> &a, const std::pair<QVector<int>, QObject*> &b) {
+        return std::lexicographical_compare(a.first.cbegin(), a.first.cend(), b.first.cbegin(), b.first.cend());
+    });
+
+    QObjectList result;
+    result.reserve(int(positions.size()));
+    for (const auto &position : positions) {
+        result.append(position.second);
+    }
+    return result;
+}
+
 QObjectList GenericEnginePlatform::filterVisibleItems(QObjectList items)
 {
     qCDebug(categoryGenericEnginePlatform)
@@ -303,7 +751,7 @@ bool GenericEnginePlatform::containsObject(const QString &elementId)
 
 QObject *GenericEnginePlatform::getObject(const QString &elementId)
 {
-    return m_items.value(elementId);
+    return m_items.object(elementId);
 }
 
 QString GenericEnginePlatform::getText(QObject *item)
@@ -312,23 +760,11 @@ QString GenericEnginePlatform::getText(QObject *item)
         << Q_FUNC_INFO
         << item;
 
-    static const char *textProperties[] = {
-        "label",
-        "title",
-        "description",
-        "placeholderText",
-        "text",
-        "value",
-        "name",
-        "toolTip",
-    };
-
-    for (const char *textProperty : textProperties) {
-        if (item->metaObject()->indexOfProperty(textProperty) > 0) {
-            const QString text = item->property(textProperty).toString();
-            if (!text.isEmpty()) {
-                return text;
-            }
+    const QMetaObject *mo = item->metaObject();
+    for (int textProperty : propertySchema(item)->textProperties()) {
+        const QString text = mo->property(textProperty).read(item).toString();
+        if (!text.isEmpty()) {
+            return text;
         }
     }
 
@@ -353,6 +789,269 @@ QRect GenericEnginePlatform::getAbsGeometry(QObject *item)
     return QRect(getAbsPosition(item), getSize(item));
 }
 
+GenericEnginePlatform::GeometryContext GenericEnginePlatform::geometryContext(QObject *item)
+{
+    GeometryContext context;
+    context.absPosition = getAbsPosition(item);
+    context.visible = isItemVisible(item);
+    return context;
+}
+
+GenericEnginePlatform::GeometryContext GenericEnginePlatform::childGeometryContext(QObject *child, const GeometryContext &parent)
+{
+    Q_UNUSED(parent)
+    return geometryContext(child);
+}
+
+qreal GenericEnginePlatform::getZ(QObject *item)
+{
+    Q_UNUSED(item)
+    return 0;
+}
+
+QVariant GenericEnginePlatform::setting(const QString &name, const QVariant &defaultValue) const
+{
+    return m_settings.value(name, defaultValue);
+}
+
+QSharedPointer<const QATreeSnapshot> GenericEnginePlatform::treeSnapshot()
+{
+    collectTreeChanges();
+    if (m_snapshot && m_snapshot->generation() == m_treeGeneration) {
+        return m_snapshot;
+    }
+
+    QSharedPointer<QATreeSnapshot> snapshot(new QATreeSnapshot(setting(QStringLiteral("snapshotProperties")).toStringList()));
+    snapshot->setGeneration(m_treeGeneration);
+
+    // unchanged subtrees of the previous snapshot are copied instead of read from live objects
+    const QATreeSnapshot *previous = m_snapshot.data();
+    if (previous && (previous->generation() < m_resetGeneration || previous->properties() != snapshot->properties())) {
+        previous = nullptr;
+    }
+    const int base = previous ? previous->generation() : 0;
+
+    struct Entry {
+        QObject *item;
+        int parent;
+        bool ancestorChanged;
+        GeometryContext context;
+    };
+
+    // preorder walk, same order as collectItems
+    QVector<Entry> stack = {{m_rootObject, -1, false, geometryContext(m_rootObject)}};
+    int copied = 0;
+    while (!stack.isEmpty()) {
+        const Entry entry = stack.takeLast();
+        QObject *item = entry.item;
+
+        const int previousNode = previous && !entry.ancestorChanged ? previous->indexOf(item) : -1;
+        if (previousNode >= 0 && !isSubtreeChanged(item, base)) {
+            copied += previous->subtreeEnd(previousNode) - previousNode;
+            snapshot->appendSubtreeCopy(previous, previousNode, entry.parent);
+            continue;
+        }
+
+        // geometry of descendants follows changed item, so its whole subtree is read again
+        const bool changed = previousNode < 0 || isItemChanged(item, base);
+        int node = -1;
+        if (changed) {
+            node = snapshot->append(item, entry.parent);
+            snapshotItem(snapshot.data(), item, node, entry.context);
+        } else {
+            node = snapshot->appendCopy(previous, previousNode, entry.parent);
+        }
+
+        const QObjectList children = childrenList(item);
+        for (int i = children.size() - 1; i >= 0; i--) {
+            QObject *child = children.at(i);
+            stack.append({child, node, changed, childGeometryContext(child, entry.context)});
+        }
+    }
+    snapshot->seal();
+
+    qCDebug(categoryGenericEnginePlatform)
+        << Q_FUNC_INFO
+        << m_treeGeneration << snapshot->size() << copied;
+
+    m_snapshot = snapshot;
+    return m_snapshot;
+}
+
+void GenericEnginePlatform::snapshotItem(QATreeSnapshot *snapshot, QObject *item, int node, const GeometryContext &context)
+{
+    watchItem(item);
+
+    const QSize size = getSize(item);
+    snapshot->setClassName(node, propertySchema(item)->className());
+    snapshot->setObjectName(node, item->objectName());
+    snapshot->setText(node, getText(item));
+    const QRect absGeometry(context.absPosition, size);
+    snapshot->setGeometry(node, QRect(getPosition(item), size), absGeometry);
+    snapshot->setVisible(node, context.visible);
+    if (context.visible) {
+        snapshot->setVisibleRect(node, context.clipped ? absGeometry & context.clipRect.toAlignedRect() : absGeometry);
+    }
+    snapshot->setEnabled(node, isItemEnabled(item));
+    snapshot->setZ(node, getZ(item));
+
+    const QStringList properties = snapshot->properties();
+    for (int i = 0; i < properties.size(); i++) {
+        const QVariant value = readProperty(item, properties.at(i));
+        if (value.isValid() && value.canConvert<QString>()) {
+            const QString text = value.toString();
+            snapshot->setProperty(node, i, text.isNull() ? QStringLiteral("") : text);
+        }
+    }
+}
+
+QSharedPointer<const QASpatialIndex> GenericEnginePlatform::spatialIndex()
+{
+    const QSharedPointer<const QATreeSnapshot> snapshot = treeSnapshot();
+    if (!m_spatialIndex || m_spatialIndex->snapshot() != snapshot) {
+        m_spatialIndex = QSharedPointer<const QASpatialIndex>(new QASpatialIndex(snapshot));
+    }
+    return m_spatialIndex;
+}
+
+void GenericEnginePlatform::collectTreeChanges()
+{
+    if (m_treeDirty.fetchAndStoreOrdered(0) || isTreeExpired()) {
+        markTreeChanged();
+    } else {
+        markItemsChanged(QObjectList());
+    }
+}
+
+void GenericEnginePlatform::watchItem(QObject *item)
+{
+    if (m_watchedItems.contains(item)) {
+        return;
+    }
+    m_watchedItems.insert(item);
+
+    static const QMetaMethod changedSlot = staticMetaObject.method(staticMetaObject.indexOfSlot("onItemPropertyChanged()"));
+    const QMetaObject *mo = item->metaObject();
+    for (int notifySignal : propertySchema(item)->watchedSignals()) {
+        connect(item, mo->method(notifySignal), this, changedSlot, Qt::UniqueConnection);
+    }
+}
+
+void GenericEnginePlatform::onItemPropertyChanged()
+{
+    m_changedItems.insert(sender());
+}
+
+void GenericEnginePlatform::markItemChanged(QObject *item)
+{
+    m_itemGenerations.insert(item, m_treeGeneration);
+
+    // ancestors marked in this generation already have the rest of the chain marked
+    for (QObject *ancestor = item; ancestor; ancestor = getParent(ancestor)) {
+        int &generation = m_subtreeGenerations[ancestor];
+        if (generation == m_treeGeneration) {
+            break;
+        }
+        generation = m_treeGeneration;
+    }
+}
+
+void GenericEnginePlatform::markItemsChanged(const QObjectList &items)
+{
+    for (QObject *item : items) {
+        m_changedItems.insert(item);
+    }
+    if (m_changedItems.isEmpty()) {
+        return;
+    }
+
+    m_treeGeneration++;
+    for (QObject *item : m_changedItems) {
+        markItemChanged(item);
+    }
+    m_changedItems.clear();
+
+    emit treeChanged(m_treeGeneration);
+}
+
+void GenericEnginePlatform::markTreeChanged()
+{
+    m_resetGeneration = ++m_treeGeneration;
+    m_itemGenerations.clear();
+    m_subtreeGenerations.clear();
+    m_changedItems.clear();
+    m_treeAge.start();
+
+    emit treeChanged(m_treeGeneration);
+}
+
+bool GenericEnginePlatform::isTreeExpired() const
+{
+    return !m_treeAge.isValid() || m_treeAge.elapsed() >= c_treeMaxAge;
+}
+
+bool GenericEnginePlatform::isItemChanged(QObject *item, int generation) const
+{
+    return m_resetGeneration > generation || m_itemGenerations.value(item) > generation;
+}
+
+bool GenericEnginePlatform::isSubtreeChanged(QObject *item, int generation) const
+{
+    return m_resetGeneration > generation || m_subtreeGenerations.value(item) > generation;
+}
+
+void GenericEnginePlatform::pageSource(QAReplyStream *out)
+{
+    collectTreeChanges();
+
+    out->write(QByteArrayLiteral("<?xml version=\"1.0\" encoding=\"UTF-8\"?>"));
+    if (m_rootObject) {
+        appendPageSource(out, m_rootObject, 0, false, geometryContext(m_rootObject));
+    }
+}
+
+void GenericEnginePlatform::appendPageSource(QAReplyStream *out, QObject *item, int depth, bool ancestorChanged, const GeometryContext &context)
+{
+    PageSourceEntry &entry = m_pageSourceCache[item];
+    const bool changed = ancestorChanged
+        || entry.item != item
+        || entry.generation < 0
+        || isItemChanged(item, entry.generation);
+
+    if (changed) {
+        watchItem(item);
+
+        // the cached tag holds the id, it is kept valid as long as the tag is
+        const QString id = markupId(item);
+        if (entry.id != id) {
+            m_items.unpin(entry.id);
+            m_items.pin(id);
+            entry.id = id;
+        }
+
+        QXmlStreamWriter writer(&entry.startTag);
+        entry.startTag.clear();
+        writeXmlStartElement(&writer, item, depth, context);
+        // closes the start tag, children are appended as plain text
+        writer.writeCharacters(QString());
+
+        entry.item = item;
+        entry.generation = m_treeGeneration;
+        entry.endTag = QStringLiteral("</%1>").arg(propertySchema(item)->className());
+    }
+    out->write(entry.startTag);
+
+    // entry reference is not valid once children are added to the cache
+    const QString endTag = entry.endTag;
+
+    int z = 0;
+    for (QObject *child : childrenList(item)) {
+        appendPageSource(out, child, ++z, changed, childGeometryContext(child, context));
+    }
+
+    out->write(endTag);
+}
+
 QJsonObject GenericEnginePlatform::dumpObject(QObject *item, int depth)
 {
     if (!item) {
@@ -362,39 +1061,33 @@ QJsonObject GenericEnginePlatform::dumpObject(QObject *item, int depth)
         return QJsonObject();
     }
 
+    return dumpObject(item, depth, geometryContext(item));
+}
+
+QJsonObject GenericEnginePlatform::dumpObject(QObject *item, int depth, const GeometryContext &context)
+{
+    if (!item) {
+        qCritical()
+            << Q_FUNC_INFO
+            << "No object!";
+        return QJsonObject();
+    }
+
     QJsonObject object;
 
     const QString className = getClassName(item);
     object.insert(QStringLiteral("classname"), QJsonValue(className));
 
-    const QString id = uniqueId(item);
+    const QString id = markupId(item);
     object.insert(QStringLiteral("id"), QJsonValue(id));
 
-    auto mo = item->metaObject();
-    do {
-        const QString moClassName = QString::fromLatin1(mo->className());
-        std::vector<std::pair<QString, QVariant> > v;
-        v.reserve(mo->propertyCount() - mo->propertyOffset());
-        for (int i = mo->propertyOffset(); i < mo->propertyCount(); ++i) {
-            const QString propertyName = QString::fromLatin1(mo->property(i).name());
-            if (m_blacklistedProperties.contains(moClassName)
-                    && m_blacklistedProperties.value(moClassName).contains(propertyName)) {
-                qCDebug(categoryGenericEnginePlatform)
-                    << "Found blacklisted:"
-                    << moClassName << propertyName;
-                continue;
-            }
-
-            v.emplace_back(propertyName, mo->property(i).read(item));
-        }
-        std::sort(v.begin(), v.end());
-        for (auto &i : v) {
-            if (!object.contains(i.first)
-                    && i.second.canConvert<QString>()) {
-                object.insert(i.first, QJsonValue::fromVariant(i.second));
-            }
+    const QMetaObject *mo = item->metaObject();
+    for (const QAPropertySchema::Property &property : propertySchema(item)->properties()) {
+        const QVariant value = mo->property(property.index).read(item);
+        if (value.canConvert<QString>()) {
+            object.insert(property.name, QJsonValue::fromVariant(value));
         }
-    } while ((mo = mo->superClass()));
+    }
 
     const QRect rect = getGeometry(item);
     object.insert(QStringLiteral("width"), QJsonValue(rect.width()));
@@ -403,233 +1096,290 @@ QJsonObject GenericEnginePlatform::dumpObject(QObject *item, int depth)
     object.insert(QStringLiteral("y"), QJsonValue(rect.y()));
     object.insert(QStringLiteral("zDepth"), QJsonValue(depth));
 
-    const QPoint abs = getAbsPosition(item);
-    object.insert(QStringLiteral("abs_x"), QJsonValue(abs.x()));
-    object.insert(QStringLiteral("abs_y"), QJsonValue(abs.y()));
+    object.insert(QStringLiteral("abs_x"), QJsonValue(context.absPosition.x()));
+    object.insert(QStringLiteral("abs_y"), QJsonValue(context.absPosition.y()));
 
     object.insert(QStringLiteral("objectName"), QJsonValue(item->objectName()));
     object.insert(QStringLiteral("enabled"), QJsonValue(isItemEnabled(item)));
-    object.insert(QStringLiteral("visible"), QJsonValue(isItemVisible(item)));
+    object.insert(QStringLiteral("visible"), QJsonValue(context.visible));
 
     object.insert(QStringLiteral("mainTextProperty"), getText(item));
 
     return object;
 }
 
-QJsonObject GenericEnginePlatform::recursiveDumpTree(QObject *rootItem, int depth)
+void GenericEnginePlatform::recursiveDumpTree(QAReplyStream *out, QObject *rootItem, int depth)
+{
+    recursiveDumpTree(out, rootItem, depth, geometryContext(rootItem));
+}
+
+void GenericEnginePlatform::recursiveDumpTree(QAReplyStream *out, QObject *rootItem, int depth, const GeometryContext &context)
 {
-    QJsonObject object = dumpObject(rootItem, depth);
-    QJsonArray childArray;
+    // only a single node is serialized at a time, its closing brace is replaced by the children array
+    const QJsonObject object = dumpObject(rootItem, depth, context);
+    QByteArray node = QJsonDocument(object).toJson(QJsonDocument::Compact);
+    node.chop(1);
+    node.append(object.isEmpty() ? "\"children\":[" : ",\"children\":[");
+    out->write(node);
 
     int z = 0;
     for (QObject *child : childrenList(rootItem)) {
-        QJsonObject childObject = recursiveDumpTree(child, ++z);
-        childArray.append(QJsonValue(childObject));
+        if (z > 0) {
+            out->write(QByteArrayLiteral(","));
+        }
+        recursiveDumpTree(out, child, ++z, childGeometryContext(child, context));
     }
-    object.insert(QStringLiteral("children"), QJsonValue(childArray));
 
-    return object;
+    out->write(QByteArrayLiteral("]}"));
 }
 
 void GenericEnginePlatform::recursiveDumpXml(QXmlStreamWriter *writer, QObject *rootItem, int depth)
 {
-    const QString className = getClassName(rootItem);
-    writer->writeStartElement(className);
+    recursiveDumpXml(writer, rootItem, depth, geometryContext(rootItem));
+}
+
+void GenericEnginePlatform::recursiveDumpXml(QXmlStreamWriter *writer, QObject *rootItem, int depth, const GeometryContext &context)
+{
+    writeXmlStartElement(writer, rootItem, depth, context);
+
+    int z = 0;
+    for (QObject *child : childrenList(rootItem)) {
+        recursiveDumpXml(writer, child, ++z, childGeometryContext(child, context));
+    }
+
+    writer->writeEndElement();
+}
+
+void GenericEnginePlatform::writeXmlStartElement(QXmlStreamWriter *writer, QObject *item, int depth, const GeometryContext &context)
+{
+    const QSharedPointer<const QAPropertySchema> schema = propertySchema(item);
+    writer->writeStartElement(schema->className());
 
-    const QString id = uniqueId(rootItem);
+    const QString id = markupId(item);
     writer->writeAttribute(QStringLiteral("id"), id);
 
-    QStringList attributes;
-    auto mo = rootItem->metaObject();
-    do {
-        for (int i = mo->propertyOffset(); i < mo->propertyCount(); ++i) {
-            const QString propertyName = QString::fromLatin1(mo->property(i).name());
-            if (m_blacklistedProperties.contains(className)
-                    && m_blacklistedProperties.value(className).contains(propertyName)) {
-                qCDebug(categoryGenericEnginePlatform)
-                    << "Found blacklisted:"
-                    << className << propertyName;
-                continue;
-            }
-            if (!attributes.contains(propertyName)) {
-                attributes.append(propertyName);
-                QVariant value = mo->property(i).read(rootItem);
-                if (value.canConvert<QString>()) {
-                    writer->writeAttribute(propertyName, value.toString());
-                }
-            }
+    const QMetaObject *mo = item->metaObject();
+    for (const QAPropertySchema::Property &property : schema->properties()) {
+        const QVariant value = mo->property(property.index).read(item);
+        if (value.canConvert<QString>()) {
+            writer->writeAttribute(property.name, value.toString());
         }
-    } while ((mo = mo->superClass()));
+    }
 
     writer->writeAttribute(QStringLiteral("zDepth"), QString::number(depth));
 
-    const QPoint abs = getAbsPosition(rootItem);
-    writer->writeAttribute(QStringLiteral("abs_x"), QString::number(abs.x()));
-    writer->writeAttribute(QStringLiteral("abs_y"), QString::number(abs.y()));
+    writer->writeAttribute(QStringLiteral("abs_x"), QString::number(context.absPosition.x()));
+    writer->writeAttribute(QStringLiteral("abs_y"), QString::number(context.absPosition.y()));
 
-    QString text = getText(rootItem);
+    QString text = getText(item);
     writer->writeAttribute(QStringLiteral("mainTextProperty"), text);
 
     if (!text.isEmpty()) {
         writer->writeCharacters(text);
     }
+}
 
-    int z = 0;
-    for (QObject *child : childrenList(rootItem)) {
-        recursiveDumpXml(writer, child, ++z);
-    }
+QAPendingEvent *GenericEnginePlatform::startClickItem(QObject *item)
+{
+    const QPoint itemAbs = getAbsPosition(item);
+    const QSize size = getSize(item);
+    qCDebug(categoryGenericEnginePlatform)
+        << Q_FUNC_INFO
+        << item << itemAbs << size;
 
-    writer->writeEndElement();
+    return startClick(QPoint(itemAbs.x() + size.width() / 2, itemAbs.y() + size.height() / 2));
 }
 
-void GenericEnginePlatform::clickItem(QObject *item)
+QAPendingEvent *GenericEnginePlatform::startClick(const QPoint &pos)
+{
+    qCDebug(categoryGenericEnginePlatform)
+        << Q_FUNC_INFO
+        << pos;
+
+    return settle(m_mouseEngine->click(pos), 50);
+}
+
+QAPendingEvent *GenericEnginePlatform::startPressAndHoldItem(QObject *item, int delay)
 {
     const QPoint itemAbs = getAbsPosition(item);
     const QSize size = getSize(item);
     qCDebug(categoryGenericEnginePlatform)
         << Q_FUNC_INFO
-        << item << itemAbs << size;
+        << item << itemAbs << size << delay;
 
-    clickPoint(itemAbs.x() + size.width() / 2, itemAbs.y() + size.height() / 2);
+    return startPressAndHold(QPoint(itemAbs.x() + size.width() / 2, itemAbs.y() + size.height() / 2), delay);
 }
 
-QString GenericEnginePlatform::getClassName(QObject *item)
+QAPendingEvent *GenericEnginePlatform::startPressAndHold(const QPoint &pos, int delay)
 {
-    return QString::fromLatin1(item->metaObject()->className()).section(QChar(u'_'), 0, 0).section(QChar(u':'), -1);
+    qCDebug(categoryGenericEnginePlatform)
+        << Q_FUNC_INFO
+        << pos << delay;
+
+    return settle(m_mouseEngine->pressAndHold(pos, delay), 0);
 }
 
-QString GenericEnginePlatform::uniqueId(QObject *item)
+QAPendingEvent *GenericEnginePlatform::startMouseMove(const QPoint &start, const QPoint &stop)
+{
+    qCDebug(categoryGenericEnginePlatform)
+        << Q_FUNC_INFO
+        << start << stop;
+
+    return settle(m_mouseEngine->move(start, stop), 800);
+}
+
+QAPendingEvent *GenericEnginePlatform::startMouseDrag(const QPoint &start, const QPoint &stop, int delay)
 {
-    return QStringLiteral("%1_0x%2").arg(getClassName(item))
-            .arg(reinterpret_cast<quintptr>(item),
-                 QT_POINTER_SIZE * 2, 16, QLatin1Char('0'));
+    qCDebug(categoryGenericEnginePlatform)
+        << Q_FUNC_INFO
+        << start << stop << delay;
+
+    return settle(m_mouseEngine->drag(start, stop, delay), 800);
+}
+
+QAPendingEvent *GenericEnginePlatform::settle(QAPendingEvent *event, int delay)
+{
+    QAPendingEvent *settled = new QAPendingEvent(this);
+    const auto complete = [settled]() {
+        settled->setCompleted();
+        settled->deleteLater();
+    };
+    connect(event, &QAPendingEvent::completed, settled, [this, settled, delay, complete]() {
+        QTimer::singleShot(delay, settled, [this, settled, complete]() {
+            // events held back for window activation are part of the action
+            if (m_pendingInput.isEmpty()) {
+                complete();
+            } else {
+                connect(this, &GenericEnginePlatform::inputFlushed, settled, complete);
+            }
+        });
+    });
+    return settled;
+}
+
+void GenericEnginePlatform::whenCompleted(QAPendingEvent *event, const std::function<void()> &done)
+{
+    connect(event, &QAPendingEvent::completed, this, [done]() {
+        done();
+    });
+}
+
+void GenericEnginePlatform::replyWhenCompleted(ITransportClient *socket, QAPendingEvent *event)
+{
+    whenCompleted(event, replyWhenDone(socket));
+}
+
+std::function<void()> GenericEnginePlatform::replyWhenDone(ITransportClient *socket)
+{
+    QPointer<ITransportClient> client(socket);
+    return [this, client]() {
+        if (client) {
+            socketReply(client, QString());
+        }
+    };
+}
+
+void GenericEnginePlatform::clickItems(const QList<QPointer<QObject>> &items, const std::function<void()> &done)
+{
+    // items destroyed by earlier clicks are skipped
+    QList<QPointer<QObject>> remaining = items;
+    while (!remaining.isEmpty() && !remaining.first()) {
+        remaining.removeFirst();
+    }
+    if (remaining.isEmpty()) {
+        done();
+        return;
+    }
+
+    QObject *item = remaining.takeFirst();
+    whenCompleted(startClickItem(item), [this, remaining, done]() {
+        clickItems(remaining, done);
+    });
 }
 
-void GenericEnginePlatform::setProperty(ITransportClient *socket, const QString &property, const QVariant &value, const QString &elementId)
+void GenericEnginePlatform::deliverInput(const std::function<void()> &deliver)
 {
-    qCDebug(categoryGenericEnginePlatform)
-        << Q_FUNC_INFO
-        << socket << property << value << elementId;
+    // order of events is kept, later events wait behind the held back ones
+    if (m_inputActivated && m_pendingInput.isEmpty()) {
+        deliver();
+        return;
+    }
 
-    QObject *item = getObject(elementId);
-    if (item) {
-        item->setProperty(property.toLatin1().constData(), value);
-        socketReply(socket, QString());
-    } else {
-        socketReply(socket, QString(), 1);
+    m_pendingInput.append(deliver);
+    if (!m_activationTimer->isActive()) {
+        m_rootWindow->raise();
+        m_rootWindow->requestActivate();
+        m_rootWindow->setWindowState(Qt::WindowState::WindowActive);
+        m_activationTimer->start();
     }
 }
 
-void GenericEnginePlatform::clickPoint(int posx, int posy)
+void GenericEnginePlatform::flushInput()
 {
-    qCDebug(categoryGenericEnginePlatform)
-        << Q_FUNC_INFO
-        << posx << posy;
+    m_inputActivated = true;
 
-    QEventLoop loop;
-    QTimer timer;
-    timer.setSingleShot(true);
-    timer.setInterval(50);
-    connect(m_mouseEngine->click(QPointF(posx, posy)),
-            &QAPendingEvent::completed, &timer, static_cast<void (QTimer::*)()>(&QTimer::start));
-    connect(&timer, &QTimer::timeout, &loop, &QEventLoop::quit);
-    loop.exec();
+    const QVector<std::function<void()>> pending = m_pendingInput;
+    m_pendingInput.clear();
+    for (const std::function<void()> &deliver : pending) {
+        deliver();
+    }
+    emit inputFlushed();
 }
 
-void GenericEnginePlatform::clickPoint(const QPoint &pos)
+QString GenericEnginePlatform::getClassName(QObject *item)
 {
-    clickPoint(pos.x(), pos.y());
+    return QString::fromLatin1(item->metaObject()->className()).section(QChar(u'_'), 0, 0).section(QChar(u':'), -1);
 }
 
-void GenericEnginePlatform::pressAndHold(int posx, int posy, int delay)
+QString GenericEnginePlatform::uniqueId(QObject *item)
 {
-    qCDebug(categoryGenericEnginePlatform)
-        << Q_FUNC_INFO
-        << posx << posy << delay;
-
-    QEventLoop loop;
-    connect(m_mouseEngine->pressAndHold(QPointF(posx, posy), delay),
-            &QAPendingEvent::completed, &loop, &QEventLoop::quit);
-    loop.exec();
+    return m_items.handle(item, getClassName(item));
 }
 
-void GenericEnginePlatform::mouseMove(int startx, int starty, int stopx, int stopy)
+QString GenericEnginePlatform::markupId(QObject *item)
 {
-    qCDebug(categoryGenericEnginePlatform)
-        << Q_FUNC_INFO
-        << startx << starty << stopx << stopy;
-
-    QEventLoop loop;
-    QTimer timer;
-    timer.setInterval(800);
-    timer.setSingleShot(true);
-    connect(m_mouseEngine->move(
-                QPointF(startx, starty),
-                QPointF(stopx, stopy)),
-            &QAPendingEvent::completed, &timer, static_cast<void (QTimer::*)()>(&QTimer::start));
-    connect(&timer, &QTimer::timeout, &loop, &QEventLoop::quit);
-    loop.exec();
+    return m_items.markupHandle(item, getClassName(item));
 }
 
-void GenericEnginePlatform::mouseDrag(int startx, int starty, int stopx, int stopy, int delay)
+QSharedPointer<const QAPropertySchema> GenericEnginePlatform::propertySchema(QObject *item)
 {
-    qCDebug(categoryGenericEnginePlatform)
-        << Q_FUNC_INFO
-        << startx << starty << stopx << stopy << delay;
+    const QMetaObject *mo = item->metaObject();
+    const void *key = QAPropertySchema::key(mo);
 
-    QEventLoop loop;
-    QTimer timer;
-    timer.setInterval(800);
-    timer.setSingleShot(true);
-    connect(m_mouseEngine->drag(
-                QPointF(startx, starty),
-                QPointF(stopx, stopy),
-                delay),
-            &QAPendingEvent::completed, &timer, static_cast<void (QTimer::*)()>(&QTimer::start));
-    connect(&timer, &QTimer::timeout, &loop, &QEventLoop::quit);
-    loop.exec();
+    QSharedPointer<const QAPropertySchema> schema = m_propertySchemas.value(key);
+    if (!schema) {
+        schema = QSharedPointer<const QAPropertySchema>(new QAPropertySchema(mo, m_blacklistedProperties));
+        m_propertySchemas.insert(key, schema);
+    }
+    return schema;
 }
 
-void GenericEnginePlatform::processTouchActionList(const QVariant &actionListArg)
+QVariant GenericEnginePlatform::readProperty(QObject *item, const QString &name)
 {
-    int startX = 0;
-    int startY = 0;
-    int endX = 0;
-    int endY = 0;
-    int delay = 800;
+    const int propertyIndex = propertySchema(item)->indexOfProperty(name);
+    if (propertyIndex < 0) {
+        // dynamic properties are not part of the meta object
+        return item->property(name.toLatin1().constData());
+    }
+    return item->metaObject()->property(propertyIndex).read(item);
+}
 
-    const QVariantList actions = actionListArg.toList();
-    for (const QVariant &actionArg : actions) {
-        const QVariantMap action = actionArg.toMap();
-        const QString actionName = action.value(QStringLiteral("action")).toString();
-        const QVariantMap options = action.value(QStringLiteral("options")).toMap();
+void GenericEnginePlatform::setProperty(ITransportClient *socket, const QString &property, const QVariant &value, const QString &elementId)
+{
+    qCDebug(categoryGenericEnginePlatform)
+        << Q_FUNC_INFO
+        << socket << property << value << elementId;
 
-        if (actionName == QLatin1String("wait")) {
-            delay = options.value(QStringLiteral("ms")).toInt();
-        } else if (actionName == QLatin1String("tap")) {
-            const int tapX = options.value(QStringLiteral("x")).toInt();
-            const int tapY = options.value(QStringLiteral("y")).toInt();
-            clickPoint(tapX, tapY);
-        } else if (actionName == QLatin1String("press")) {
-            startX = options.value(QStringLiteral("x")).toInt();
-            startY = options.value(QStringLiteral("y")).toInt();
-        } else if (actionName == QLatin1String("moveTo")) {
-            endX = options.value(QStringLiteral("x")).toInt();
-            endY = options.value(QStringLiteral("y")).toInt();
-        } else if (actionName == QLatin1String("release")) {
-            mouseDrag(startX, startY, endX, endY, delay);
-        } else if (actionName == QLatin1String("longPress")) {
-            const QString elementId = options.value(QStringLiteral("element")).toString();
-            if (!containsObject(elementId)) {
-                continue;
-            }
-            pressAndHoldItem(getObject(elementId), delay);
-        }
+    QObject *item = getObject(elementId);
+    if (item) {
+        item->setProperty(property.toLatin1().constData(), value);
+        socketReply(socket, QString());
+    } else {
+        socketReply(socket, QString(), 1);
     }
-
 }
 
-void GenericEnginePlatform::waitForPropertyChange(QObject *item, const QString &propertyName, const QVariant &value, int timeout)
+void GenericEnginePlatform::waitForPropertyChange(QObject *item, const QString &propertyName, const QVariant &value, int timeout, const std::function<void()> &done)
 {
     qCDebug(categoryGenericEnginePlatform)
         << Q_FUNC_INFO
@@ -637,63 +1387,45 @@ void GenericEnginePlatform::waitForPropertyChange(QObject *item, const QString &
 
     if (!item) {
         qCWarning(categoryGenericEnginePlatform) << "item is null" << item;
+        done();
         return;
     }
     int propertyIndex = item->metaObject()->indexOfProperty(propertyName.toLatin1().constData());
     if (propertyIndex < 0) {
         qCWarning(categoryGenericEnginePlatform) << Q_FUNC_INFO << item << "property" << propertyName << "is not valid!";
+        done();
         return;
     }
     const QMetaProperty prop = item->metaObject()->property(propertyIndex);
-    if (prop.read(item) == value) {
+    const QVariant initial = prop.read(item);
+    if (initial == value) {
+        done();
         return;
     }
-    if (!prop.hasNotifySignal()) {
+
+    // invalid value waits for any change
+    const QAPropertyWatchRegistry::Predicate predicate = [value, initial](const QVariant &current) {
+        return value.isValid() ? current == value : current != initial;
+    };
+    const bool watched = m_propertyWatches->watch(item, propertyIndex, predicate, timeout, [done](bool, const QVariant &) {
+        done();
+    });
+    if (!watched) {
         qCWarning(categoryGenericEnginePlatform)
             << Q_FUNC_INFO
             << item << "property" << propertyName << "have on notifySignal!";
-        return;
-    }
-    QEventLoop loop;
-    QTimer timer;
-    item->setProperty("WaitForPropertyChangeEventLoop", QVariant::fromValue(&loop));
-    item->setProperty("WaitForPropertyChangePropertyName", propertyName);
-    item->setProperty("WaitForPropertyChangePropertyValue", value);
-    const QMetaMethod propertyChanged = metaObject()->method(metaObject()->indexOfSlot("onPropertyChanged()"));
-    connect(item, prop.notifySignal(), this, propertyChanged);
-    connect(&timer, &QTimer::timeout, &loop, &QEventLoop::quit);
-    timer.start(timeout);
-    loop.exec();
-    disconnect(item, prop.notifySignal(), this, propertyChanged);
-}
-
-bool GenericEnginePlatform::checkMatch(const QString &pattern, const QString &value)
-{
-    if (value.isEmpty()) {
-        return false;
-    }
-    if (pattern.startsWith('/')) {
-        QRegExp rx(pattern);
-        if (rx.exactMatch(value)) {
-            return true;
-        }
-    } else if (pattern.contains('*')) {
-        QRegExp rx(pattern);
-        rx.setPatternSyntax(QRegExp::Wildcard);
-        if (rx.exactMatch(value)) {
-            return true;
-        }
-    } else {
-        return value == pattern;
+        done();
     }
 }
 
 void GenericEnginePlatform::execute(ITransportClient *socket, const QString &methodName, const QVariantList &params)
 {
-    bool handled = false;
-    bool success = QAEngine::metaInvoke(socket, this, methodName, params, &handled);
+    QString error;
+    const CommandDispatcher::Result result = CommandDispatcher::invoke(socket, this, methodName, params, &error);
 
-    if (!handled || !success) {
+    if (result == CommandDispatcher::InvalidArguments) {
+        socketReply(socket, error, 400);
+    } else if (result != CommandDispatcher::Invoked) {
         qCWarning(categoryGenericEnginePlatform)
             << Q_FUNC_INFO
             << methodName << "not handled!";
@@ -701,24 +1433,6 @@ void GenericEnginePlatform::execute(ITransportClient *socket, const QString &met
     }
 }
 
-void GenericEnginePlatform::onPropertyChanged()
-{
-    QObject *item = sender();
-    QEventLoop *loop = item->property("WaitForPropertyChangeEventLoop").value<QEventLoop*>();
-    if (!loop) {
-        return;
-    }
-    const QString propertyName = item->property("WaitForPropertyChangePropertyName").toString();
-    const QVariant propertyValue = item->property("WaitForPropertyChangePropertyValue");
-    if (!propertyValue.isValid()) {
-        loop->quit();
-    }
-    const QVariant property = item->property(propertyName.toLatin1().constData());
-    if (property == propertyValue) {
-        loop->quit();
-    }
-}
-
 void GenericEnginePlatform::onTouchEvent(const QTouchEvent &event)
 {
     QWindowSystemInterface::handleTouchEvent(
@@ -732,44 +1446,45 @@ void GenericEnginePlatform::onTouchEvent(const QTouchEvent &event)
 
 void GenericEnginePlatform::onMouseEvent(const QMouseEvent &event)
 {
-    m_rootWindow->raise();
-    m_rootWindow->requestActivate();
-    m_rootWindow->setWindowState(Qt::WindowState::WindowActive);
-
-    QEventLoop loop;
-    QTimer::singleShot(100, &loop, &QEventLoop::quit);
-    loop.exec();
-
-    QWindowSystemInterface::handleMouseEvent(
-        m_rootWindow,
-        event.timestamp(),
-        event.localPos(),
-        event.globalPos(),
-        event.buttons(),
+    const ulong timestamp = event.timestamp();
+    const QPointF localPos = event.localPos();
+    const QPointF globalPos = event.globalPos();
+    const Qt::MouseButtons buttons = event.buttons();
+#if QT_VERSION >= QT_VERSION_CHECK(5, 7, 0)
+    const Qt::MouseButton button = event.button();
+    const QEvent::Type type = event.type();
+#endif
+    deliverInput([=]() {
+        QWindowSystemInterface::handleMouseEvent(
+            m_rootWindow,
+            timestamp,
+            localPos,
+            globalPos,
+            buttons,
 #if QT_VERSION >= QT_VERSION_CHECK(5, 7, 0)
-        event.button(),
-        event.type(),
+            button,
+            type,
 #endif
-        Qt::NoModifier,
-        Qt::MouseEventNotSynthesized);
+            Qt::NoModifier,
+            Qt::MouseEventNotSynthesized);
+    });
 }
 
 void GenericEnginePlatform::onKeyEvent(QKeyEvent *event)
 {
-    m_rootWindow->raise();
-    m_rootWindow->requestActivate();
-    m_rootWindow->setWindowState(Qt::WindowState::WindowActive);
-
-    QEventLoop loop;
-    QTimer::singleShot(100, &loop, &QEventLoop::quit);
-    loop.exec();
-
-    QWindowSystemInterface::handleKeyEvent(
-        m_rootWindow,
-        event->type(),
-        event->key(),
-        event->modifiers(),
-        event->text());
+    // event is owned by the key engine and is gone once this slot returns
+    const QEvent::Type type = event->type();
+    const int key = event->key();
+    const Qt::KeyboardModifiers modifiers = event->modifiers();
+    const QString text = event->text();
+    deliverInput([=]() {
+        QWindowSystemInterface::handleKeyEvent(
+            m_rootWindow,
+            type,
+            key,
+            modifiers,
+            text);
+    });
 }
 
 void GenericEnginePlatform::activateAppCommand(ITransportClient *socket, const QString &appName)
@@ -858,19 +1573,20 @@ void GenericEnginePlatform::backgroundCommand(ITransportClient *socket, double s
 
     m_rootWindow->showMinimized();
     m_rootWindow->lower();
-    if (seconds > 0) {
-        QEventLoop loop;
-        QTimer timer;
-        timer.setSingleShot(true);
-        connect(&timer, &QTimer::timeout, &loop, &QEventLoop::quit);
-        timer.start(seconds * 1000);
-        loop.exec();
+    if (seconds <= 0) {
+        socketReply(socket, QString());
+        return;
+    }
+
+    QPointer<ITransportClient> client(socket);
+    QTimer::singleShot(seconds * 1000, this, [this, client]() {
         m_rootWindow->raise();
         m_rootWindow->requestActivate();
         m_rootWindow->setWindowState(Qt::WindowState::WindowActive);
-    }
-
-    socketReply(socket, QString());
+        if (client) {
+            socketReply(client, QString());
+        }
+    });
 }
 
 void GenericEnginePlatform::getClipboardCommand(ITransportClient *socket)
@@ -980,7 +1696,7 @@ void GenericEnginePlatform::getAttributeCommand(ITransportClient *socket, const
 
     QObject *item = getObject(elementId);
     if (item) {
-        const QVariant reply = item->property(attribute.toLatin1().constData());
+        const QVariant reply = readProperty(item, attribute);
         socketReply(socket, reply);
     } else {
         socketReply(socket, QString());
@@ -995,7 +1711,7 @@ void GenericEnginePlatform::getPropertyCommand(ITransportClient *socket, const Q
 
     QObject *item = getObject(elementId);
     if (item) {
-        const QVariant reply = item->property(attribute.toLatin1().constData());
+        const QVariant reply = readProperty(item, attribute);
         socketReply(socket, reply);
     } else {
         socketReply(socket, QString());
@@ -1140,8 +1856,7 @@ void GenericEnginePlatform::clickCommand(ITransportClient *socket, const QString
 
     QObject *item = getObject(elementId);
     if (item) {
-        clickItem(item);
-        socketReply(socket, QString());
+        replyWhenCompleted(socket, startClickItem(item));
     } else {
         socketReply(socket, QString(), 1);
     }
@@ -1162,8 +1877,7 @@ void GenericEnginePlatform::submitCommand(ITransportClient *socket, const QStrin
         << Q_FUNC_INFO
         << socket << elementId;
 
-    m_keyEngine->pressEnter(1);
-    socketReply(socket, QString());
+    replyWhenCompleted(socket, settle(m_keyEngine->pressEnter(1), 0));
 }
 
 void GenericEnginePlatform::getPageSourceCommand(ITransportClient *socket)
@@ -1227,7 +1941,9 @@ void GenericEnginePlatform::implicitWaitCommand(ITransportClient *socket, double
     qCDebug(categoryGenericEnginePlatform)
         << Q_FUNC_INFO
         << socket << msecs;
-    socketReply(socket, QStringLiteral("not_implemented"), 405);
+
+    m_implicitWait = qMax(0, qRound(msecs));
+    socketReply(socket, QString());
 }
 
 void GenericEnginePlatform::activeCommand(ITransportClient *socket)
@@ -1346,12 +2062,7 @@ void GenericEnginePlatform::performTouchCommand(ITransportClient *socket, const
         << Q_FUNC_INFO
         << socket << paramsArg;
 
-    QEventLoop loop;
-    connect(m_mouseEngine->performTouchAction(paramsArg.toList()),
-            &QAPendingEvent::completed, &loop, &QEventLoop::quit);
-    loop.exec();
-
-    socketReply(socket, QString());
+    replyWhenCompleted(socket, settle(m_mouseEngine->performTouchAction(paramsArg.toList()), 0));
 }
 
 void GenericEnginePlatform::performMultiActionCommand(ITransportClient *socket, const QVariant &paramsArg)
@@ -1360,12 +2071,7 @@ void GenericEnginePlatform::performMultiActionCommand(ITransportClient *socket,
         << Q_FUNC_INFO
         << socket << paramsArg;
 
-    QEventLoop loop;
-    connect(m_mouseEngine->performMultiAction(paramsArg.toList()),
-            &QAPendingEvent::completed, &loop, &QEventLoop::quit);
-    loop.exec();
-
-    socketReply(socket, QString());
+    replyWhenCompleted(socket, settle(m_mouseEngine->performMultiAction(paramsArg.toList()), 0));
 }
 
 void GenericEnginePlatform::performActionsCommand(ITransportClient *socket, const QVariant &paramsArg)
@@ -1397,9 +2103,77 @@ void GenericEnginePlatform::performActionsCommand(ITransportClient *socket, cons
     socketReply(socket, QString());
 }
 
+void GenericEnginePlatform::updateSettingsCommand(ITransportClient *socket, const QVariantMap &settings)
+{
+    qCDebug(categoryGenericEnginePlatform)
+        << Q_FUNC_INFO
+        << socket << settings;
+
+    for (auto it = settings.constBegin(); it != settings.constEnd(); ++it) {
+        m_settings.insert(it.key(), it.value());
+    }
+
+    if (settings.contains(QStringLiteral("snapshotThreads"))) {
+        const int threads = settings.value(QStringLiteral("snapshotThreads")).toInt();
+        m_snapshotPool->setMaxThreadCount(threads > 0 ? threads : QThread::idealThreadCount());
+    }
+    if (settings.contains(QStringLiteral("snapshotMode")) || settings.contains(QStringLiteral("snapshotProperties"))) {
+        m_snapshot.clear();
+    }
+
+    QAObjectIndex *index = QAEngine::instance()->objectIndex();
+    if (index && settings.contains(QStringLiteral("textIndex"))) {
+        if (settings.value(QStringLiteral("textIndex")).toBool()) {
+            // index is owned by the engine and may outlive the platform
+            QPointer<GenericEnginePlatform> platform(this);
+            index->setTextReader([platform](QObject *item, QVector<int> *notifySignals) {
+                if (!platform) {
+                    return QString();
+                }
+                const QSharedPointer<const QAPropertySchema> schema = platform->propertySchema(item);
+                if (notifySignals) {
+                    *notifySignals = schema->textNotifySignals();
+                }
+                return schema->textProperties().isEmpty() ? QString() : platform->getText(item);
+            });
+        } else {
+            index->setTextReader(QAObjectIndex::TextReader());
+        }
+    }
+
+    socketReply(socket, QString());
+}
+
+void GenericEnginePlatform::getSettingsCommand(ITransportClient *socket)
+{
+    qCDebug(categoryGenericEnginePlatform)
+        << Q_FUNC_INFO
+        << socket;
+
+    QVariantMap settings = m_settings;
+    if (!settings.contains(QStringLiteral("snapshotMode"))) {
+        settings.insert(QStringLiteral("snapshotMode"), false);
+    }
+    if (!settings.contains(QStringLiteral("textIndex"))) {
+        settings.insert(QStringLiteral("textIndex"), false);
+    }
+    if (!settings.contains(QStringLiteral("elementDescriptors"))) {
+        settings.insert(QStringLiteral("elementDescriptors"), false);
+    }
+    if (!settings.contains(QStringLiteral("snapshotThreads"))) {
+        settings.insert(QStringLiteral("snapshotThreads"), m_snapshotPool->maxThreadCount());
+    }
+    socketReply(socket, settings);
+}
+
 void GenericEnginePlatform::findStrategy_id(ITransportClient *socket, const QString &selector, bool multiple, QObject *parentItem)
 {
-    QObject *item = findItemByObjectName(selector, parentItem);
+    QObjectList items = findIndexedItems(QAObjectIndex::ObjectNameKey, selector, parentItem, 1);
+    if (items.isEmpty()) {
+        // object could be renamed after it was indexed
+        items = {findItemByObjectName(selector, parentItem)};
+    }
+    QObject *item = items.first();
     qCDebug(categoryGenericEnginePlatform)
         << Q_FUNC_INFO
         << selector << multiple << item;
@@ -1413,7 +2187,7 @@ void GenericEnginePlatform::findStrategy_objectName(ITransportClient *socket, co
 
 void GenericEnginePlatform::findStrategy_classname(ITransportClient *socket, const QString &selector, bool multiple, QObject *parentItem)
 {
-    QObjectList items = findItemsByClassName(selector, parentItem);
+    QObjectList items = findIndexedItems(QAObjectIndex::ClassNameKey, selector, parentItem, multiple ? -1 : 1);
     qCDebug(categoryGenericEnginePlatform)
         << Q_FUNC_INFO
         << selector << multiple << items;
@@ -1422,7 +2196,7 @@ void GenericEnginePlatform::findStrategy_classname(ITransportClient *socket, con
 
 void GenericEnginePlatform::findStrategy_name(ITransportClient *socket, const QString &selector, bool multiple, QObject *parentItem)
 {
-    QObjectList items = findItemsByText(selector, false, parentItem);
+    QObjectList items = findItemsByText(QAMatcher::cached(selector), parentItem, multiple ? -1 : 1);
     qCDebug(categoryGenericEnginePlatform)
         << Q_FUNC_INFO
         << selector << multiple << items;
@@ -1448,7 +2222,7 @@ void GenericEnginePlatform::findStrategy_parent(ITransportClient *socket, const
 
 void GenericEnginePlatform::findStrategy_xpath(ITransportClient *socket, const QString &selector, bool multiple, QObject *parentItem)
 {
-    QObjectList items = findItemsByXpath(selector, parentItem);
+    QObjectList items = findItemsByXpath(selector, parentItem, multiple ? -1 : 1);
     qCDebug(categoryGenericEnginePlatform) << Q_FUNC_INFO << selector << multiple << items;
     elementReply(socket, items, multiple);
 }
@@ -1459,8 +2233,389 @@ void GenericEnginePlatform::executeCommand_app_dumpTree(ITransportClient *socket
         << Q_FUNC_INFO
         << socket;
 
-    QJsonObject reply = recursiveDumpTree(m_rootObject);
-    socketReply(socket, qCompress(QJsonDocument(reply).toJson(QJsonDocument::Compact), 9).toBase64());
+    QAReplyStream out(socket, QAReplyStream::CompressedBase64);
+    recursiveDumpTree(&out, m_rootObject);
+}
+
+void GenericEnginePlatform::executeCommand_app_dumpTreeDelta(ITransportClient *socket, double token)
+{
+    qCDebug(categoryGenericEnginePlatform)
+        << Q_FUNC_INFO
+        << socket << token;
+
+    collectTreeChanges();
+
+    QSharedPointer<const DumpState> base;
+    for (const QSharedPointer<const DumpState> &state : m_dumpStates) {
+        if (state->generation == int(token)) {
+            base = state;
+            break;
+        }
+    }
+    const int baseGeneration = base ? base->generation : 0;
+    QVector<bool> seen(base ? base->nodes.size() : 0, false);
+
+    QSharedPointer<DumpState> state(new DumpState);
+    state->generation = m_treeGeneration;
+
+    // added items are written while the tree is walked, a full resync is never held as a whole
+    QAReplyStream out(socket);
+    out.write(QStringLiteral("{\"token\":%1,\"full\":%2,").arg(state->generation).arg(base ? QStringLiteral("false") : QStringLiteral("true")));
+    if (base) {
+        out.write(QStringLiteral("\"base\":%1,").arg(base->generation));
+    }
+    out.write(QByteArrayLiteral("\"added\":["));
+    int added = 0;
+
+    QJsonArray changed;
+    const auto addChange = [&changed](const QString &id, const QJsonObject &before, const QJsonObject &after) {
+        QJsonObject diff = diffProperties(before, after);
+        if (!diff.isEmpty()) {
+            diff.insert(QStringLiteral("id"), id);
+            changed.append(diff);
+        }
+    };
+
+    struct Entry {
+        QObject *item;
+        int parent;
+        int depth;
+        bool ancestorChanged;
+        GeometryContext context;
+    };
+
+    // same walk as treeSnapshot, unchanged subtrees are taken from the base tree as is
+    QVector<Entry> stack;
+    if (m_rootObject) {
+        stack.append({m_rootObject, -1, 0, false, geometryContext(m_rootObject)});
+    }
+    int copied = 0;
+    while (!stack.isEmpty()) {
+        const Entry entry = stack.takeLast();
+        QObject *item = entry.item;
+        const QString id = markupId(item);
+        const QJsonValue parentId = entry.parent < 0 ? QJsonValue() : QJsonValue(state->nodes.at(entry.parent).id);
+        const int node = state->nodes.size();
+
+        // handles of destroyed objects are never reused, a different id is a different item
+        int baseNode = base ? base->indexByObject.value(item, -1) : -1;
+        if (baseNode >= 0 && base->nodes.at(baseNode).id != id) {
+            baseNode = -1;
+        }
+
+        if (baseNode >= 0 && !entry.ancestorChanged && !isSubtreeChanged(item, baseGeneration)) {
+            const int end = base->nodes.at(baseNode).subtreeEnd;
+            for (int i = baseNode; i < end; i++) {
+                DumpNode copy = base->nodes.at(i);
+                copy.parent = i == baseNode ? entry.parent : copy.parent + node - baseNode;
+                copy.subtreeEnd += node - baseNode;
+                state->indexByObject.insert(copy.item, state->nodes.size());
+                m_items.pin(copy.id);
+                state->nodes.append(copy);
+                seen[i] = true;
+            }
+            copied += end - baseNode;
+
+            // descendants keep their places, only the subtree root may have moved
+            QJsonObject &properties = state->nodes[node].properties;
+            properties.insert(QStringLiteral("parent"), parentId);
+            properties.insert(QStringLiteral("zDepth"), entry.depth);
+            addChange(id, base->nodes.at(baseNode).properties, properties);
+            continue;
+        }
+
+        // geometry of descendants follows changed item, so its whole subtree is read again
+        const bool itemChanged = baseNode < 0 || entry.ancestorChanged || isItemChanged(item, baseGeneration);
+
+        DumpNode current;
+        current.item = item;
+        current.id = id;
+        current.parent = entry.parent;
+        current.subtreeEnd = node + 1;
+        if (itemChanged) {
+            watchItem(item);
+            current.properties = dumpObject(item, entry.depth, entry.context);
+        } else {
+            current.properties = base->nodes.at(baseNode).properties;
+            current.properties.insert(QStringLiteral("zDepth"), entry.depth);
+        }
+        current.properties.insert(QStringLiteral("parent"), parentId);
+
+        if (baseNode < 0) {
+            if (added++ > 0) {
+                out.write(QByteArrayLiteral(","));
+            }
+            out.write(QJsonDocument(current.properties).toJson(QJsonDocument::Compact));
+        } else {
+            seen[baseNode] = true;
+            addChange(id, base->nodes.at(baseNode).properties, current.properties);
+        }
+        state->indexByObject.insert(item, node);
+        m_items.pin(id);
+        state->nodes.append(current);
+
+        const QObjectList children = childrenList(item);
+        for (int i = children.size() - 1; i >= 0; i--) {
+            QObject *child = children.at(i);
+            stack.append({child, node, i + 1, itemChanged, childGeometryContext(child, entry.context)});
+        }
+    }
+
+    // preorder, every subtree ends where the last subtree of its children does
+    for (int node = state->nodes.size() - 1; node > 0; node--) {
+        DumpNode &parent = state->nodes[state->nodes.at(node).parent];
+        parent.subtreeEnd = qMax(parent.subtreeEnd, state->nodes.at(node).subtreeEnd);
+    }
+
+    QJsonArray removed;
+    for (int i = 0; i < seen.size(); i++) {
+        if (!seen.at(i)) {
+            removed.append(base->nodes.at(i).id);
+        }
+    }
+
+    qCDebug(categoryGenericEnginePlatform)
+        << Q_FUNC_INFO
+        << baseGeneration << m_treeGeneration << state->nodes.size() << copied
+        << added << changed.size() << removed.size();
+
+    for (int i = 0; i < m_dumpStates.size(); i++) {
+        if (m_dumpStates.at(i)->generation == state->generation) {
+            unpinDumpState(*m_dumpStates.takeAt(i));
+            break;
+        }
+    }
+    m_dumpStates.prepend(state);
+    while (m_dumpStates.size() > c_dumpStatesLimit) {
+        unpinDumpState(*m_dumpStates.takeLast());
+    }
+
+    out.write(QByteArrayLiteral("],\"changed\":"));
+    out.write(QJsonDocument(changed).toJson(QJsonDocument::Compact));
+    out.write(QByteArrayLiteral(",\"removed\":"));
+    out.write(QJsonDocument(removed).toJson(QJsonDocument::Compact));
+    out.write(QByteArrayLiteral("}"));
+}
+
+void GenericEnginePlatform::unpinDumpState(const DumpState &state)
+{
+    for (const DumpNode &node : state.nodes) {
+        m_items.unpin(node.id);
+    }
+}
+
+void GenericEnginePlatform::executeCommand_app_treeGeneration(ITransportClient *socket)
+{
+    qCDebug(categoryGenericEnginePlatform)
+        << Q_FUNC_INFO
+        << socket;
+
+    collectTreeChanges();
+    socketReply(socket, m_treeGeneration);
+}
+
+void GenericEnginePlatform::executeCommand_app_getAttributes(ITransportClient *socket, const QVariantList &elementIds, const QVariantList &attributes)
+{
+    qCDebug(categoryGenericEnginePlatform)
+        << Q_FUNC_INFO
+        << socket << elementIds.size() << attributes;
+
+    enum Column {
+        PropertyColumn,
+        TextColumn,
+        RectColumn,
+        AbsRectColumn,
+        VisibleColumn,
+        EnabledColumn,
+    };
+
+    QStringList names;
+    QVector<Column> kinds;
+    for (const QVariant &attribute : attributes) {
+        const QString name = attribute.toString();
+        names.append(name);
+        if (name == QLatin1String("text")) {
+            kinds.append(TextColumn);
+        } else if (name == QLatin1String("rect")) {
+            kinds.append(RectColumn);
+        } else if (name == QLatin1String("absRect")) {
+            kinds.append(AbsRectColumn);
+        } else if (name == QLatin1String("visible")) {
+            kinds.append(VisibleColumn);
+        } else if (name == QLatin1String("enabled")) {
+            kinds.append(EnabledColumn);
+        } else {
+            kinds.append(PropertyColumn);
+        }
+    }
+
+    const auto rectValue = [](const QRect &rect) {
+        return QJsonArray({rect.x(), rect.y(), rect.width(), rect.height()});
+    };
+
+    // property indexes are resolved once per class
+    QHash<const QAPropertySchema*, QVector<int>> resolved;
+    QVector<QJsonArray> columns(names.size());
+    for (const QVariant &elementId : elementIds) {
+        QObject *item = getObject(elementId.toString());
+        if (!item) {
+            for (QJsonArray &column : columns) {
+                column.append(QJsonValue());
+            }
+            continue;
+        }
+
+        const QSharedPointer<const QAPropertySchema> schema = propertySchema(item);
+        auto indexes = resolved.find(schema.data());
+        if (indexes == resolved.end()) {
+            QVector<int> propertyIndexes;
+            for (const QString &name : names) {
+                propertyIndexes.append(schema->indexOfProperty(name));
+            }
+            indexes = resolved.insert(schema.data(), propertyIndexes);
+        }
+
+        const QMetaObject *mo = item->metaObject();
+        for (int i = 0; i < names.size(); i++) {
+            switch (kinds.at(i)) {
+            case TextColumn:
+                columns[i].append(getText(item));
+                break;
+            case RectColumn:
+                columns[i].append(rectValue(getGeometry(item)));
+                break;
+            case AbsRectColumn:
+                columns[i].append(rectValue(getAbsGeometry(item)));
+                break;
+            case VisibleColumn:
+                columns[i].append(isItemVisible(item));
+                break;
+            case EnabledColumn:
+                columns[i].append(isItemEnabled(item));
+                break;
+            case PropertyColumn: {
+                const int propertyIndex = indexes->at(i);
+                const QVariant value = propertyIndex < 0
+                    ? item->property(names.at(i).toLatin1().constData())
+                    : mo->property(propertyIndex).read(item);
+                columns[i].append(QJsonValue::fromVariant(value));
+                break;
+            }
+            }
+        }
+    }
+
+    QJsonObject table;
+    for (int i = 0; i < names.size(); i++) {
+        table.insert(names.at(i), columns.at(i));
+    }
+
+    QJsonObject reply;
+    reply.insert(QStringLiteral("ids"), QJsonArray::fromVariantList(elementIds));
+    reply.insert(QStringLiteral("columns"), table);
+    socketReply(socket, reply);
+}
+
+void GenericEnginePlatform::executeCommand_app_elementAtPoint(ITransportClient *socket, double posx, double posy)
+{
+    qCDebug(categoryGenericEnginePlatform)
+        << Q_FUNC_INFO
+        << socket << posx << posy;
+
+    const QSharedPointer<const QASpatialIndex> index = spatialIndex();
+    for (int node : index->nodesAt(QPoint(posx, posy))) {
+        QObject *item = index->snapshot()->object(node);
+        if (item) {
+            elementReply(socket, {item});
+            return;
+        }
+    }
+    elementReply(socket, {});
+}
+
+void GenericEnginePlatform::executeCommand_app_elementsInRect(ITransportClient *socket, double posx, double posy, double width, double height)
+{
+    qCDebug(categoryGenericEnginePlatform)
+        << Q_FUNC_INFO
+        << socket << posx << posy << width << height;
+
+    const QSharedPointer<const QASpatialIndex> index = spatialIndex();
+    QObjectList items;
+    for (int node : index->nodesIn(QRect(posx, posy, width, height))) {
+        QObject *item = index->snapshot()->object(node);
+        if (item) {
+            items.append(item);
+        }
+    }
+    elementReply(socket, items, true);
+}
+
+void GenericEnginePlatform::executeCommand_app_waitFor(ITransportClient *socket, const QString &strategy, const QString &selector, const QString &condition, const QVariant &value, double timeout)
+{
+    qCDebug(categoryGenericEnginePlatform)
+        << Q_FUNC_INFO
+        << socket << strategy << selector << condition << value << timeout;
+
+    const bool presence = condition == QLatin1String("appears") || condition == QLatin1String("disappears");
+    const int limit = presence ? 1 : -1;
+
+    QByteArray watchedProperty;
+    std::function<bool(QObject*)> filter;
+    if (condition == QLatin1String("visible")) {
+        watchedProperty = QByteArrayLiteral("visible");
+        filter = [this](QObject *item) { return isItemVisible(item); };
+    } else if (condition == QLatin1String("enabled")) {
+        watchedProperty = QByteArrayLiteral("enabled");
+        filter = [this](QObject *item) { return isItemEnabled(item); };
+    } else if (condition == QLatin1String("property")) {
+        const QVariantMap property = value.toMap();
+        const QString name = property.value(QStringLiteral("name")).toString();
+        const QString expected = property.value(QStringLiteral("value")).toString();
+        if (name.isEmpty()) {
+            socketReply(socket, QStringLiteral("waitFor: property condition needs {\"name\", \"value\"}"), 400);
+            return;
+        }
+        watchedProperty = name.toLatin1();
+        filter = [this, name, expected](QObject *item) { return readProperty(item, name).toString() == expected; };
+    } else if (!presence && condition != QLatin1String("count")) {
+        socketReply(socket, QStringLiteral("waitFor: unknown condition %1").arg(condition), 400);
+        return;
+    }
+
+    const int count = condition == QLatin1String("count") ? value.toInt() : 1;
+    const bool disappears = condition == QLatin1String("disappears");
+    QAConditionWatcher *watcher = new QAConditionWatcher(socket, [this, strategy, selector, limit, filter, count, disappears](QObjectList *items) {
+        *items = findItems(strategy, selector, nullptr, limit);
+        if (disappears) {
+            return items->isEmpty();
+        }
+        if (filter) {
+            QObjectList matched;
+            for (QObject *item : *items) {
+                if (filter(item)) {
+                    matched.append(item);
+                }
+            }
+            // items failing the filter are kept watched
+            if (matched.size() < count) {
+                return false;
+            }
+            *items = matched;
+        }
+        return items->size() >= count;
+    }, timeout);
+    watcher->setWatchedProperty(watchedProperty);
+    connect(watcher, &QAConditionWatcher::finished, this, [this](ITransportClient *client, const QObjectList &items, bool satisfied) {
+        if (satisfied) {
+            elementReply(client, items, true);
+        } else {
+            socketReply(client, QStringLiteral("timeout"), 1);
+        }
+    });
+    connect(this, &GenericEnginePlatform::treeChanged, watcher, &QAConditionWatcher::onTreeChanged);
+
+    startWaitPolling(watcher);
+    watcher->start();
 }
 
 void GenericEnginePlatform::executeCommand_app_setAttribute(ITransportClient *socket, const QString &elementId, const QString &attribute, const QVariant &value)
@@ -1480,8 +2635,13 @@ void GenericEnginePlatform::executeCommand_app_waitForPropertyChange(ITransportC
 
     QObject *item = getObject(elementId);
     if (item) {
-        waitForPropertyChange(item, propertyName, value, timeout);
-        socketReply(socket, QString());
+        // reply is sent from the registry callback, other requests are processed meanwhile
+        QPointer<ITransportClient> client(socket);
+        waitForPropertyChange(item, propertyName, value, timeout, [this, client]() {
+            if (client) {
+                socketReply(client, QString());
+            }
+        });
     } else {
         socketReply(socket, QString(), 1);
     }
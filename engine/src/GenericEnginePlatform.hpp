@@ -2,12 +2,34 @@
 #pragma once
 
 #include "IEnginePlatform.hpp"
+#include "QAHandleTable.hpp"
+#include "QAMatcher.hpp"
+#include "QAObjectIndex.hpp"
+#include "QAPropertySchema.hpp"
+#include "QASpatialIndex.hpp"
+#include "QATreeSnapshot.hpp"
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QPointer>
+#include <QRectF>
+#include <QSet>
+#include <QSharedPointer>
+#include <QTransform>
+
+#include <functional>
 
 class QAMouseEngine;
 class QAKeyEngine;
+class QAPendingEvent;
+class QAPropertyWatchRegistry;
+class QAReplyStream;
 class QTouchEvent;
 class QMouseEvent;
 class QKeyEvent;
+class QThreadPool;
+class QTimer;
 class QWindow;
 class QXmlStreamWriter;
 
@@ -26,7 +48,10 @@ public:
     void removeItem(QObject *o) override;
 
     static QString getClassName(QObject *item);
-    static QString uniqueId(QObject *item);
+    // handle of a find result
+    QString uniqueId(QObject *item);
+    // id written into markup, never evicts handles of find results
+    QString markupId(QObject *item);
 
     bool containsObject(const QString &elementId) override;
     QObject *getObject(const QString &elementId) override;
@@ -34,54 +59,189 @@ public:
     QRect getGeometry(QObject *item) override;
     QRect getAbsGeometry(QObject *item) override;
 
+signals:
+    // new tree generation has started
+    void treeChanged(int generation);
+    // synthesized input held back during window activation is delivered
+    void inputFlushed();
+
 protected:
     friend class QAMouseEngine;
+    friend class GenericXPathModel;
 
     void findElement(ITransportClient *socket, const QString &strategy, const QString &selector, bool multiple = false, QObject *item = nullptr);
+    void waitForElement(ITransportClient *socket, const QString &strategy, const QString &selector, bool multiple = false, QObject *item = nullptr);
+    void startWaitPolling(QObject *wait);
+    QObjectList findItems(const QString &strategy, const QString &selector, QObject *parentItem = nullptr, int limit = -1);
     void findByProperty(ITransportClient *socket, const QString &propertyName, const QVariant &propertyValue, bool multiple = false, QObject *parentItem = nullptr);
+    virtual bool findInSnapshot(ITransportClient *socket, const QString &strategy, const QString &selector, bool multiple = false, QObject *parentItem = nullptr);
     void setProperty(ITransportClient *socket, const QString &property, const QVariant &value, const QString &elementId);
 
     virtual QList<QObject*> childrenList(QObject* parentItem) = 0;
+    void collectItems(QObject *parentItem, const std::function<bool(QObject*)> &predicate, QObjectList *items, int limit = -1);
     QObject *findItemByObjectName(const QString &objectName, QObject *parentItem = nullptr);
-    QObjectList findItemsByClassName(const QString &className, QObject *parentItem = nullptr);
-    QObjectList findItemsByProperty(const QString &propertyName, const QVariant &propertyValue, QObject *parentItem = nullptr);
-    QObjectList findItemsByText(const QString &text, bool partial = true, QObject *parentItem = nullptr);
-    QObjectList findItemsByXpath(const QString &xpath, QObject *parentItem = nullptr);
+    QObject *findItemByObjectName(const QAMatcher &matcher, QObject *parentItem = nullptr);
+    QObjectList findItemsByClassName(const QString &className, QObject *parentItem = nullptr, int limit = -1);
+    QObjectList findItemsByClassName(const QAMatcher &matcher, QObject *parentItem = nullptr, int limit = -1);
+    QObjectList findItemsByProperty(const QString &propertyName, const QVariant &propertyValue, QObject *parentItem = nullptr, int limit = -1);
+    QObjectList findItemsByProperty(const QByteArray &propertyName, const QAMatcher &matcher, QObject *parentItem = nullptr, int limit = -1);
+    QObjectList findItemsByText(const QString &text, bool partial = true, QObject *parentItem = nullptr, int limit = -1);
+    QObjectList findItemsByText(const QAMatcher &matcher, QObject *parentItem = nullptr, int limit = -1);
+    QObjectList findItemsByXpath(const QString &xpath, QObject *parentItem = nullptr, int limit = -1);
+    QObjectList findIndexedItems(QAObjectIndex::Key key, const QString &pattern, QObject *parentItem = nullptr, int limit = -1);
+    QObjectList findIndexedItems(QAObjectIndex::Key key, const QAMatcher &matcher, QObject *parentItem = nullptr, int limit = -1);
+    QObjectList sortInTreeOrder(const QObjectList &items, QObject *parentItem);
     QObjectList filterVisibleItems(QObjectList items);
 
+    // absolute placement carried down a top-down walk: each child is placed
+    // relative to its parent instead of mapping through the whole parent chain
+    struct GeometryContext {
+        QPoint absPosition;
+        QTransform transform;   // item to root item coordinates
+        QRectF clipRect;        // clip of ancestors in root item coordinates
+        bool clipped = false;
+        bool visible = true;
+    };
+    virtual GeometryContext geometryContext(QObject *item);
+    virtual GeometryContext childGeometryContext(QObject *child, const GeometryContext &parent);
+    // stacking order among siblings, items of platforms without it stack in children order
+    virtual qreal getZ(QObject *item);
+
+    QSharedPointer<const QAPropertySchema> propertySchema(QObject *item);
+    QVariant readProperty(QObject *item, const QString &name);
+
+    QVariant setting(const QString &name, const QVariant &defaultValue = QVariant()) const;
+    QSharedPointer<const QATreeSnapshot> treeSnapshot();
+    void snapshotItem(QATreeSnapshot *snapshot, QObject *item, int node, const GeometryContext &context);
+    QSharedPointer<const QASpatialIndex> spatialIndex();
+
+    // tree change tracking, every detected change starts a new tree generation.
+    // Text, visible and enabled notify signals of items read by snapshots and
+    // dumps mark them changed. Platforms able to report changed items override
+    // collectTreeChanges, otherwise the whole tree is considered changed on every
+    // object creation or destruction and after c_treeMaxAge.
+    virtual void collectTreeChanges();
+    void watchItem(QObject *item);
+    void markItemChanged(QObject *item);
+    void markItemsChanged(const QObjectList &items);
+    void markTreeChanged();
+    bool isTreeExpired() const;
+    bool isItemChanged(QObject *item, int generation) const;
+    bool isSubtreeChanged(QObject *item, int generation) const;
+
+    // page source with start tags of unchanged items taken from cache,
+    // written to the stream during the traversal
+    void pageSource(QAReplyStream *out);
+    void appendPageSource(QAReplyStream *out, QObject *item, int depth, bool ancestorChanged, const GeometryContext &context);
+    void writeXmlStartElement(QXmlStreamWriter *writer, QObject *item, int depth, const GeometryContext &context);
+
     QJsonObject dumpObject(QObject *item, int depth = 0);
-    QJsonObject recursiveDumpTree(QObject *rootItem, int depth = 0);
+    QJsonObject dumpObject(QObject *item, int depth, const GeometryContext &context);
+    // json tree written node by node, children follow other keys of the node
+    void recursiveDumpTree(QAReplyStream *out, QObject *rootItem, int depth = 0);
+    void recursiveDumpTree(QAReplyStream *out, QObject *rootItem, int depth, const GeometryContext &context);
     void recursiveDumpXml(QXmlStreamWriter *writer, QObject *rootItem, int depth = 0);
+    void recursiveDumpXml(QXmlStreamWriter *writer, QObject *rootItem, int depth, const GeometryContext &context);
 
     virtual void grabScreenshot(ITransportClient *socket, QObject *item, bool fillBackground = false) = 0;
-    void clickItem(QObject *item);
 
-    void clickPoint(int posx, int posy);
-    void clickPoint(const QPoint &pos);
-    virtual void pressAndHoldItem(QObject *item, int delay = 800) = 0;
-    void pressAndHold(int posx, int posy, int delay = 800);
-    void mouseMove(int startx, int starty, int stopx, int stopy);
-    void mouseDrag(int startx, int starty, int stopx, int stopy, int delay = 1200);
-    void processTouchActionList(const QVariant &actionListArg);
-    void waitForPropertyChange(QObject *item, const QString &propertyName, const QVariant &value, int timeout = 10000);
+    // input is performed without blocking, returned events complete once
+    // all synthesized events are delivered and the ui had time to react
+    QAPendingEvent *startClickItem(QObject *item);
+    QAPendingEvent *startClick(const QPoint &pos);
+    QAPendingEvent *startPressAndHoldItem(QObject *item, int delay = 800);
+    QAPendingEvent *startPressAndHold(const QPoint &pos, int delay = 800);
+    QAPendingEvent *startMouseMove(const QPoint &start, const QPoint &stop);
+    QAPendingEvent *startMouseDrag(const QPoint &start, const QPoint &stop, int delay = 1200);
+    QAPendingEvent *settle(QAPendingEvent *event, int delay);
+    // gestures composed of several steps continue from done instead of waiting
+    void whenCompleted(QAPendingEvent *event, const std::function<void()> &done);
+    void replyWhenCompleted(ITransportClient *socket, QAPendingEvent *event);
+    // empty reply sent once called, if the client is still there
+    std::function<void()> replyWhenDone(ITransportClient *socket);
+    void clickItems(const QList<QPointer<QObject>> &items, const std::function<void()> &done);
+    void deliverInput(const std::function<void()> &deliver);
 
-    bool checkMatch(const QString &pattern, const QString &value);
+    // done is called once the value is reached, on timeout or right away if there is nothing to wait for
+    void waitForPropertyChange(QObject *item, const QString &propertyName, const QVariant &value, int timeout, const std::function<void()> &done);
 
     QWindow *m_rootWindow = nullptr;
     QObject *m_rootObject = nullptr;
 
-    QHash<QString, QObject*> m_items;
+    QAHandleTable m_items;
     QAMouseEngine *m_mouseEngine = nullptr;
     QAKeyEngine *m_keyEngine = nullptr;
 
+    // schemas are built against this list, clear m_propertySchemas when it changes
     QHash<QString, QStringList> m_blacklistedProperties;
+    QHash<const void*, QSharedPointer<const QAPropertySchema>> m_propertySchemas;
+
+    QVariantMap m_settings;
+
+    // snapshot is reused by consecutive queries until the tree changes
+    QSharedPointer<const QATreeSnapshot> m_snapshot;
+    QThreadPool *m_snapshotPool = nullptr;
+
+    // findElement* retries for this long until something is found, 0 replies at once
+    int m_implicitWait = 0;
+    // checks for changes not reported by the platform while lookups are waiting
+    QTimer *m_waitPollTimer = nullptr;
+    int m_waitCount = 0;
+    QAPropertyWatchRegistry *m_propertyWatches = nullptr;
+
+    // synthesized input waits here until the window is activated
+    QVector<std::function<void()>> m_pendingInput;
+    QTimer *m_activationTimer = nullptr;
+    bool m_inputActivated = false;
+    QSharedPointer<const QASpatialIndex> m_spatialIndex;
+
+    int m_treeGeneration = 0;
+    // everything is changed since this generation
+    int m_resetGeneration = 0;
+    // generation of the last change of the item itself and of anything in its subtree
+    QHash<QObject*, int> m_itemGenerations;
+    QHash<QObject*, int> m_subtreeGenerations;
+    QAtomicInt m_treeDirty;
+    QElapsedTimer m_treeAge;
+    // items with connected notify signals, and those emitting since the last collection
+    QSet<QObject*> m_watchedItems;
+    QSet<QObject*> m_changedItems;
+
+    struct PageSourceEntry {
+        QPointer<QObject> item;
+        int generation = -1;
+        // pinned in m_items while the entry holds it
+        QString id;
+        QString startTag;
+        QString endTag;
+    };
+    QHash<QObject*, PageSourceEntry> m_pageSourceCache;
+
+    // trees sent by dumpTreeDelta, nodes in preorder, objects are used as keys only,
+    // ids of the nodes are pinned in m_items until the state is dropped
+    struct DumpNode {
+        QObject *item = nullptr;
+        QString id;
+        int parent = -1;
+        int subtreeEnd = 0;
+        // dumpObject values with parent id
+        QJsonObject properties;
+    };
+    struct DumpState {
+        int generation = 0;
+        QVector<DumpNode> nodes;
+        QHash<QObject*, int> indexByObject;
+    };
+    // most recent first, deltas are computed against any of them
+    QList<QSharedPointer<const DumpState>> m_dumpStates;
 
 private:
     void execute(ITransportClient *socket, const QString &methodName, const QVariantList &params);
+    void unpinDumpState(const DumpState &state);
 
 private slots:
-    // own stuff
-    void onPropertyChanged();
+    void flushInput();
+    void onItemPropertyChanged();
 
     // synthesized input events
     virtual void onTouchEvent(const QTouchEvent &event);
@@ -141,6 +301,8 @@ private slots:
     virtual void performTouchCommand(ITransportClient *socket, const QVariant &paramsArg) override;
     virtual void performMultiActionCommand(ITransportClient *socket, const QVariant &paramsArg) override;
     virtual void performActionsCommand(ITransportClient *socket, const QVariant &paramsArg) override;
+    virtual void updateSettingsCommand(ITransportClient *socket, const QVariantMap &settings) override;
+    virtual void getSettingsCommand(ITransportClient *socket) override;
 
     // findElement_%1 methods
     void findStrategy_id(ITransportClient *socket, const QString &selector, bool multiple = false, QObject *parentItem = nullptr);
@@ -152,7 +314,13 @@ private slots:
 
     // execute_%1 methods
     void executeCommand_app_dumpTree(ITransportClient *socket);
+    void executeCommand_app_dumpTreeDelta(ITransportClient *socket, double token = -1);
+    void executeCommand_app_treeGeneration(ITransportClient *socket);
+    void executeCommand_app_getAttributes(ITransportClient *socket, const QVariantList &elementIds, const QVariantList &attributes);
+    void executeCommand_app_elementAtPoint(ITransportClient *socket, double posx, double posy);
+    void executeCommand_app_elementsInRect(ITransportClient *socket, double posx, double posy, double width, double height);
     void executeCommand_app_setAttribute(ITransportClient *socket, const QString &elementId, const QString &attribute, const QVariant &value);
+    void executeCommand_app_waitFor(ITransportClient *socket, const QString &strategy, const QString &selector, const QString &condition, const QVariant &value = QVariant(), double timeout = 10000);
     void executeCommand_app_waitForPropertyChange(ITransportClient *socket, const QString &elementId, const QString &propertyName, const QVariant &value, double timeout = 3000);
 
 };
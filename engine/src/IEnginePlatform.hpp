@@ -90,6 +90,8 @@ private slots:
     virtual void performTouchCommand(ITransportClient *socket, const QVariant &paramsArg) = 0;
     virtual void performMultiActionCommand(ITransportClient *socket, const QVariant &paramsArg) = 0;
     virtual void performActionsCommand(ITransportClient *socket, const QVariant &paramsArg) = 0;
+    virtual void updateSettingsCommand(ITransportClient *socket, const QVariantMap &settings) = 0;
+    virtual void getSettingsCommand(ITransportClient *socket) = 0;
 
 signals:
     void ready();
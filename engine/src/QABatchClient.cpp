@@ -0,0 +1,224 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#include "QABatchClient.hpp"
+
+#include <QDebug>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QTimer>
+
+Q_LOGGING_CATEGORY(categoryBatch, "omp.qaengine.batch", QtWarningMsg)
+
+namespace {
+
+const int c_stepTimeout = 30000;
+
+}
+
+QABatchStepClient::QABatchStepClient(QABatchClient *batch, int step)
+    : ITransportClient(batch)
+    , m_batch(batch)
+    , m_step(step)
+{
+}
+
+qint64 QABatchStepClient::bytesAvailable()
+{
+    return 0;
+}
+
+QByteArray QABatchStepClient::readAll()
+{
+    return QByteArray();
+}
+
+bool QABatchStepClient::isOpen()
+{
+    return m_batch->isOpen();
+}
+
+bool QABatchStepClient::isConnected()
+{
+    return m_batch->isConnected();
+}
+
+void QABatchStepClient::close()
+{
+    m_batch->close();
+}
+
+qint64 QABatchStepClient::write(const QByteArray &data)
+{
+    m_batch->stepReplied(m_step, data);
+    return data.size();
+}
+
+qint64 QABatchStepClient::writeFramePart(const QByteArray &data, bool last)
+{
+    m_parts.append(data);
+    if (last) {
+        const QByteArray reply = m_parts;
+        m_parts.clear();
+        write(reply);
+    }
+    return data.size();
+}
+
+bool QABatchStepClient::flush()
+{
+    return true;
+}
+
+bool QABatchStepClient::waitForBytesWritten(int)
+{
+    return true;
+}
+
+bool QABatchStepClient::waitForReadyRead(int)
+{
+    return false;
+}
+
+QABatchClient::QABatchClient(ITransportClient *client, const QJsonArray &steps, bool abortOnError)
+    : ITransportClient(client)
+    , m_client(client)
+    , m_steps(steps)
+    , m_abortOnError(abortOnError)
+    , m_stepTimer(new QTimer(this))
+{
+    m_stepTimer->setSingleShot(true);
+    m_stepTimer->setInterval(c_stepTimeout);
+    connect(m_stepTimer, &QTimer::timeout, this, &QABatchClient::onStepTimeout);
+}
+
+ITransportClient *QABatchClient::client() const
+{
+    return m_client;
+}
+
+void QABatchClient::start()
+{
+    QMetaObject::invokeMethod(this, "processNextStep", Qt::QueuedConnection);
+}
+
+qint64 QABatchClient::bytesAvailable()
+{
+    return 0;
+}
+
+QByteArray QABatchClient::readAll()
+{
+    return QByteArray();
+}
+
+bool QABatchClient::isOpen()
+{
+    return m_client && m_client->isOpen();
+}
+
+bool QABatchClient::isConnected()
+{
+    return m_client && m_client->isConnected();
+}
+
+void QABatchClient::close()
+{
+    if (m_client) {
+        m_client->close();
+    }
+}
+
+qint64 QABatchClient::write(const QByteArray &data)
+{
+    // steps reply through their own sockets
+    qCWarning(categoryBatch)
+        << Q_FUNC_INFO
+        << "Unexpected reply:" << data;
+    return data.size();
+}
+
+void QABatchClient::stepReplied(int step, const QByteArray &data)
+{
+    if (step != m_currentStep) {
+        qCWarning(categoryBatch)
+            << Q_FUNC_INFO
+            << "Dropping reply of batch step" << step << data;
+        return;
+    }
+    m_currentStep = -1;
+    m_stepTimer->stop();
+
+    const QJsonObject reply = QJsonDocument::fromJson(data).object();
+    addResult(reply.value(QStringLiteral("value")), reply.value(QStringLiteral("status")).toInt(1));
+
+    // let the step finish its own processing before the next one starts
+    QMetaObject::invokeMethod(this, "processNextStep", Qt::QueuedConnection);
+}
+
+bool QABatchClient::flush()
+{
+    return true;
+}
+
+bool QABatchClient::waitForBytesWritten(int)
+{
+    return true;
+}
+
+bool QABatchClient::waitForReadyRead(int)
+{
+    return false;
+}
+
+void QABatchClient::processNextStep()
+{
+    if (!m_client) {
+        deleteLater();
+        return;
+    }
+
+    if (m_aborted || m_results.size() >= m_steps.size()) {
+        emit finished(m_client, m_results);
+        deleteLater();
+        return;
+    }
+
+    const QJsonObject step = m_steps.at(m_results.size()).toObject();
+    const QString action = step.value(QStringLiteral("action")).toString();
+    if (action.isEmpty()) {
+        addResult(QStringLiteral("batch step %1 has no action").arg(m_results.size()), 400);
+        QMetaObject::invokeMethod(this, "processNextStep", Qt::QueuedConnection);
+        return;
+    }
+
+    qCDebug(categoryBatch)
+        << Q_FUNC_INFO
+        << m_results.size() << action;
+
+    m_currentStep = m_results.size();
+    m_stepTimer->start();
+    emit stepRequested(new QABatchStepClient(this, m_currentStep), action, step.value(QStringLiteral("params")).toArray());
+}
+
+void QABatchClient::onStepTimeout()
+{
+    qCWarning(categoryBatch)
+        << Q_FUNC_INFO
+        << "No reply for batch step" << m_results.size();
+
+    m_currentStep = -1;
+    addResult(QStringLiteral("timeout"), 1);
+    processNextStep();
+}
+
+void QABatchClient::addResult(const QJsonValue &value, int status)
+{
+    QJsonObject result;
+    result.insert(QStringLiteral("status"), status);
+    result.insert(QStringLiteral("value"), value);
+    m_results.append(result);
+
+    if (status != 0 && m_abortOnError) {
+        m_aborted = true;
+    }
+}
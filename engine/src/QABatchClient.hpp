@@ -0,0 +1,85 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#ifndef QABATCHCLIENT_HPP
+#define QABATCHCLIENT_HPP
+
+#include "ITransportClient.hpp"
+
+#include <QJsonArray>
+#include <QPointer>
+
+class QTimer;
+class QABatchClient;
+
+// Socket of a single batch step, replies written to it are handed to the batch
+// tagged with the step number, so late replies of timed out steps are dropped
+class QABatchStepClient : public ITransportClient
+{
+    Q_OBJECT
+public:
+    explicit QABatchStepClient(QABatchClient *batch, int step);
+
+    qint64 bytesAvailable() override;
+    QByteArray readAll() override;
+    bool isOpen() override;
+    bool isConnected() override;
+    void close() override;
+    qint64 write(const QByteArray &data) override;
+    qint64 writeFramePart(const QByteArray &data, bool last) override;
+    bool flush() override;
+    bool waitForBytesWritten(int msecs) override;
+    bool waitForReadyRead(int msecs) override;
+
+private:
+    QABatchClient *m_batch = nullptr;
+    int m_step = -1;
+    // reply written in parts is handled once it is complete
+    QByteArray m_parts;
+};
+
+// Runs the steps of a batch action one after another. Every step is processed
+// with its own QABatchStepClient as the socket, so the step reply is captured
+// here instead of being sent to the bridge. The next step is started once the
+// previous one has replied, which keeps asynchronous commands working inside a batch.
+class QABatchClient : public ITransportClient
+{
+    Q_OBJECT
+public:
+    explicit QABatchClient(ITransportClient *client, const QJsonArray &steps, bool abortOnError = false);
+
+    ITransportClient *client() const;
+    void start();
+
+    qint64 bytesAvailable() override;
+    QByteArray readAll() override;
+    bool isOpen() override;
+    bool isConnected() override;
+    void close() override;
+    qint64 write(const QByteArray &data) override;
+    bool flush() override;
+    bool waitForBytesWritten(int msecs) override;
+    bool waitForReadyRead(int msecs) override;
+
+    void stepReplied(int step, const QByteArray &data);
+
+signals:
+    void stepRequested(ITransportClient *socket, const QString &action, const QJsonArray &params);
+    void finished(ITransportClient *socket, const QJsonArray &results);
+
+private slots:
+    void processNextStep();
+    void onStepTimeout();
+
+private:
+    void addResult(const QJsonValue &value, int status);
+
+    QPointer<ITransportClient> m_client;
+    QJsonArray m_steps;
+    QJsonArray m_results;
+    bool m_abortOnError = false;
+    bool m_aborted = false;
+    // step waiting for its reply, -1 when none is
+    int m_currentStep = -1;
+    QTimer *m_stepTimer = nullptr;
+};
+
+#endif // QABATCHCLIENT_HPP
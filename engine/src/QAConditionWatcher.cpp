@@ -0,0 +1,106 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#include "QAConditionWatcher.hpp"
+#include "ITransportClient.hpp"
+
+#include <QDebug>
+#include <QMetaProperty>
+#include <QTimer>
+
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(categoryConditionWatcher, "omp.qaengine.wait.condition", QtWarningMsg)
+
+QAConditionWatcher::QAConditionWatcher(ITransportClient *client, const Condition &condition, int timeout)
+    : QObject(client)
+    , m_client(client)
+    , m_condition(condition)
+    , m_deadlineTimer(new QTimer(this))
+    , m_scheduleSlot(staticMetaObject.indexOfSlot("scheduleEvaluation()"))
+{
+    m_deadlineTimer->setSingleShot(true);
+    m_deadlineTimer->setInterval(timeout);
+    connect(m_deadlineTimer, &QTimer::timeout, this, &QAConditionWatcher::onTimeout);
+}
+
+void QAConditionWatcher::setWatchedProperty(const QByteArray &name)
+{
+    m_watchedProperty = name;
+}
+
+void QAConditionWatcher::start()
+{
+    m_deadlineTimer->start();
+    scheduleEvaluation();
+}
+
+void QAConditionWatcher::onTreeChanged()
+{
+    scheduleEvaluation();
+}
+
+void QAConditionWatcher::scheduleEvaluation()
+{
+    if (m_scheduled || m_finished) {
+        return;
+    }
+    m_scheduled = true;
+    QMetaObject::invokeMethod(this, "evaluate", Qt::QueuedConnection);
+}
+
+void QAConditionWatcher::evaluate()
+{
+    m_scheduled = false;
+    if (m_finished) {
+        return;
+    }
+    if (!m_client) {
+        finish(QObjectList(), false);
+        return;
+    }
+
+    m_evaluations++;
+    QObjectList items;
+    if (m_condition(&items)) {
+        finish(items, true);
+        return;
+    }
+    watch(items);
+}
+
+void QAConditionWatcher::onTimeout()
+{
+    finish(QObjectList(), false);
+}
+
+void QAConditionWatcher::watch(const QObjectList &items)
+{
+    if (m_watchedProperty.isEmpty()) {
+        return;
+    }
+
+    for (QObject *item : items) {
+        const QMetaObject *mo = item->metaObject();
+        const QMetaProperty property = mo->property(mo->indexOfProperty(m_watchedProperty.constData()));
+        if (property.hasNotifySignal()) {
+            QMetaObject::connect(item, property.notifySignalIndex(), this, m_scheduleSlot, Qt::UniqueConnection);
+        }
+    }
+}
+
+void QAConditionWatcher::finish(const QObjectList &items, bool satisfied)
+{
+    if (m_finished) {
+        return;
+    }
+    m_finished = true;
+    m_deadlineTimer->stop();
+
+    qCDebug(categoryConditionWatcher)
+        << Q_FUNC_INFO
+        << satisfied << m_evaluations << items.size();
+
+    if (m_client) {
+        emit finished(m_client, items, satisfied);
+    }
+    deleteLater();
+}
@@ -0,0 +1,55 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#ifndef QACONDITIONWATCHER_HPP
+#define QACONDITIONWATCHER_HPP
+
+#include <QObject>
+#include <QPointer>
+
+#include <functional>
+
+class ITransportClient;
+class QTimer;
+
+// Waits until a condition over the object tree holds or the timeout expires.
+// The condition is evaluated again on tree changes and on notify signals of
+// the watched property of items found by the previous evaluation, several
+// changes within one event loop pass cause a single evaluation.
+class QAConditionWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    // fills items the condition holds for, returns true once the wait is over
+    using Condition = std::function<bool(QObjectList *items)>;
+
+    explicit QAConditionWatcher(ITransportClient *client, const Condition &condition, int timeout);
+
+    void setWatchedProperty(const QByteArray &name);
+    void start();
+
+public slots:
+    void onTreeChanged();
+
+signals:
+    void finished(ITransportClient *client, const QObjectList &items, bool satisfied);
+
+private slots:
+    void scheduleEvaluation();
+    void evaluate();
+    void onTimeout();
+
+private:
+    void watch(const QObjectList &items);
+    void finish(const QObjectList &items, bool satisfied);
+
+    QPointer<ITransportClient> m_client;
+    Condition m_condition;
+    QTimer *m_deadlineTimer = nullptr;
+    QByteArray m_watchedProperty;
+    int m_scheduleSlot = -1;
+
+    bool m_scheduled = false;
+    bool m_finished = false;
+    int m_evaluations = 0;
+};
+
+#endif // QACONDITIONWATCHER_HPP
@@ -7,13 +7,13 @@
 #include <QFileInfo>
 #include <QJsonDocument>
 #include <QTcpSocket>
-#include <QMetaMethod>
 #include <QWindow>
 #include <QTimer>
 #include <QQuickWindow>
 #include <QDir>
 #include <QDateTime>
 
+#include "CommandDispatcher.hpp"
 #include "ITransportClient.hpp"
 
 #if defined Q_OS_SAILFISH
@@ -24,7 +24,10 @@
 #include "WidgetsEnginePlatform.hpp"
 #endif
 
+#include "QABatchClient.hpp"
 #include "QAEngineSocketClient.hpp"
+#include "QAObjectIndex.hpp"
+#include "QARequestClient.hpp"
 
 #include <QLoggingCategory>
 
@@ -50,13 +53,6 @@ bool s_exiting = false;
 QHash<QWindow*, IEnginePlatform*> s_windows;
 QWindow *s_lastFocusWindow = nullptr;
 
-inline QGenericArgument qVariantToArgument(const QVariant &variant) {
-    if (variant.isValid() && !variant.isNull()) {
-        return QGenericArgument(variant.typeName(), variant.constData());
-    }
-    return QGenericArgument();
-}
-
 #ifdef Q_OS_WIN
 void fileOutput(QtMsgType type, const QMessageLogContext &context, const QString &msg)
 {
@@ -89,6 +85,21 @@ void fileOutput(QtMsgType type, const QMessageLogContext &context, const QString
 }
 #endif
 
+void writeReply(ITransportClient *socket, const QJsonValue &value, int status)
+{
+    QJsonObject reply;
+    reply.insert(QStringLiteral("status"), status);
+    reply.insert(QStringLiteral("value"), value);
+    if (auto request = qobject_cast<QARequestClient*>(socket)) {
+        reply.insert(QStringLiteral("id"), request->requestId());
+    }
+
+    const QByteArray data = QJsonDocument(reply).toJson(QJsonDocument::Compact);
+
+    socket->writeFrame(data);
+    socket->flush();
+}
+
 }
 
 bool QAEngine::isLoaded()
@@ -143,6 +154,20 @@ void QAEngine::initialize()
         << QStringLiteral("2.0.0-dev");
 #endif
 
+    m_objectIndex = new QAObjectIndex(thread());
+    // hooks report objects only from now on
+    m_objectIndex->insertTree(qApp);
+    for (QWindow *window : qGuiApp->allWindows()) {
+        m_objectIndex->insertTree(window);
+    }
+#if !defined Q_OS_SAILFISH
+    if (qobject_cast<QApplication*>(qApp)) {
+        for (QWidget *widget : QApplication::topLevelWidgets()) {
+            m_objectIndex->insertTree(widget);
+        }
+    }
+#endif
+
     connect(qApp, &QCoreApplication::aboutToQuit, []() {
         qCDebug(categoryEngine)
             << Q_FUNC_INFO << "about to quit!";
@@ -256,6 +281,10 @@ QAEngine::QAEngine(QObject *parent)
 
 QAEngine::~QAEngine()
 {
+    // index is a QObject itself, hook callbacks should not reach it while it is destroyed
+    QAObjectIndex *objectIndex = m_objectIndex;
+    m_objectIndex = nullptr;
+    delete objectIndex;
 }
 
 QString QAEngine::processName()
@@ -265,54 +294,25 @@ QString QAEngine::processName()
 
 bool QAEngine::metaInvoke(ITransportClient *socket, QObject *object, const QString &methodName, const QVariantList &params, bool *implemented)
 {
-    auto mo = object->metaObject();
-    do {
-        for (int i = mo->methodOffset(); i < mo->methodOffset() + mo->methodCount(); i++) {
-            if (mo->method(i).name() == methodName.toLatin1()) {
-                const QMetaMethod method = mo->method(i);
-                QGenericArgument arguments[9] = { QGenericArgument() };
-                for (int i = 0; i < (method.parameterCount() - 1) && params.count() > i; i++) {
-                    if (method.parameterType(i + 1) == QMetaType::QVariant) {
-                        arguments[i] = Q_ARG(QVariant, params[i]);
-                    } else {
-                        arguments[i] = qVariantToArgument(params[i]);
-                    }
-                }
-                qCDebug(categoryEngine)
-                    << Q_FUNC_INFO
-                    << "found" << methodName
-                    << "in" << mo->className();
-
-                if (implemented) {
-                    *implemented = true;
-                }
-
-                return QMetaObject::invokeMethod(
-                    object,
-                    methodName.toLatin1().constData(),
-                    Qt::DirectConnection,
-                    Q_ARG(ITransportClient*, socket),
-                    arguments[0],
-                    arguments[1],
-                    arguments[2],
-                    arguments[3],
-                    arguments[4],
-                    arguments[5],
-                    arguments[6],
-                    arguments[7],
-                    arguments[8]);
-            }
-        }
-    } while ((mo = mo->superClass()));
+    const CommandDispatcher::Result result = CommandDispatcher::invoke(socket, object, methodName, params);
+    if (result != CommandDispatcher::NotImplemented) {
+        qCDebug(categoryEngine)
+            << Q_FUNC_INFO
+            << "found" << methodName
+            << "in" << object->metaObject()->className();
+    }
 
     if (implemented) {
-        *implemented = false;
+        *implemented = result != CommandDispatcher::NotImplemented;
     }
-    return false;
+    return result == CommandDispatcher::Invoked;
 }
 
 void QAEngine::addItem(QObject *o)
 {
+    if (m_objectIndex) {
+        m_objectIndex->objectCreated(o);
+    }
     if (auto platform = getPlatform(true)) {
         platform->addItem(o);
     }
@@ -323,6 +323,9 @@ void QAEngine::removeItem(QObject *o)
     if (s_exiting) {
         return;
     }
+    if (m_objectIndex) {
+        m_objectIndex->objectRemoved(o);
+    }
     if (auto platform = getPlatform(true)) {
         platform->removeItem(o);
     }
@@ -331,6 +334,11 @@ void QAEngine::removeItem(QObject *o)
     }
 }
 
+QAObjectIndex *QAEngine::objectIndex()
+{
+    return m_objectIndex;
+}
+
 void QAEngine::processCommand(ITransportClient *socket, const QByteArray &cmd)
 {
     qCDebug(categoryEngine)
@@ -358,13 +366,23 @@ void QAEngine::processCommand(ITransportClient *socket, const QByteArray &cmd)
     }
 
     const QString action = object.value(QStringLiteral("action")).toVariant().toString();
-    const QVariantList params = object.value(QStringLiteral("params")).toVariant().toList();
+    const QJsonArray params = object.value(QStringLiteral("params")).toArray();
+
+    // tagged requests are answered through a proxy which puts the id into the reply
+    const QJsonValue requestId = object.value(QStringLiteral("id"));
+    if (!requestId.isUndefined() && !requestId.isNull()) {
+        socket = new QARequestClient(socket, requestId);
+    }
 
     processAppiumCommand(socket, action, params);
 }
 
-bool QAEngine::processAppiumCommand(ITransportClient *socket, const QString &action, const QVariantList &params)
+bool QAEngine::processAppiumCommand(ITransportClient *socket, const QString &action, const QJsonArray &params)
 {
+    if (action == QLatin1String("batch")) {
+        return processBatchCommand(socket, params);
+    }
+
     const QString methodName = QStringLiteral("%1Command").arg(action);
     qCDebug(categoryEngine)
         << Q_FUNC_INFO
@@ -373,22 +391,48 @@ bool QAEngine::processAppiumCommand(ITransportClient *socket, const QString &act
     bool result = false;
     if (auto platform = getPlatform()) {
         qCDebug(categoryEngine) << Q_FUNC_INFO << platform << platform->window() << platform->rootObject();
-        bool implemented = true;
-        result = metaInvoke(socket, platform, methodName, params, &implemented);
+        QString error;
+        const CommandDispatcher::Result invokeResult = CommandDispatcher::invoke(socket, platform, methodName, params, &error);
+        result = invokeResult == CommandDispatcher::Invoked;
 
-        if (!implemented) {
+        if (invokeResult == CommandDispatcher::NotImplemented) {
             platform->socketReply(socket, QStringLiteral("not_implemented"), 405);
+        } else if (invokeResult == CommandDispatcher::InvalidArguments) {
+            platform->socketReply(socket, error, 400);
         }
     } else {
-        QJsonObject reply;
-        reply.insert(QStringLiteral("status"), 1);
-        reply.insert(QStringLiteral("value"), QStringLiteral("no platform!"));
+        writeReply(socket, QStringLiteral("no platform!"), 1);
+    }
 
-        const QByteArray data = QJsonDocument(reply).toJson(QJsonDocument::Compact);
+    return result;
+}
 
-        socket->write(data);
-        socket->flush();
+bool QAEngine::processBatchCommand(ITransportClient *socket, const QJsonArray &params)
+{
+    // params: [[{"action": ..., "params": [...]}, ...], abortOnError]
+    if (!params.at(0).isArray()) {
+        writeReply(socket, QStringLiteral("batch: argument 1 should be array"), 400);
+        return false;
     }
 
-    return result;
+    const QJsonArray steps = params.at(0).toArray();
+    const bool abortOnError = params.at(1).toBool();
+    qCDebug(categoryEngine)
+        << Q_FUNC_INFO
+        << socket << steps.size() << abortOnError;
+
+    QABatchClient *batch = new QABatchClient(socket, steps, abortOnError);
+    connect(batch, &QABatchClient::stepRequested, this, &QAEngine::processAppiumCommand);
+    connect(batch, &QABatchClient::finished, this, &QAEngine::onBatchFinished);
+    batch->start();
+    return true;
+}
+
+void QAEngine::onBatchFinished(ITransportClient *socket, const QJsonArray &results)
+{
+    if (auto platform = getPlatform(true)) {
+        platform->socketReply(socket, results.toVariantList());
+    } else {
+        writeReply(socket, results, 0);
+    }
 }
@@ -2,9 +2,11 @@
 #ifndef QAENGINE_HPP
 #define QAENGINE_HPP
 
+#include <QJsonArray>
 #include <QObject>
 
 class QAEngineSocketClient;
+class QAObjectIndex;
 class ITransportClient;
 class IEnginePlatform;
 class QWindow;
@@ -25,6 +27,7 @@ public:
 
     void addItem(QObject *o);
     void removeItem(QObject *o);
+    QAObjectIndex *objectIndex();
 
 public slots:
     void initialize();
@@ -32,12 +35,15 @@ public slots:
 private slots:
     void onFocusWindowChanged(QWindow *window);
     void processCommand(ITransportClient *socket, const QByteArray &cmd);
-    bool processAppiumCommand(ITransportClient *socket, const QString &action, const QVariantList &params);
+    bool processAppiumCommand(ITransportClient *socket, const QString &action, const QJsonArray &params);
+    bool processBatchCommand(ITransportClient *socket, const QJsonArray &params);
+    void onBatchFinished(ITransportClient *socket, const QJsonArray &results);
     void onPlatformReady();
 
 private:
     explicit QAEngine(QObject *parent = nullptr);
     QAEngineSocketClient *m_client = nullptr;
+    QAObjectIndex *m_objectIndex = nullptr;
 };
 
 #endif // QAENGINE_HPP
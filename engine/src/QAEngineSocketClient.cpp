@@ -56,6 +56,9 @@ void QAEngineSocketClient::connectToBridge()
         return;
     }
 
+    // bridges without framing support never answer it, replies are awaited in readClient
+    m_client->write(TransportFrameParser::deferredHandshake());
+
     QJsonObject root;
     QJsonObject app;
     app.insert(QStringLiteral("appName"), QAEngine::processName());
@@ -63,7 +66,7 @@ void QAEngineSocketClient::connectToBridge()
     root.insert(QStringLiteral("appConnect"), app);
 
     QByteArray data = QJsonDocument(root).toJson(QJsonDocument::Compact);
-    auto bytes = m_client->write(data);
+    auto bytes = m_client->writeFrame(data);
     qCDebug(categorySocketClient)
         << Q_FUNC_INFO
         << "Bytes to write:"
@@ -83,7 +86,37 @@ void QAEngineSocketClient::readClient(ITransportClient *client)
         << Q_FUNC_INFO
         << client << bytes;
 
-    emit commandReceived(client, client->readAll());
+    // several tagged requests may arrive back to back in a single read
+    TransportFrameParser *parser = client->frameParser();
+    parser->append(client->readAll());
+
+    QByteArray cmd;
+    while (parser->takeFrame(&cmd)) {
+        if (parser->frameCount() == 1
+                && parser->mode() == TransportFrameParser::JsonMode
+                && TransportFrameParser::isHandshake(cmd)) {
+            qCDebug(categorySocketClient)
+                << Q_FUNC_INFO
+                << "Using length-prefixed framing";
+
+            // bridge writes length-prefixed frames after the acknowledgement,
+            // own frames switch after the confirmation written in legacy framing
+            parser->setMode(TransportFrameParser::LengthPrefixedMode);
+            client->write(TransportFrameParser::handshake());
+            client->flush();
+            parser->setWriteMode(TransportFrameParser::LengthPrefixedMode);
+            continue;
+        }
+        emit commandReceived(client, cmd);
+    }
+
+    if (parser->hasError()) {
+        qCWarning(categorySocketClient)
+            << Q_FUNC_INFO
+            << "Message size limit exceeded, closing:" << client;
+        parser->clear();
+        client->close();
+    }
 }
 
 void QAEngineSocketClient::onConnected()
@@ -100,7 +133,7 @@ void QAEngineSocketClient::onConnected()
     root.insert(QStringLiteral("appConnect"), app);
 
     QByteArray data = QJsonDocument(root).toJson(QJsonDocument::Compact);
-    auto bytes = m_client->write(data);
+    auto bytes = m_client->writeFrame(data);
     qCDebug(categorySocketClient)
         << Q_FUNC_INFO
         << "Bytes to write:"
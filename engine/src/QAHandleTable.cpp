@@ -0,0 +1,225 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#include "QAHandleTable.hpp"
+
+namespace {
+
+const QLatin1String c_handleSeparator("_0x");
+
+}
+
+QAHandleTable::QAHandleTable(int capacity)
+    : m_capacity(capacity)
+{
+}
+
+QString QAHandleTable::handle(QObject *object, const QString &className)
+{
+    if (!object) {
+        return QString();
+    }
+
+    int index = slotOf(object);
+    if (index < 0) {
+        index = allocate(FindTier);
+        Slot &slot = m_slots[index];
+        slot.object = object;
+        slot.address = object;
+        m_slotByObject.insert(object, index);
+    } else if (m_slots.at(index).pins == 0) {
+        unlink(index);
+    }
+
+    // a pinned slot is ranked once the dumps referring to it are gone
+    Slot &slot = m_slots[index];
+    slot.tier = FindTier;
+    if (slot.pins == 0) {
+        link(index);
+    }
+
+    return format(index, className);
+}
+
+QString QAHandleTable::markupHandle(QObject *object, const QString &className)
+{
+    if (!object) {
+        return QString();
+    }
+
+    int index = slotOf(object);
+    if (index < 0) {
+        index = allocate(MarkupTier);
+        Slot &slot = m_slots[index];
+        slot.object = object;
+        slot.address = object;
+        slot.tier = MarkupTier;
+        m_slotByObject.insert(object, index);
+        link(index);
+    }
+
+    return format(index, className);
+}
+
+QObject *QAHandleTable::object(const QString &handle) const
+{
+    const int index = resolve(handle);
+    if (index < 0) {
+        return nullptr;
+    }
+    return m_slots.at(index).object;
+}
+
+bool QAHandleTable::contains(const QString &handle) const
+{
+    return resolve(handle) >= 0;
+}
+
+void QAHandleTable::pin(const QString &handle)
+{
+    const int index = resolve(handle);
+    if (index < 0) {
+        return;
+    }
+
+    Slot &slot = m_slots[index];
+    if (slot.pins++ == 0) {
+        unlink(index);
+    }
+}
+
+void QAHandleTable::unpin(const QString &handle)
+{
+    const int index = resolve(handle);
+    if (index < 0) {
+        return;
+    }
+
+    Slot &slot = m_slots[index];
+    if (slot.pins > 0 && --slot.pins == 0) {
+        link(index);
+    }
+}
+
+void QAHandleTable::remove(QObject *object)
+{
+    const int index = m_slotByObject.value(object, -1);
+    if (index >= 0) {
+        release(index);
+    }
+}
+
+int QAHandleTable::size() const
+{
+    return m_slotByObject.size();
+}
+
+int QAHandleTable::slotOf(QObject *object)
+{
+    const int index = m_slotByObject.value(object, -1);
+    if (index >= 0 && m_slots.at(index).object.isNull()) {
+        // address reused by a new object, destruction of the old one was not reported
+        release(index);
+        return -1;
+    }
+    return index;
+}
+
+QString QAHandleTable::format(int index, const QString &className) const
+{
+    const quint64 value = (quint64(m_slots.at(index).generation) << 32) | quint32(index);
+    return className + c_handleSeparator + QStringLiteral("%1").arg(value, 16, 16, QLatin1Char('0'));
+}
+
+int QAHandleTable::resolve(const QString &handle) const
+{
+    const int separator = handle.lastIndexOf(c_handleSeparator);
+    if (separator < 0) {
+        return -1;
+    }
+
+    bool ok = false;
+    const quint64 value = handle.midRef(separator + c_handleSeparator.size()).toULongLong(&ok, 16);
+    if (!ok) {
+        return -1;
+    }
+
+    const quint32 index = quint32(value & 0xffffffff);
+    const quint32 generation = quint32(value >> 32);
+    if (index >= quint32(m_slots.size())) {
+        return -1;
+    }
+
+    const Slot &slot = m_slots.at(int(index));
+    if (!slot.address || slot.generation != generation || slot.object.isNull()) {
+        return -1;
+    }
+    return int(index);
+}
+
+int QAHandleTable::allocate(Tier tier)
+{
+    if (!m_freeSlots.isEmpty()) {
+        return m_freeSlots.takeLast();
+    }
+
+    // markup slots go first, markup never evicts handles of find results,
+    // the table rather grows past its capacity while all slots are pinned
+    int index = m_lists[MarkupTier].tail;
+    if (index < 0 && tier == FindTier) {
+        index = m_lists[FindTier].tail;
+    }
+    if (m_slots.size() < m_capacity || index < 0) {
+        m_slots.append(Slot());
+        return m_slots.size() - 1;
+    }
+
+    release(index);
+    return m_freeSlots.takeLast();
+}
+
+void QAHandleTable::release(int index)
+{
+    Slot &slot = m_slots[index];
+    if (slot.pins == 0) {
+        unlink(index);
+    }
+    m_slotByObject.remove(slot.address);
+
+    slot.object.clear();
+    slot.address = nullptr;
+    slot.generation++;
+    slot.pins = 0;
+    m_freeSlots.append(index);
+}
+
+void QAHandleTable::link(int index)
+{
+    Slot &slot = m_slots[index];
+    List &list = m_lists[slot.tier];
+    slot.previous = -1;
+    slot.next = list.head;
+    if (list.head >= 0) {
+        m_slots[list.head].previous = index;
+    }
+    list.head = index;
+    if (list.tail < 0) {
+        list.tail = index;
+    }
+}
+
+void QAHandleTable::unlink(int index)
+{
+    Slot &slot = m_slots[index];
+    List &list = m_lists[slot.tier];
+    if (slot.previous >= 0) {
+        m_slots[slot.previous].next = slot.next;
+    } else if (list.head == index) {
+        list.head = slot.next;
+    }
+    if (slot.next >= 0) {
+        m_slots[slot.next].previous = slot.previous;
+    } else if (list.tail == index) {
+        list.tail = slot.previous;
+    }
+    slot.previous = -1;
+    slot.next = -1;
+}
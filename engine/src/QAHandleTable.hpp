@@ -0,0 +1,73 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#ifndef QAHANDLETABLE_HPP
+#define QAHANDLETABLE_HPP
+
+#include <QHash>
+#include <QPointer>
+#include <QVector>
+
+// Element ids handed out to the driver.
+// Every id refers to a table slot together with the slot generation, so an id
+// of a destroyed object never resolves to a new object living at the same
+// address. Insert, lookup and removal are O(1).
+// Handles returned by find are kept in least recently used order and evicted
+// when the table is full. Ids written into markup never evict or promote
+// them: markup slots are evicted among themselves first, and pinned slots,
+// ids a dump still refers to, are never evicted at all.
+class QAHandleTable
+{
+public:
+    explicit QAHandleTable(int capacity = 131072);
+
+    // registers the object as a find result, promoting its handle
+    QString handle(QObject *object, const QString &className);
+    // existing handle as is, a new object gets a markup slot
+    QString markupHandle(QObject *object, const QString &className);
+    // lookup only, the lru order is left as it is
+    QObject *object(const QString &handle) const;
+    bool contains(const QString &handle) const;
+    void pin(const QString &handle);
+    void unpin(const QString &handle);
+    void remove(QObject *object);
+    int size() const;
+
+private:
+    enum Tier {
+        FindTier,
+        MarkupTier,
+    };
+
+    struct Slot {
+        QPointer<QObject> object;
+        QObject *address = nullptr;
+        quint32 generation = 0;
+        Tier tier = MarkupTier;
+        int pins = 0;
+        int previous = -1;
+        int next = -1;
+    };
+
+    // most recently used first
+    struct List {
+        int head = -1;
+        int tail = -1;
+    };
+
+    int slotOf(QObject *object);
+    QString format(int index, const QString &className) const;
+    int resolve(const QString &handle) const;
+    int allocate(Tier tier);
+    void release(int index);
+    void link(int index);
+    void unlink(int index);
+
+    int m_capacity = 0;
+    QVector<Slot> m_slots;
+    QVector<int> m_freeSlots;
+    QHash<QObject*, int> m_slotByObject;
+
+    // pinned slots are not linked into any list
+    List m_lists[2];
+};
+
+#endif // QAHANDLETABLE_HPP
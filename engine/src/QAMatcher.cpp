@@ -0,0 +1,136 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#include "QAMatcher.hpp"
+
+#include <QCache>
+
+namespace {
+
+const int c_cacheSize = 64;
+
+QString wildcardToRegularExpression(const QString &wildcard)
+{
+    QString result;
+    result.reserve(wildcard.size() * 2);
+
+    const int size = wildcard.size();
+    for (int i = 0; i < size; i++) {
+        const QChar c = wildcard.at(i);
+        if (c == QLatin1Char('*')) {
+            result.append(QLatin1String(".*"));
+        } else if (c == QLatin1Char('?')) {
+            result.append(QLatin1Char('.'));
+        } else if (c == QLatin1Char('[')) {
+            const int end = wildcard.indexOf(QLatin1Char(']'), i + 1);
+            if (end < 0) {
+                result.append(QLatin1String("\\["));
+                continue;
+            }
+            result.append(wildcard.midRef(i, end - i + 1));
+            i = end;
+        } else {
+            result.append(QRegularExpression::escape(QString(c)));
+        }
+    }
+    return result;
+}
+
+}
+
+QAMatcher::QAMatcher(Type type, const QString &pattern, const QString &text)
+    : m_type(type)
+    , m_pattern(pattern)
+    , m_text(text)
+{
+    if (m_type == Wildcard || m_type == RegularExpression) {
+        const QString body = m_type == Wildcard ? wildcardToRegularExpression(m_text) : m_text;
+        m_regularExpression.setPattern(QStringLiteral("\\A(?:%1)\\z").arg(body));
+        m_regularExpression.optimize();
+    }
+}
+
+QAMatcher QAMatcher::exact(const QString &text)
+{
+    return QAMatcher(Exact, text, text);
+}
+
+QAMatcher QAMatcher::contains(const QString &text)
+{
+    return QAMatcher(Contains, text, text);
+}
+
+QAMatcher QAMatcher::compile(const QString &pattern)
+{
+    if (pattern.startsWith(QLatin1Char('/'))) {
+        if (pattern.size() > 1 && pattern.endsWith(QLatin1Char('/'))) {
+            return QAMatcher(RegularExpression, pattern, pattern.mid(1, pattern.size() - 2));
+        }
+        return QAMatcher(RegularExpression, pattern, pattern);
+    }
+
+    if (!pattern.contains(QLatin1Char('*'))) {
+        return exact(pattern);
+    }
+
+    // most wildcards only have stars at the ends, match them without regular expression
+    const bool leading = pattern.startsWith(QLatin1Char('*'));
+    const bool trailing = pattern.size() > 1 && pattern.endsWith(QLatin1Char('*'));
+    const QString text = pattern.mid(leading ? 1 : 0, pattern.size() - (leading ? 1 : 0) - (trailing ? 1 : 0));
+    if (text.contains(QLatin1Char('*')) || text.contains(QLatin1Char('?')) || text.contains(QLatin1Char('['))) {
+        return QAMatcher(Wildcard, pattern, pattern);
+    }
+
+    if (leading && trailing) {
+        return QAMatcher(Contains, pattern, text);
+    }
+    return QAMatcher(leading ? Suffix : Prefix, pattern, text);
+}
+
+QAMatcher QAMatcher::cached(const QString &pattern)
+{
+    static QCache<QString, QAMatcher> cache(c_cacheSize);
+
+    if (QAMatcher *matcher = cache.object(pattern)) {
+        return *matcher;
+    }
+
+    const QAMatcher matcher = compile(pattern);
+    cache.insert(pattern, new QAMatcher(matcher));
+    return matcher;
+}
+
+bool QAMatcher::isPattern(const QString &pattern)
+{
+    return pattern.startsWith(QLatin1Char('/')) || pattern.contains(QLatin1Char('*'));
+}
+
+QAMatcher::Type QAMatcher::type() const
+{
+    return m_type;
+}
+
+QString QAMatcher::pattern() const
+{
+    return m_pattern;
+}
+
+bool QAMatcher::match(const QString &value) const
+{
+    if (value.isEmpty()) {
+        return false;
+    }
+
+    switch (m_type) {
+    case Exact:
+        return value == m_text;
+    case Prefix:
+        return value.startsWith(m_text);
+    case Suffix:
+        return value.endsWith(m_text);
+    case Contains:
+        return value.contains(m_text);
+    case Wildcard:
+    case RegularExpression:
+        return m_regularExpression.match(value).hasMatch();
+    }
+    return false;
+}
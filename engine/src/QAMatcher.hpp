@@ -0,0 +1,46 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#ifndef QAMATCHER_HPP
+#define QAMATCHER_HPP
+
+#include <QRegularExpression>
+#include <QString>
+
+// Selector compiled once per query.
+// "/body/" is a regular expression, pattern starting with "/" only is matched
+// as a regular expression as a whole, pattern with "*" is a wildcard, anything
+// else is compared literally. Whole value should match in every mode.
+class QAMatcher
+{
+public:
+    enum Type {
+        Exact,
+        Prefix,
+        Suffix,
+        Contains,
+        Wildcard,
+        RegularExpression,
+    };
+
+    QAMatcher() = default;
+
+    static QAMatcher exact(const QString &text);
+    static QAMatcher contains(const QString &text);
+    static QAMatcher compile(const QString &pattern);
+    // compiled matchers for recently used patterns are kept in a LRU cache
+    static QAMatcher cached(const QString &pattern);
+    static bool isPattern(const QString &pattern);
+
+    Type type() const;
+    QString pattern() const;
+    bool match(const QString &value) const;
+
+private:
+    QAMatcher(Type type, const QString &pattern, const QString &text);
+
+    Type m_type = Exact;
+    QString m_pattern;
+    QString m_text;
+    QRegularExpression m_regularExpression;
+};
+
+#endif // QAMATCHER_HPP
@@ -19,6 +19,32 @@
 
 Q_LOGGING_CATEGORY(categoryMouseEngine, "omp.qaengine.mouse", QtWarningMsg)
 
+namespace {
+
+// element ids are resolved here in the gui thread, the worker thread gets plain points
+QVariantList resolveElements(const QVariantList &actions)
+{
+    IEnginePlatform *platform = QAEngine::instance()->getPlatform();
+
+    QVariantList resolved;
+    for (const QVariant &actionVar : actions) {
+        QVariantMap actionMap = actionVar.toMap();
+        QVariantMap options = actionMap.value(QStringLiteral("options")).toMap();
+        if (options.contains(QStringLiteral("element"))) {
+            if (auto item = platform->getObject(options.take(QStringLiteral("element")).toString())) {
+                const QPoint point = platform->getAbsGeometry(item).center();
+                options.insert(QStringLiteral("x"), point.x());
+                options.insert(QStringLiteral("y"), point.y());
+            }
+            actionMap.insert(QStringLiteral("options"), options);
+        }
+        resolved.append(actionMap);
+    }
+    return resolved;
+}
+
+}
+
 QAMouseEngine::QAMouseEngine(QObject *parent)
     : QObject(parent)
     , m_eta(new QElapsedTimer())
@@ -403,7 +429,7 @@ EventWorker::~EventWorker()
 
 EventWorker* EventWorker::PerformTouchAction(const QVariantList &actions, QAMouseEngine *engine)
 {
-    EventWorker *worker = new EventWorker(actions, engine);
+    EventWorker *worker = new EventWorker(resolveElements(actions), engine);
     QThread *thread = new QThread;
     connect(thread, &QThread::started, worker, &EventWorker::start);
     connect(worker, &EventWorker::finished, thread, &QThread::quit);
@@ -433,13 +459,6 @@ void EventWorker::start()
             const int posY = options.value(QStringLiteral("y")).toInt();
             QPoint point(posX, posY);
 
-            if (options.contains(QStringLiteral("element"))) {
-                auto platform = QAEngine::instance()->getPlatform();
-                if (auto item = platform->getObject(options.value(QStringLiteral("element")).toString())) {
-                    point = platform->getAbsGeometry(item).center();
-                }
-            }
-
             sendPress(point);
             previousPoint = point;
 
@@ -452,13 +471,6 @@ void EventWorker::start()
             const int posY = options.value(QStringLiteral("y")).toInt();
             QPoint point(posX, posY);
 
-            if (options.contains(QStringLiteral("element"))) {
-                auto platform = QAEngine::instance()->getPlatform();
-                if (auto item = platform->getObject(options.value(QStringLiteral("element")).toString())) {
-                    point = platform->getAbsGeometry(item).center();
-                }
-            }
-
             sendPress(point);
             previousPoint = point;
         } else if (action == QLatin1String("moveTo")) {
@@ -466,13 +478,6 @@ void EventWorker::start()
             const int posY = options.value(QStringLiteral("y")).toInt();
             QPoint point(posX, posY);
 
-            if (options.contains(QStringLiteral("element"))) {
-                auto platform = QAEngine::instance()->getPlatform();
-                if (auto item = platform->getObject(options.value(QStringLiteral("element")).toString())) {
-                    point = platform->getAbsGeometry(item).center();
-                }
-            }
-
             const int duration = options.value(QStringLiteral("duration"), 500).toInt();
             const int steps = options.value(QStringLiteral("steps"), 20).toInt();
 
@@ -486,13 +491,6 @@ void EventWorker::start()
             const int posY = options.value(QStringLiteral("y")).toInt();
             QPoint point(posX, posY);
 
-            if (options.contains(QStringLiteral("element"))) {
-                auto platform = QAEngine::instance()->getPlatform();
-                if (auto item = platform->getObject(options.value(QStringLiteral("element")).toString())) {
-                    point = platform->getAbsGeometry(item).center();
-                }
-            }
-
             const int count = options.value(QStringLiteral("count")).toInt();
             for (int i = 0; i < count; i++) {
                 sendPress(point);
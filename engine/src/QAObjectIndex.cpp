@@ -0,0 +1,277 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#include "QAObjectIndex.hpp"
+#include "GenericEnginePlatform.hpp"
+
+#include <QDebug>
+#include <QMutexLocker>
+#include <QQuickItem>
+#include <QQuickWindow>
+#include <QThread>
+
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(categoryObjectIndex, "omp.qaengine.index", QtWarningMsg)
+
+namespace {
+
+bool isVisual(QObject *o)
+{
+    return o->isWidgetType() || qobject_cast<QQuickItem*>(o);
+}
+
+}
+
+QAObjectIndex::QAObjectIndex(QThread *thread, QObject *parent)
+    : QObject(parent)
+    , m_thread(thread)
+    , m_textChangedSlot(staticMetaObject.indexOfSlot("onTextChanged()"))
+{
+}
+
+void QAObjectIndex::objectCreated(QObject *o)
+{
+    QMutexLocker lock(&m_mutex);
+    m_created.insert(o);
+}
+
+void QAObjectIndex::objectRemoved(QObject *o)
+{
+    if (QThread::currentThread() == m_thread) {
+        {
+            QMutexLocker lock(&m_mutex);
+            m_created.remove(o);
+        }
+        erase(o);
+        return;
+    }
+
+    QMutexLocker lock(&m_mutex);
+    m_created.remove(o);
+    m_removed.insert(o);
+}
+
+void QAObjectIndex::insert(QObject *o)
+{
+    if (!o || m_entries.contains(o)) {
+        return;
+    }
+
+    Entry entry;
+    entry.objectName = o->objectName();
+    entry.className = GenericEnginePlatform::getClassName(o);
+
+    if (!entry.objectName.isEmpty()) {
+        m_byObjectName[entry.objectName].insert(o);
+    }
+    m_byClassName[entry.className].insert(o);
+    // delegates often get their names bound to model data after creation,
+    // other unnamed objects are not worth a connection each
+    if (!entry.objectName.isEmpty() || isVisual(o)) {
+        connect(o, &QObject::objectNameChanged, this, &QAObjectIndex::onObjectNameChanged, Qt::UniqueConnection);
+    }
+
+    QHash<QObject*, Entry>::iterator it = m_entries.insert(o, entry);
+    if (m_textReader) {
+        updateText(o, &it.value());
+    }
+}
+
+void QAObjectIndex::insertTree(QObject *root)
+{
+    QObjectList stack = {root};
+    while (!stack.isEmpty()) {
+        QObject *o = stack.takeLast();
+        if (!o || m_entries.contains(o)) {
+            continue;
+        }
+        insert(o);
+
+        stack.append(o->children());
+        // delegates and items created by views often have no object parent
+        if (QQuickWindow *window = qobject_cast<QQuickWindow*>(o)) {
+            stack.append(window->contentItem());
+        } else if (QQuickItem *item = qobject_cast<QQuickItem*>(o)) {
+            for (QQuickItem *child : item->childItems()) {
+                stack.append(child);
+            }
+        }
+    }
+
+    qCDebug(categoryObjectIndex)
+        << Q_FUNC_INFO
+        << root << "total:" << m_entries.size();
+}
+
+QObjectList QAObjectIndex::objects(QAObjectIndex::Key key, const QString &value)
+{
+    drain();
+
+    const QSet<QObject*> objects = bucket(key).value(value);
+    return QObjectList(objects.cbegin(), objects.cend());
+}
+
+QStringList QAObjectIndex::values(QAObjectIndex::Key key)
+{
+    drain();
+
+    return bucket(key).keys();
+}
+
+int QAObjectIndex::size()
+{
+    drain();
+
+    return m_entries.size();
+}
+
+void QAObjectIndex::drain()
+{
+    QSet<QObject*> removed;
+    QObjectList created;
+    {
+        QMutexLocker lock(&m_mutex);
+        removed.swap(m_removed);
+
+        // objects living in other threads stay queued until they are moved or destroyed
+        QSet<QObject*>::iterator it = m_created.begin();
+        while (it != m_created.end()) {
+            if ((*it)->thread() == m_thread) {
+                created.append(*it);
+                it = m_created.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // removals first, a queued object may reuse the address of a removed one
+    for (QObject *o : removed) {
+        erase(o);
+    }
+    for (QObject *o : created) {
+        insert(o);
+    }
+
+    if (!removed.isEmpty() || !created.isEmpty()) {
+        qCDebug(categoryObjectIndex)
+            << Q_FUNC_INFO
+            << "removed:" << removed.size()
+            << "added:" << created.size()
+            << "total:" << m_entries.size();
+    }
+}
+
+void QAObjectIndex::setTextReader(const TextReader &reader)
+{
+    drain();
+
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        QObject::disconnect(it.key(), nullptr, this, SLOT(onTextChanged()));
+        it->text.clear();
+    }
+    m_byText.clear();
+
+    m_textReader = reader;
+    if (!m_textReader) {
+        return;
+    }
+
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        updateText(it.key(), &it.value());
+    }
+
+    qCDebug(categoryObjectIndex)
+        << Q_FUNC_INFO
+        << "texts:" << m_byText.size();
+}
+
+bool QAObjectIndex::hasTextKey() const
+{
+    return static_cast<bool>(m_textReader);
+}
+
+void QAObjectIndex::onObjectNameChanged(const QString &objectName)
+{
+    QObject *o = sender();
+
+    QHash<QObject*, Entry>::iterator it = m_entries.find(o);
+    if (it == m_entries.end()) {
+        return;
+    }
+
+    removeFromBucket(&m_byObjectName, it->objectName, o);
+    it->objectName = objectName;
+    if (!objectName.isEmpty()) {
+        m_byObjectName[objectName].insert(o);
+    }
+}
+
+void QAObjectIndex::onTextChanged()
+{
+    QObject *o = sender();
+
+    QHash<QObject*, Entry>::iterator it = m_entries.find(o);
+    if (it == m_entries.end() || !m_textReader) {
+        return;
+    }
+
+    removeFromBucket(&m_byText, it->text, o);
+    it->text = m_textReader(o, nullptr);
+    if (!it->text.isEmpty()) {
+        m_byText[it->text].insert(o);
+    }
+}
+
+void QAObjectIndex::updateText(QObject *o, Entry *entry)
+{
+    QVector<int> notifySignals;
+    entry->text = m_textReader(o, &notifySignals);
+    if (!entry->text.isEmpty()) {
+        m_byText[entry->text].insert(o);
+    }
+
+    for (int notifySignal : notifySignals) {
+        QMetaObject::connect(o, notifySignal, this, m_textChangedSlot, Qt::UniqueConnection);
+    }
+}
+
+void QAObjectIndex::erase(QObject *o)
+{
+    QHash<QObject*, Entry>::iterator it = m_entries.find(o);
+    if (it == m_entries.end()) {
+        return;
+    }
+
+    removeFromBucket(&m_byObjectName, it->objectName, o);
+    removeFromBucket(&m_byClassName, it->className, o);
+    removeFromBucket(&m_byText, it->text, o);
+
+    m_entries.erase(it);
+}
+
+QHash<QString, QSet<QObject*>> &QAObjectIndex::bucket(QAObjectIndex::Key key)
+{
+    switch (key) {
+    case ObjectNameKey:
+        return m_byObjectName;
+    case TextKey:
+        return m_byText;
+    default:
+        return m_byClassName;
+    }
+}
+
+void QAObjectIndex::removeFromBucket(QHash<QString, QSet<QObject*>> *bucket, const QString &value, QObject *o)
+{
+    if (value.isEmpty()) {
+        return;
+    }
+
+    QHash<QString, QSet<QObject*>>::iterator it = bucket->find(value);
+    if (it != bucket->end()) {
+        it->remove(o);
+        if (it->isEmpty()) {
+            bucket->erase(it);
+        }
+    }
+}
@@ -0,0 +1,85 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#ifndef QAOBJECTINDEX_HPP
+#define QAOBJECTINDEX_HPP
+
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+
+#include <functional>
+
+class QThread;
+
+// Index of live objects by objectName, class name and optionally by text.
+// Hook callbacks may come from any thread and only queue the object, queued
+// objects are classified on the owner thread right before the next lookup,
+// when their construction is already finished.
+// objectName is kept fresh from objectNameChanged of visual items and named
+// objects, text from notify signals of the properties it is read from.
+class QAObjectIndex : public QObject
+{
+    Q_OBJECT
+public:
+    enum Key {
+        ObjectNameKey,
+        ClassNameKey,
+        TextKey,
+    };
+
+    // returns text of the object and notify signals of the properties it depends on
+    using TextReader = std::function<QString(QObject *o, QVector<int> *notifySignals)>;
+
+    explicit QAObjectIndex(QThread *thread, QObject *parent = nullptr);
+
+    // thread safe
+    void objectCreated(QObject *o);
+    void objectRemoved(QObject *o);
+
+    // owner thread only
+    void insert(QObject *o);
+    // objects created before the hooks were installed, children and quick items below root
+    void insertTree(QObject *root);
+    QObjectList objects(Key key, const QString &value);
+    QStringList values(Key key);
+    int size();
+
+    // empty reader disables text key
+    void setTextReader(const TextReader &reader);
+    bool hasTextKey() const;
+
+private slots:
+    void onObjectNameChanged(const QString &objectName);
+    void onTextChanged();
+
+private:
+    struct Entry {
+        QString objectName;
+        QString className;
+        QString text;
+    };
+
+    void drain();
+    void erase(QObject *o);
+    void updateText(QObject *o, Entry *entry);
+    QHash<QString, QSet<QObject*>> &bucket(Key key);
+    static void removeFromBucket(QHash<QString, QSet<QObject*>> *bucket, const QString &value, QObject *o);
+
+    QThread *m_thread = nullptr;
+
+    QMutex m_mutex;
+    QSet<QObject*> m_created;
+    QSet<QObject*> m_removed;
+
+    QHash<QObject*, Entry> m_entries;
+    QHash<QString, QSet<QObject*>> m_byObjectName;
+    QHash<QString, QSet<QObject*>> m_byClassName;
+    QHash<QString, QSet<QObject*>> m_byText;
+
+    TextReader m_textReader;
+    int m_textChangedSlot = -1;
+};
+
+#endif // QAOBJECTINDEX_HPP
@@ -0,0 +1,136 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#include "QAPropertySchema.hpp"
+
+#include <QMetaObject>
+#include <QMetaProperty>
+
+#include <algorithm>
+
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(categoryPropertySchema, "omp.qaengine.schema", QtWarningMsg)
+
+namespace {
+
+// with the text properties these are watched for changes of snapshotted items
+const char *c_stateProperties[] = {
+    "visible",
+    "enabled",
+};
+
+const char *c_textProperties[] = {
+    "label",
+    "title",
+    "description",
+    "placeholderText",
+    "text",
+    "value",
+    "name",
+    "toolTip",
+};
+
+}
+
+QAPropertySchema::QAPropertySchema(const QMetaObject *metaObject, const QHash<QString, QStringList> &blacklist)
+    : m_className(QString::fromLatin1(metaObject->className()).section(QChar(u'_'), 0, 0).section(QChar(u':'), -1))
+{
+    const QStringList classBlacklist = blacklist.value(m_className);
+
+    const QMetaObject *mo = metaObject;
+    do {
+        const QStringList levelBlacklist = blacklist.value(QString::fromLatin1(mo->className()));
+
+        QVector<Property> level;
+        level.reserve(mo->propertyCount() - mo->propertyOffset());
+        for (int i = mo->propertyOffset(); i < mo->propertyCount(); ++i) {
+            const QString propertyName = QString::fromLatin1(mo->property(i).name());
+            if (m_indexByName.contains(propertyName)) {
+                continue;
+            }
+            m_indexByName.insert(propertyName, i);
+
+            if (levelBlacklist.contains(propertyName) || classBlacklist.contains(propertyName)) {
+                qCDebug(categoryPropertySchema)
+                    << "Found blacklisted:"
+                    << mo->className() << propertyName;
+                m_blacklisted.insert(propertyName);
+                continue;
+            }
+            level.append({i, propertyName});
+        }
+
+        std::sort(level.begin(), level.end(), [](const Property &left, const Property &right) {
+            return left.name < right.name;
+        });
+        m_properties += level;
+    } while ((mo = mo->superClass()));
+
+    for (const char *textProperty : c_textProperties) {
+        const int index = metaObject->indexOfProperty(textProperty);
+        if (index > 0) {
+            m_textProperties.append(index);
+
+            const int notifySignal = metaObject->property(index).notifySignalIndex();
+            if (notifySignal >= 0 && !m_textNotifySignals.contains(notifySignal)) {
+                m_textNotifySignals.append(notifySignal);
+            }
+        }
+    }
+
+    m_watchedSignals = m_textNotifySignals;
+    for (const char *stateProperty : c_stateProperties) {
+        const int index = metaObject->indexOfProperty(stateProperty);
+        if (index < 0 || m_blacklisted.contains(QString::fromLatin1(stateProperty))) {
+            continue;
+        }
+
+        const int notifySignal = metaObject->property(index).notifySignalIndex();
+        if (notifySignal >= 0 && !m_watchedSignals.contains(notifySignal)) {
+            m_watchedSignals.append(notifySignal);
+        }
+    }
+
+    qCDebug(categoryPropertySchema)
+        << Q_FUNC_INFO
+        << m_className << m_properties.size();
+}
+
+QString QAPropertySchema::className() const
+{
+    return m_className;
+}
+
+const QVector<QAPropertySchema::Property> &QAPropertySchema::properties() const
+{
+    return m_properties;
+}
+
+const QVector<int> &QAPropertySchema::textProperties() const
+{
+    return m_textProperties;
+}
+
+const QVector<int> &QAPropertySchema::textNotifySignals() const
+{
+    return m_textNotifySignals;
+}
+
+const QVector<int> &QAPropertySchema::watchedSignals() const
+{
+    return m_watchedSignals;
+}
+
+int QAPropertySchema::indexOfProperty(const QString &name) const
+{
+    return m_indexByName.value(name, -1);
+}
+
+bool QAPropertySchema::isBlacklisted(const QString &name) const
+{
+    return m_blacklisted.contains(name);
+}
+
+const void *QAPropertySchema::key(const QMetaObject *metaObject)
+{
+    return metaObject->d.data;
+}
@@ -0,0 +1,57 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#ifndef QAPROPERTYSCHEMA_HPP
+#define QAPROPERTYSCHEMA_HPP
+
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+struct QMetaObject;
+class QObject;
+
+// Property layout of a class resolved once and shared by dumps, xpath
+// attribute reads, getText and getAttribute: converted property names in dump
+// order, blacklist applied, name lookup and indices of the text properties.
+class QAPropertySchema
+{
+public:
+    struct Property {
+        int index;
+        QString name;
+    };
+
+    QAPropertySchema(const QMetaObject *metaObject, const QHash<QString, QStringList> &blacklist);
+
+    QString className() const;
+
+    // readable properties sorted by name per class level starting from the most
+    // derived one, every name listed once, blacklisted ones skipped
+    const QVector<Property> &properties() const;
+    // candidates for getText in priority order
+    const QVector<int> &textProperties() const;
+    // notify signals of text properties, method indexes
+    const QVector<int> &textNotifySignals() const;
+    // notify signals of text, visible and enabled, method indexes
+    const QVector<int> &watchedSignals() const;
+
+    int indexOfProperty(const QString &name) const;
+    bool isBlacklisted(const QString &name) const;
+
+    // QML objects carry per instance meta objects sharing the same data,
+    // schemas are keyed by that data instead of the meta object itself,
+    // schema does not keep the meta object it was built from for the same reason
+    static const void *key(const QMetaObject *metaObject);
+
+private:
+    QString m_className;
+    QVector<Property> m_properties;
+    QVector<int> m_textProperties;
+    QVector<int> m_textNotifySignals;
+    QVector<int> m_watchedSignals;
+    QHash<QString, int> m_indexByName;
+    QSet<QString> m_blacklisted;
+};
+
+#endif // QAPROPERTYSCHEMA_HPP
@@ -0,0 +1,168 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#include "QAPropertyWatchRegistry.hpp"
+
+#include <QDebug>
+#include <QMetaProperty>
+#include <QTimer>
+
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(categoryPropertyWatch, "omp.qaengine.watch", QtWarningMsg)
+
+QAPropertyWatchRegistry::QAPropertyWatchRegistry(QObject *parent)
+    : QObject(parent)
+    , m_notifySlot(staticMetaObject.indexOfSlot("onNotify()"))
+{
+}
+
+bool QAPropertyWatchRegistry::watch(QObject *object, int propertyIndex, const Predicate &predicate, int timeout, const Callback &callback)
+{
+    if (!object) {
+        return false;
+    }
+    const QMetaProperty property = object->metaObject()->property(propertyIndex);
+    if (!property.isValid() || !property.hasNotifySignal()) {
+        return false;
+    }
+
+    const QVariant value = property.read(object);
+    if (predicate(value)) {
+        callback(true, value);
+        return true;
+    }
+
+    const Key key(object, propertyIndex);
+    Waiter waiter;
+    waiter.id = ++m_lastId;
+    waiter.predicate = predicate;
+    waiter.callback = callback;
+    waiter.timer = new QTimer(this);
+    waiter.timer->setSingleShot(true);
+    const quint64 id = waiter.id;
+    connect(waiter.timer, &QTimer::timeout, this, [this, key, id]() {
+        onTimeout(key, id);
+    });
+    waiter.timer->start(timeout);
+
+    QVector<Waiter> &waiters = m_waiters[key];
+    if (waiters.isEmpty()) {
+        QVector<int> &properties = m_properties[object];
+        if (properties.isEmpty()) {
+            connect(object, &QObject::destroyed, this, &QAPropertyWatchRegistry::onObjectDestroyed);
+        }
+        properties.append(propertyIndex);
+        QMetaObject::connect(object, property.notifySignalIndex(), this, m_notifySlot, Qt::UniqueConnection);
+    }
+    waiters.append(waiter);
+
+    qCDebug(categoryPropertyWatch)
+        << Q_FUNC_INFO
+        << object << property.name() << timeout << waiters.size();
+
+    return true;
+}
+
+int QAPropertyWatchRegistry::size() const
+{
+    int count = 0;
+    for (const QVector<Waiter> &waiters : m_waiters) {
+        count += waiters.size();
+    }
+    return count;
+}
+
+void QAPropertyWatchRegistry::onNotify()
+{
+    QObject *object = sender();
+    const int signalIndex = senderSignalIndex();
+    const QMetaObject *mo = object->metaObject();
+
+    // properties may share a notify signal
+    const QVector<int> properties = m_properties.value(object);
+    for (int propertyIndex : properties) {
+        const QMetaProperty property = mo->property(propertyIndex);
+        if (property.notifySignalIndex() != signalIndex) {
+            continue;
+        }
+
+        const Key key(object, propertyIndex);
+        const QVariant value = property.read(object);
+        QVector<Waiter> satisfied;
+        QVector<Waiter> &waiters = m_waiters[key];
+        for (int i = waiters.size() - 1; i >= 0; i--) {
+            if (waiters.at(i).predicate(value)) {
+                satisfied.prepend(waiters.takeAt(i));
+            }
+        }
+        if (satisfied.isEmpty()) {
+            continue;
+        }
+        if (waiters.isEmpty()) {
+            release(object, propertyIndex);
+        }
+
+        // callbacks may add new waiters, they are called once the registry is consistent
+        for (const Waiter &waiter : satisfied) {
+            waiter.timer->deleteLater();
+            waiter.callback(true, value);
+        }
+    }
+}
+
+void QAPropertyWatchRegistry::onObjectDestroyed(QObject *object)
+{
+    QVector<Waiter> gone;
+    for (int propertyIndex : m_properties.take(object)) {
+        gone += m_waiters.take(Key(object, propertyIndex));
+    }
+
+    qCDebug(categoryPropertyWatch)
+        << Q_FUNC_INFO
+        << object << gone.size();
+
+    for (const Waiter &waiter : gone) {
+        waiter.timer->deleteLater();
+        waiter.callback(false, QVariant());
+    }
+}
+
+void QAPropertyWatchRegistry::onTimeout(const Key &key, quint64 id)
+{
+    QVector<Waiter> &waiters = m_waiters[key];
+    for (int i = 0; i < waiters.size(); i++) {
+        if (waiters.at(i).id != id) {
+            continue;
+        }
+        const Waiter waiter = waiters.takeAt(i);
+        if (waiters.isEmpty()) {
+            release(key.first, key.second);
+        }
+        waiter.timer->deleteLater();
+        waiter.callback(false, key.first->metaObject()->property(key.second).read(key.first));
+        return;
+    }
+}
+
+void QAPropertyWatchRegistry::release(QObject *object, int propertyIndex)
+{
+    m_waiters.remove(Key(object, propertyIndex));
+
+    QVector<int> &properties = m_properties[object];
+    properties.removeOne(propertyIndex);
+
+    // notify signal stays connected while another watched property uses it
+    const QMetaObject *mo = object->metaObject();
+    const int signalIndex = mo->property(propertyIndex).notifySignalIndex();
+    bool signalUsed = false;
+    for (int other : properties) {
+        signalUsed |= mo->property(other).notifySignalIndex() == signalIndex;
+    }
+    if (!signalUsed) {
+        QMetaObject::disconnect(object, signalIndex, this, m_notifySlot);
+    }
+
+    if (properties.isEmpty()) {
+        m_properties.remove(object);
+        disconnect(object, &QObject::destroyed, this, &QAPropertyWatchRegistry::onObjectDestroyed);
+    }
+}
@@ -0,0 +1,58 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#ifndef QAPROPERTYWATCHREGISTRY_HPP
+#define QAPROPERTYWATCHREGISTRY_HPP
+
+#include <QHash>
+#include <QObject>
+#include <QPair>
+#include <QVariant>
+#include <QVector>
+
+#include <functional>
+
+class QTimer;
+
+// Waits for property values without nested event loops. Any number of
+// waiters can watch the same property, each with its own predicate and
+// deadline. A notify signal is connected once per object and signal and
+// disconnected when the last waiter using it is gone.
+class QAPropertyWatchRegistry : public QObject
+{
+    Q_OBJECT
+public:
+    using Predicate = std::function<bool(const QVariant &value)>;
+    // satisfied is false when the deadline has passed or the object was destroyed
+    using Callback = std::function<void(bool satisfied, const QVariant &value)>;
+
+    explicit QAPropertyWatchRegistry(QObject *parent = nullptr);
+
+    // callback is called right away when the predicate already holds,
+    // returns false if the property does not exist or has no notify signal
+    bool watch(QObject *object, int propertyIndex, const Predicate &predicate, int timeout, const Callback &callback);
+    int size() const;
+
+private slots:
+    void onNotify();
+    void onObjectDestroyed(QObject *object);
+
+private:
+    using Key = QPair<QObject*, int>;
+
+    struct Waiter {
+        quint64 id = 0;
+        Predicate predicate;
+        Callback callback;
+        QTimer *timer = nullptr;
+    };
+
+    void onTimeout(const Key &key, quint64 id);
+    void release(QObject *object, int propertyIndex);
+
+    QHash<Key, QVector<Waiter>> m_waiters;
+    // watched property indexes of every object
+    QHash<QObject*, QVector<int>> m_properties;
+    quint64 m_lastId = 0;
+    int m_notifySlot = -1;
+};
+
+#endif // QAPROPERTYWATCHREGISTRY_HPP
@@ -0,0 +1,193 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#include "QAReplyStream.hpp"
+#include "QARequestClient.hpp"
+#include "ITransportClient.hpp"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <zlib.h>
+
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(categoryReplyStream, "omp.qaengine.reply", QtWarningMsg)
+
+namespace {
+
+const int c_partSize = 64 * 1024;
+const int c_compressionLevel = 9;
+const int c_deflateBufferSize = 16 * 1024;
+
+}
+
+QAReplyStream::QAReplyStream(ITransportClient *socket, Encoding encoding)
+    : m_socket(socket)
+    , m_encoding(encoding)
+{
+    QJsonObject header;
+    header.insert(QStringLiteral("status"), 0);
+    m_part.append("{\"status\":0,");
+    if (auto request = qobject_cast<QARequestClient*>(socket)) {
+        // same tag socketReply adds, serialized as a one element array
+        QJsonArray requestId;
+        requestId.append(request->requestId());
+        const QByteArray id = QJsonDocument(requestId).toJson(QJsonDocument::Compact);
+        m_part.append("\"id\":").append(id.mid(1, id.size() - 2)).append(',');
+        header.insert(QStringLiteral("id"), request->requestId());
+    }
+    m_part.append("\"value\":");
+    // receivers of parts learn status and id without parsing the reply,
+    // the bridge passes the value on with a start of its own
+    header.insert(QStringLiteral("valueOffset"), m_part.size());
+    m_part.append('"');
+    if (m_socket) {
+        m_socket->writeFrameHeader(QJsonDocument(header).toJson(QJsonDocument::Compact));
+    }
+
+    if (m_encoding == CompressedBase64) {
+        // qCompress header holds uncompressed size, zero makes qUncompress grow its buffer instead
+        appendBase64(QByteArray(sizeof(quint32), '\0'), false);
+
+        m_deflate = new z_stream();
+        deflateInit(m_deflate, c_compressionLevel);
+    }
+}
+
+QAReplyStream::~QAReplyStream()
+{
+    finish();
+}
+
+void QAReplyStream::write(const QString &text)
+{
+    write(text.toUtf8());
+}
+
+void QAReplyStream::write(const QByteArray &utf8)
+{
+    if (m_finished || utf8.isEmpty()) {
+        return;
+    }
+
+    if (m_encoding == PlainText) {
+        appendEscaped(utf8);
+    } else {
+        compress(utf8, false);
+    }
+
+    if (m_part.size() >= c_partSize) {
+        sendPart(false);
+    }
+}
+
+void QAReplyStream::finish()
+{
+    if (m_finished) {
+        return;
+    }
+    m_finished = true;
+
+    if (m_encoding == CompressedBase64) {
+        compress(QByteArray(), true);
+        deflateEnd(m_deflate);
+        delete m_deflate;
+        m_deflate = nullptr;
+        appendBase64(QByteArray(), true);
+    }
+
+    m_part.append("\"}");
+    sendPart(true);
+}
+
+void QAReplyStream::appendEscaped(const QByteArray &utf8)
+{
+    static const char hexDigits[] = "0123456789abcdef";
+
+    // characters not needing escaping are appended in runs
+    const char *data = utf8.constData();
+    const int size = utf8.size();
+    int runStart = 0;
+    for (int i = 0; i < size; i++) {
+        const uchar c = uchar(data[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+
+        m_part.append(data + runStart, i - runStart);
+        runStart = i + 1;
+
+        switch (c) {
+        case '"':
+            m_part.append("\\\"");
+            break;
+        case '\\':
+            m_part.append("\\\\");
+            break;
+        case '\n':
+            m_part.append("\\n");
+            break;
+        case '\r':
+            m_part.append("\\r");
+            break;
+        case '\t':
+            m_part.append("\\t");
+            break;
+        case '\b':
+            m_part.append("\\b");
+            break;
+        case '\f':
+            m_part.append("\\f");
+            break;
+        default:
+            m_part.append("\\u00");
+            m_part.append(hexDigits[c >> 4]);
+            m_part.append(hexDigits[c & 0xf]);
+            break;
+        }
+    }
+    m_part.append(data + runStart, size - runStart);
+}
+
+void QAReplyStream::appendBase64(const QByteArray &data, bool last)
+{
+    m_base64Tail.append(data);
+
+    // only complete groups of three bytes are encoded until the end of the value
+    const int size = last ? m_base64Tail.size() : m_base64Tail.size() - m_base64Tail.size() % 3;
+    if (size == 0) {
+        return;
+    }
+    m_part.append(QByteArray::fromRawData(m_base64Tail.constData(), size).toBase64());
+    m_base64Tail.remove(0, size);
+}
+
+void QAReplyStream::compress(const QByteArray &data, bool last)
+{
+    char buffer[c_deflateBufferSize];
+
+    m_deflate->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData()));
+    m_deflate->avail_in = uInt(data.size());
+    do {
+        m_deflate->next_out = reinterpret_cast<Bytef*>(buffer);
+        m_deflate->avail_out = sizeof(buffer);
+        deflate(m_deflate, last ? Z_FINISH : Z_NO_FLUSH);
+        appendBase64(QByteArray::fromRawData(buffer, int(sizeof(buffer) - m_deflate->avail_out)), false);
+    } while (m_deflate->avail_out == 0);
+}
+
+void QAReplyStream::sendPart(bool last)
+{
+    if (!m_socket) {
+        m_part.clear();
+        return;
+    }
+
+    qCDebug(categoryReplyStream)
+        << Q_FUNC_INFO
+        << m_socket << m_part.size() << last;
+
+    m_socket->writeFramePart(m_part, last);
+    m_socket->flush();
+    m_part.clear();
+}
@@ -0,0 +1,53 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#ifndef QAREPLYSTREAM_HPP
+#define QAREPLYSTREAM_HPP
+
+#include <QByteArray>
+#include <QPointer>
+#include <QString>
+
+class ITransportClient;
+struct z_stream_s;
+
+// Writes a successful reply with a string value while the value is still being
+// produced. Value is escaped, or compressed and base64 encoded, on the fly and
+// sent in frame parts of bounded size, so neither the value nor the reply is
+// kept in memory as a whole. Parts are preceded by a header frame with status,
+// id and the offset of the value in the reply. Reply is completed on finish()
+// or destruction.
+class QAReplyStream
+{
+public:
+    enum Encoding {
+        PlainText,
+        // qCompress format
+        CompressedBase64,
+    };
+
+    explicit QAReplyStream(ITransportClient *socket, Encoding encoding = PlainText);
+    ~QAReplyStream();
+
+    void write(const QString &text);
+    void write(const QByteArray &utf8);
+    void finish();
+
+private:
+    Q_DISABLE_COPY(QAReplyStream)
+
+    void appendEscaped(const QByteArray &utf8);
+    void appendBase64(const QByteArray &data, bool last);
+    void sendPart(bool last);
+    void compress(const QByteArray &data, bool last);
+
+    QPointer<ITransportClient> m_socket;
+    Encoding m_encoding = PlainText;
+    bool m_finished = false;
+
+    // encoded reply waiting to be sent
+    QByteArray m_part;
+    // compressed bytes not forming a complete base64 group yet
+    QByteArray m_base64Tail;
+    z_stream_s *m_deflate = nullptr;
+};
+
+#endif // QAREPLYSTREAM_HPP
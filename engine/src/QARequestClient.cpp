@@ -0,0 +1,92 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#include "QARequestClient.hpp"
+
+QARequestClient::QARequestClient(ITransportClient *client, const QJsonValue &requestId)
+    : ITransportClient(client)
+    , m_client(client)
+    , m_requestId(requestId)
+{
+}
+
+QJsonValue QARequestClient::requestId() const
+{
+    return m_requestId;
+}
+
+ITransportClient *QARequestClient::client() const
+{
+    return m_client;
+}
+
+qint64 QARequestClient::bytesAvailable()
+{
+    return 0;
+}
+
+QByteArray QARequestClient::readAll()
+{
+    return QByteArray();
+}
+
+bool QARequestClient::isOpen()
+{
+    return m_client && m_client->isOpen();
+}
+
+bool QARequestClient::isConnected()
+{
+    return m_client && m_client->isConnected();
+}
+
+void QARequestClient::close()
+{
+    if (m_client) {
+        m_client->close();
+    }
+}
+
+qint64 QARequestClient::write(const QByteArray &data)
+{
+    // every write is a complete reply to the request
+    deleteLater();
+
+    if (!m_client) {
+        return -1;
+    }
+    return m_client->writeFrame(data);
+}
+
+qint64 QARequestClient::writeFramePart(const QByteArray &data, bool last)
+{
+    if (last) {
+        deleteLater();
+    }
+
+    if (!m_client) {
+        return -1;
+    }
+    return m_client->writeFramePart(data, last);
+}
+
+qint64 QARequestClient::writeFrameHeader(const QByteArray &data)
+{
+    if (!m_client) {
+        return -1;
+    }
+    return m_client->writeFrameHeader(data);
+}
+
+bool QARequestClient::flush()
+{
+    return m_client && m_client->flush();
+}
+
+bool QARequestClient::waitForBytesWritten(int msecs)
+{
+    return m_client && m_client->waitForBytesWritten(msecs);
+}
+
+bool QARequestClient::waitForReadyRead(int msecs)
+{
+    return m_client && m_client->waitForReadyRead(msecs);
+}
@@ -0,0 +1,39 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#ifndef QAREQUESTCLIENT_HPP
+#define QAREQUESTCLIENT_HPP
+
+#include "ITransportClient.hpp"
+
+#include <QJsonValue>
+#include <QPointer>
+
+// Stands in for the bridge connection while a tagged request is processed.
+// Replies written through it are tagged with the request id by socketReply()
+// and the object removes itself once the reply is sent.
+class QARequestClient : public ITransportClient
+{
+    Q_OBJECT
+public:
+    explicit QARequestClient(ITransportClient *client, const QJsonValue &requestId);
+
+    QJsonValue requestId() const;
+    ITransportClient *client() const;
+
+    qint64 bytesAvailable() override;
+    QByteArray readAll() override;
+    bool isOpen() override;
+    bool isConnected() override;
+    void close() override;
+    qint64 write(const QByteArray &data) override;
+    qint64 writeFramePart(const QByteArray &data, bool last) override;
+    qint64 writeFrameHeader(const QByteArray &data) override;
+    bool flush() override;
+    bool waitForBytesWritten(int msecs) override;
+    bool waitForReadyRead(int msecs) override;
+
+private:
+    QPointer<ITransportClient> m_client;
+    QJsonValue m_requestId;
+};
+
+#endif // QAREQUESTCLIENT_HPP
@@ -0,0 +1,169 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#include "QASnapshotSearch.hpp"
+
+#include <QAtomicInt>
+#include <QRunnable>
+#include <QThreadPool>
+
+#include <limits>
+#include <vector>
+
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(categorySnapshotSearch, "omp.qaengine.snapshot.search", QtWarningMsg)
+
+namespace {
+
+const int c_minChunkSize = 256;
+// more chunks than threads keeps workers busy when matches are unevenly spread
+const int c_chunksPerThread = 4;
+
+}
+
+struct QASnapshotSearch::State
+{
+    QSharedPointer<const QATreeSnapshot> snapshot;
+    int root = 0;
+    int limit = -1;
+    Predicate predicate;
+    Evaluator evaluator;
+
+    // every task writes only its own element
+    std::vector<QVector<int>> matches;
+    QAtomicInt remaining;
+    // first chunk which has found limit matches already, chunks after it can stop
+    QAtomicInt satisfiedChunk {std::numeric_limits<int>::max()};
+
+    QASnapshotSearch *search = nullptr;
+};
+
+namespace {
+
+class SearchTask : public QRunnable
+{
+public:
+    SearchTask(const QSharedPointer<QASnapshotSearch::State> &state, int chunk, int begin, int end)
+        : m_state(state)
+        , m_chunk(chunk)
+        , m_begin(begin)
+        , m_end(end)
+    {
+    }
+
+    void run() override
+    {
+        QASnapshotSearch::State *state = m_state.data();
+        QVector<int> &matches = state->matches[m_chunk];
+
+        if (state->evaluator) {
+            matches = state->evaluator(state->snapshot.data());
+        } else {
+            for (int node = m_begin; node < m_end; node++) {
+                if (m_chunk > state->satisfiedChunk.load()) {
+                    break;
+                }
+                if (!state->predicate(state->snapshot.data(), node)) {
+                    continue;
+                }
+                matches.append(node);
+                if (state->limit >= 0 && matches.size() >= state->limit) {
+                    int satisfied = state->satisfiedChunk.load();
+                    while (m_chunk < satisfied && !state->satisfiedChunk.testAndSetOrdered(satisfied, m_chunk)) {
+                        satisfied = state->satisfiedChunk.load();
+                    }
+                    break;
+                }
+            }
+        }
+
+        if (!state->remaining.deref()) {
+            QMetaObject::invokeMethod(state->search, "onTasksFinished", Qt::QueuedConnection);
+        }
+    }
+
+private:
+    QSharedPointer<QASnapshotSearch::State> m_state;
+    int m_chunk = 0;
+    int m_begin = 0;
+    int m_end = 0;
+};
+
+}
+
+QASnapshotSearch *QASnapshotSearch::match(const QSharedPointer<const QATreeSnapshot> &snapshot, int root, const Predicate &predicate, int limit)
+{
+    QSharedPointer<State> state(new State);
+    state->snapshot = snapshot;
+    state->root = root;
+    state->limit = limit;
+    state->predicate = predicate;
+    return new QASnapshotSearch(state);
+}
+
+QASnapshotSearch *QASnapshotSearch::evaluate(const QSharedPointer<const QATreeSnapshot> &snapshot, const Evaluator &evaluator)
+{
+    QSharedPointer<State> state(new State);
+    state->snapshot = snapshot;
+    state->evaluator = evaluator;
+    return new QASnapshotSearch(state);
+}
+
+QASnapshotSearch::QASnapshotSearch(const QSharedPointer<State> &state)
+    : m_state(state)
+{
+    m_state->search = this;
+}
+
+void QASnapshotSearch::start(QThreadPool *pool)
+{
+    const QATreeSnapshot *snapshot = m_state->snapshot.data();
+
+    if (m_state->evaluator) {
+        m_state->matches.resize(1);
+        m_state->remaining.store(1);
+        pool->start(new SearchTask(m_state, 0, 0, 0));
+        return;
+    }
+
+    const int begin = m_state->root;
+    const int end = snapshot->subtreeEnd(begin);
+    const int chunks = qMax(1, pool->maxThreadCount() * c_chunksPerThread);
+    const int chunkSize = qMax(c_minChunkSize, (end - begin + chunks - 1) / chunks);
+    const int count = qMax(1, (end - begin + chunkSize - 1) / chunkSize);
+
+    qCDebug(categorySnapshotSearch)
+        << Q_FUNC_INFO
+        << begin << end << count << chunkSize << m_state->limit;
+
+    m_state->matches.resize(count);
+    m_state->remaining.store(count);
+    for (int chunk = 0; chunk < count; chunk++) {
+        const int chunkBegin = begin + chunk * chunkSize;
+        pool->start(new SearchTask(m_state, chunk, chunkBegin, qMin(end, chunkBegin + chunkSize)));
+    }
+}
+
+void QASnapshotSearch::onTasksFinished()
+{
+    const QATreeSnapshot *snapshot = m_state->snapshot.data();
+    const int limit = m_state->limit;
+
+    QObjectList items;
+    for (const QVector<int> &matches : m_state->matches) {
+        for (int node : matches) {
+            if (limit >= 0 && items.size() >= limit) {
+                break;
+            }
+            if (QObject *item = snapshot->object(node)) {
+                items.append(item);
+            }
+        }
+    }
+
+    qCDebug(categorySnapshotSearch)
+        << Q_FUNC_INFO
+        << items.size();
+
+    emit finished(items);
+    deleteLater();
+}
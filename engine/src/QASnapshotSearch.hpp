@@ -0,0 +1,46 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#ifndef QASNAPSHOTSEARCH_HPP
+#define QASNAPSHOTSEARCH_HPP
+
+#include "QATreeSnapshot.hpp"
+
+#include <QObject>
+#include <QSharedPointer>
+
+#include <functional>
+
+class QThreadPool;
+
+// Evaluates a selector over a QATreeSnapshot in a thread pool.
+// Predicate searches split the subtree into chunks evaluated in parallel,
+// evaluator searches run as a single task. Result is delivered in the thread
+// the search was created in, then the search object deletes itself.
+class QASnapshotSearch : public QObject
+{
+    Q_OBJECT
+public:
+    // called in worker threads, should only read the snapshot
+    using Predicate = std::function<bool(const QATreeSnapshot *snapshot, int node)>;
+    using Evaluator = std::function<QVector<int>(const QATreeSnapshot *snapshot)>;
+
+    struct State;
+
+    static QASnapshotSearch *match(const QSharedPointer<const QATreeSnapshot> &snapshot, int root, const Predicate &predicate, int limit = -1);
+    static QASnapshotSearch *evaluate(const QSharedPointer<const QATreeSnapshot> &snapshot, const Evaluator &evaluator);
+
+    void start(QThreadPool *pool);
+
+signals:
+    // nodes in document order, objects destroyed meanwhile are skipped
+    void finished(const QObjectList &items);
+
+private slots:
+    void onTasksFinished();
+
+private:
+    explicit QASnapshotSearch(const QSharedPointer<State> &state);
+
+    QSharedPointer<State> m_state;
+};
+
+#endif // QASNAPSHOTSEARCH_HPP
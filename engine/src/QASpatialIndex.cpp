@@ -0,0 +1,194 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#include "QASpatialIndex.hpp"
+
+#include <algorithm>
+
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(categorySpatialIndex, "omp.qaengine.spatial", QtWarningMsg)
+
+namespace {
+
+const int c_cellSize = 64;
+// scrolled content can be far larger than the screen, grid size is limited instead of cell size
+const int c_maxCellsPerSide = 64;
+
+// node with its ancestors, root first
+QVector<int> ancestorPath(const QATreeSnapshot *snapshot, int node)
+{
+    QVector<int> path;
+    for (; node >= 0; node = snapshot->parent(node)) {
+        path.append(node);
+    }
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+// true when the node at the end of left is drawn above the one at the end of right
+bool isAbove(const QATreeSnapshot *snapshot, const QVector<int> &left, const QVector<int> &right)
+{
+    int level = 0;
+    while (level < left.size() && level < right.size() && left.at(level) == right.at(level)) {
+        level++;
+    }
+
+    if (level == left.size() && level == right.size()) {
+        return false;
+    }
+    // one is an ancestor of the other, the descendant is above unless its branch is below the parent
+    if (level == left.size()) {
+        return snapshot->z(right.at(level)) < 0;
+    }
+    if (level == right.size()) {
+        return snapshot->z(left.at(level)) >= 0;
+    }
+
+    // different branches are ordered by their sibling roots
+    const qreal leftZ = snapshot->z(left.at(level));
+    const qreal rightZ = snapshot->z(right.at(level));
+    if (leftZ != rightZ) {
+        return leftZ > rightZ;
+    }
+    return left.at(level) > right.at(level);
+}
+
+}
+
+QASpatialIndex::QASpatialIndex(const QSharedPointer<const QATreeSnapshot> &snapshot)
+    : m_snapshot(snapshot)
+{
+    const int size = snapshot->size();
+    for (int node = 0; node < size; node++) {
+        const QRect rect = snapshot->visibleRect(node);
+        if (!rect.isEmpty()) {
+            m_bounds |= rect;
+        }
+    }
+    if (m_bounds.isEmpty()) {
+        return;
+    }
+
+    m_columns = qBound(1, (m_bounds.width() + c_cellSize - 1) / c_cellSize, c_maxCellsPerSide);
+    m_rows = qBound(1, (m_bounds.height() + c_cellSize - 1) / c_cellSize, c_maxCellsPerSide);
+    m_cellWidth = (m_bounds.width() + m_columns - 1) / m_columns;
+    m_cellHeight = (m_bounds.height() + m_rows - 1) / m_rows;
+
+    // counted first, so every cell is a slice of one flat array
+    m_cellStarts.fill(0, m_columns * m_rows + 1);
+    int left = 0;
+    int top = 0;
+    int right = 0;
+    int bottom = 0;
+    for (int node = 0; node < size; node++) {
+        if (!cellRange(snapshot->visibleRect(node), &left, &top, &right, &bottom)) {
+            continue;
+        }
+        for (int row = top; row <= bottom; row++) {
+            for (int column = left; column <= right; column++) {
+                m_cellStarts[row * m_columns + column + 1]++;
+            }
+        }
+    }
+    for (int cell = 0; cell < m_columns * m_rows; cell++) {
+        m_cellStarts[cell + 1] += m_cellStarts.at(cell);
+    }
+
+    m_cellNodes.resize(m_cellStarts.last());
+    QVector<int> positions = m_cellStarts;
+    for (int node = 0; node < size; node++) {
+        if (!cellRange(snapshot->visibleRect(node), &left, &top, &right, &bottom)) {
+            continue;
+        }
+        for (int row = top; row <= bottom; row++) {
+            for (int column = left; column <= right; column++) {
+                m_cellNodes[positions[row * m_columns + column]++] = node;
+            }
+        }
+    }
+
+    qCDebug(categorySpatialIndex)
+        << Q_FUNC_INFO
+        << m_bounds << m_columns << m_rows << m_cellNodes.size();
+}
+
+QSharedPointer<const QATreeSnapshot> QASpatialIndex::snapshot() const
+{
+    return m_snapshot;
+}
+
+QVector<int> QASpatialIndex::nodesAt(const QPoint &point) const
+{
+    QVector<int> nodes;
+    if (!m_bounds.contains(point)) {
+        return nodes;
+    }
+
+    const int cell = (point.y() - m_bounds.y()) / m_cellHeight * m_columns + (point.x() - m_bounds.x()) / m_cellWidth;
+    QVector<QVector<int>> paths;
+    for (int i = m_cellStarts.at(cell); i < m_cellStarts.at(cell + 1); i++) {
+        const int node = m_cellNodes.at(i);
+        if (m_snapshot->visibleRect(node).contains(point)) {
+            paths.append(ancestorPath(m_snapshot.data(), node));
+        }
+    }
+
+    const QATreeSnapshot *snapshot = m_snapshot.data();
+    std::sort(paths.begin(), paths.end(), [snapshot](const QVector<int> &left, const QVector<int> &right) {
+        return isAbove(snapshot, left, right);
+    });
+
+    nodes.reserve(paths.size());
+    for (const QVector<int> &path : paths) {
+        nodes.append(path.last());
+    }
+    return nodes;
+}
+
+QVector<int> QASpatialIndex::nodesIn(const QRect &rect) const
+{
+    QVector<int> nodes;
+    int left = 0;
+    int top = 0;
+    int right = 0;
+    int bottom = 0;
+    if (!cellRange(rect, &left, &top, &right, &bottom)) {
+        return nodes;
+    }
+
+    for (int row = top; row <= bottom; row++) {
+        for (int column = left; column <= right; column++) {
+            const int cell = row * m_columns + column;
+            for (int i = m_cellStarts.at(cell); i < m_cellStarts.at(cell + 1); i++) {
+                const int node = m_cellNodes.at(i);
+                const QRect nodeRect = m_snapshot->visibleRect(node);
+                if (!rect.contains(nodeRect)) {
+                    continue;
+                }
+                // node spanning several cells is reported by its top left cell only
+                int nodeLeft = 0;
+                int nodeTop = 0;
+                int nodeRight = 0;
+                int nodeBottom = 0;
+                cellRange(nodeRect, &nodeLeft, &nodeTop, &nodeRight, &nodeBottom);
+                if (nodeLeft == column && nodeTop == row) {
+                    nodes.append(node);
+                }
+            }
+        }
+    }
+    std::sort(nodes.begin(), nodes.end());
+    return nodes;
+}
+
+bool QASpatialIndex::cellRange(const QRect &rect, int *left, int *top, int *right, int *bottom) const
+{
+    const QRect clipped = rect & m_bounds;
+    if (clipped.isEmpty()) {
+        return false;
+    }
+    *left = (clipped.left() - m_bounds.x()) / m_cellWidth;
+    *top = (clipped.top() - m_bounds.y()) / m_cellHeight;
+    *right = (clipped.right() - m_bounds.x()) / m_cellWidth;
+    *bottom = (clipped.bottom() - m_bounds.y()) / m_cellHeight;
+    return true;
+}
@@ -0,0 +1,43 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#ifndef QASPATIALINDEX_HPP
+#define QASPATIALINDEX_HPP
+
+#include "QATreeSnapshot.hpp"
+
+#include <QRect>
+#include <QSharedPointer>
+#include <QVector>
+
+// Uniform grid over visible rects of a QATreeSnapshot for point and region
+// lookups. Of two overlapping nodes the one drawn on top is decided as in
+// QtQuick: siblings stack by z and then by preorder, descendants are drawn
+// above their ancestors unless their branch has negative z.
+class QASpatialIndex
+{
+public:
+    explicit QASpatialIndex(const QSharedPointer<const QATreeSnapshot> &snapshot);
+
+    QSharedPointer<const QATreeSnapshot> snapshot() const;
+
+    // visible nodes containing the point, topmost first
+    QVector<int> nodesAt(const QPoint &point) const;
+    // visible nodes lying fully inside the rect, in document order
+    QVector<int> nodesIn(const QRect &rect) const;
+
+private:
+    bool cellRange(const QRect &rect, int *left, int *top, int *right, int *bottom) const;
+
+    QSharedPointer<const QATreeSnapshot> m_snapshot;
+
+    QRect m_bounds;
+    int m_columns = 0;
+    int m_rows = 0;
+    int m_cellWidth = 1;
+    int m_cellHeight = 1;
+
+    // nodes of cell i are m_cellNodes[m_cellStarts[i], m_cellStarts[i + 1]) in document order
+    QVector<int> m_cellStarts;
+    QVector<int> m_cellNodes;
+};
+
+#endif // QASPATIALINDEX_HPP
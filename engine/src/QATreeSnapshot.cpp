@@ -0,0 +1,335 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#include "QATreeSnapshot.hpp"
+
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(categoryTreeSnapshot, "omp.qaengine.snapshot", QtWarningMsg)
+
+QATreeSnapshot::XPathModel::XPathModel(const QATreeSnapshot *snapshot)
+    : m_snapshot(snapshot)
+{
+}
+
+QObjectList QATreeSnapshot::XPathModel::children(QObject *item)
+{
+    QObjectList result;
+
+    const int node = m_snapshot->indexOf(item);
+    if (node < 0) {
+        return result;
+    }
+
+    const int end = m_snapshot->subtreeEnd(node);
+    for (int child = node + 1; child < end; child = m_snapshot->subtreeEnd(child)) {
+        result.append(m_snapshot->item(child));
+    }
+    return result;
+}
+
+QObject *QATreeSnapshot::XPathModel::parent(QObject *item)
+{
+    const int node = m_snapshot->indexOf(item);
+    if (node < 0) {
+        return nullptr;
+    }
+    return m_snapshot->item(m_snapshot->parent(node));
+}
+
+QString QATreeSnapshot::XPathModel::name(QObject *item)
+{
+    return m_snapshot->className(m_snapshot->indexOf(item));
+}
+
+QString QATreeSnapshot::XPathModel::text(QObject *item)
+{
+    return m_snapshot->text(m_snapshot->indexOf(item));
+}
+
+bool QATreeSnapshot::XPathModel::attribute(QObject *item, const QString &name, QString *value)
+{
+    const int node = m_snapshot->indexOf(item);
+    if (node < 0) {
+        return false;
+    }
+
+    const int property = m_snapshot->propertyIndex(name);
+    if (property >= 0) {
+        *value = m_snapshot->property(node, property);
+        return !value->isNull();
+    }
+
+    if (name == QLatin1String("objectName")) {
+        *value = m_snapshot->objectName(node);
+    } else if (name == QLatin1String("mainTextProperty")) {
+        *value = m_snapshot->text(node);
+    } else if (name == QLatin1String("abs_x")) {
+        *value = QString::number(m_snapshot->absGeometry(node).x());
+    } else if (name == QLatin1String("abs_y")) {
+        *value = QString::number(m_snapshot->absGeometry(node).y());
+    } else if (name == QLatin1String("x")) {
+        *value = QString::number(m_snapshot->geometry(node).x());
+    } else if (name == QLatin1String("y")) {
+        *value = QString::number(m_snapshot->geometry(node).y());
+    } else if (name == QLatin1String("width")) {
+        *value = QString::number(m_snapshot->geometry(node).width());
+    } else if (name == QLatin1String("height")) {
+        *value = QString::number(m_snapshot->geometry(node).height());
+    } else if (name == QLatin1String("visible")) {
+        *value = m_snapshot->isVisible(node) ? QStringLiteral("true") : QStringLiteral("false");
+    } else if (name == QLatin1String("enabled")) {
+        *value = m_snapshot->isEnabled(node) ? QStringLiteral("true") : QStringLiteral("false");
+    } else {
+        return false;
+    }
+    return true;
+}
+
+QATreeSnapshot::QATreeSnapshot(const QStringList &properties)
+    : m_properties(properties)
+    , m_propertyValues(properties.size())
+{
+}
+
+int QATreeSnapshot::append(QObject *item, int parent)
+{
+    const int node = m_items.size();
+
+    m_items.append(item);
+    m_objects.append(item);
+    m_indexByObject.insert(item, node);
+    m_parents.append(parent);
+    m_subtreeEnds.append(node + 1);
+    m_classIds.append(-1);
+    m_objectNames.append(QString());
+    m_texts.append(QString());
+    m_geometries.append(QRect());
+    m_absGeometries.append(QRect());
+    m_visibleRects.append(QRect());
+    m_visible.append(false);
+    m_enabled.append(false);
+    m_z.append(0);
+    for (QVector<QString> &values : m_propertyValues) {
+        values.append(QString());
+    }
+
+    return node;
+}
+
+int QATreeSnapshot::appendCopy(const QATreeSnapshot *other, int node, int parent)
+{
+    const int copy = m_items.size();
+
+    // object may be gone already, pointer is taken over without dereferencing
+    QObject *item = other->m_items.at(node);
+    m_items.append(item);
+    m_objects.append(other->m_objects.at(node));
+    m_indexByObject.insert(item, copy);
+    m_parents.append(parent);
+    m_subtreeEnds.append(copy + 1);
+    m_classIds.append(-1);
+    m_objectNames.append(other->m_objectNames.at(node));
+    m_texts.append(other->m_texts.at(node));
+    m_geometries.append(other->m_geometries.at(node));
+    m_absGeometries.append(other->m_absGeometries.at(node));
+    m_visibleRects.append(other->m_visibleRects.at(node));
+    m_visible.append(other->m_visible.at(node));
+    m_enabled.append(other->m_enabled.at(node));
+    m_z.append(other->m_z.at(node));
+    for (int property = 0; property < m_propertyValues.size(); property++) {
+        m_propertyValues[property].append(other->property(node, property));
+    }
+    setClassName(copy, other->className(node));
+
+    return copy;
+}
+
+void QATreeSnapshot::appendSubtreeCopy(const QATreeSnapshot *other, int node, int parent)
+{
+    // preorder is kept, so parents of copied descendants move by the same offset
+    const int offset = m_items.size() - node;
+    const int end = other->subtreeEnd(node);
+    for (int i = node; i < end; i++) {
+        appendCopy(other, i, i == node ? parent : other->parent(i) + offset);
+    }
+}
+
+void QATreeSnapshot::setGeneration(int generation)
+{
+    m_generation = generation;
+}
+
+void QATreeSnapshot::setClassName(int node, const QString &className)
+{
+    int classId = m_classIdByName.value(className, -1);
+    if (classId < 0) {
+        classId = m_classNames.size();
+        m_classNames.append(className);
+        m_classIdByName.insert(className, classId);
+    }
+    m_classIds[node] = classId;
+}
+
+void QATreeSnapshot::setObjectName(int node, const QString &objectName)
+{
+    m_objectNames[node] = objectName;
+}
+
+void QATreeSnapshot::setText(int node, const QString &text)
+{
+    m_texts[node] = text;
+}
+
+void QATreeSnapshot::setGeometry(int node, const QRect &geometry, const QRect &absGeometry)
+{
+    m_geometries[node] = geometry;
+    m_absGeometries[node] = absGeometry;
+}
+
+void QATreeSnapshot::setVisibleRect(int node, const QRect &visibleRect)
+{
+    m_visibleRects[node] = visibleRect;
+}
+
+void QATreeSnapshot::setVisible(int node, bool visible)
+{
+    m_visible[node] = visible;
+}
+
+void QATreeSnapshot::setEnabled(int node, bool enabled)
+{
+    m_enabled[node] = enabled;
+}
+
+void QATreeSnapshot::setZ(int node, qreal z)
+{
+    m_z[node] = z;
+}
+
+void QATreeSnapshot::setProperty(int node, int property, const QString &value)
+{
+    m_propertyValues[property][node] = value;
+}
+
+void QATreeSnapshot::seal()
+{
+    // children always follow their parent in preorder, so one backward pass
+    // extends every parent range over the ranges of its children
+    for (int node = m_parents.size() - 1; node > 0; node--) {
+        const int parent = m_parents.at(node);
+        if (parent >= 0 && m_subtreeEnds.at(parent) < m_subtreeEnds.at(node)) {
+            m_subtreeEnds[parent] = m_subtreeEnds.at(node);
+        }
+    }
+
+    qCDebug(categoryTreeSnapshot)
+        << Q_FUNC_INFO
+        << m_items.size() << m_classNames.size() << m_properties;
+}
+
+int QATreeSnapshot::generation() const
+{
+    return m_generation;
+}
+
+int QATreeSnapshot::size() const
+{
+    return m_items.size();
+}
+
+int QATreeSnapshot::parent(int node) const
+{
+    return m_parents.value(node, -1);
+}
+
+int QATreeSnapshot::subtreeEnd(int node) const
+{
+    return m_subtreeEnds.value(node, node + 1);
+}
+
+int QATreeSnapshot::indexOf(QObject *item) const
+{
+    return m_indexByObject.value(item, -1);
+}
+
+QObject *QATreeSnapshot::item(int node) const
+{
+    return m_items.value(node);
+}
+
+QObject *QATreeSnapshot::object(int node) const
+{
+    return m_objects.value(node).data();
+}
+
+int QATreeSnapshot::classId(int node) const
+{
+    return m_classIds.value(node, -1);
+}
+
+QStringList QATreeSnapshot::classNames() const
+{
+    return m_classNames;
+}
+
+QString QATreeSnapshot::className(int node) const
+{
+    return m_classNames.value(classId(node));
+}
+
+QString QATreeSnapshot::objectName(int node) const
+{
+    return m_objectNames.value(node);
+}
+
+QString QATreeSnapshot::text(int node) const
+{
+    return m_texts.value(node);
+}
+
+QRect QATreeSnapshot::geometry(int node) const
+{
+    return m_geometries.value(node);
+}
+
+QRect QATreeSnapshot::absGeometry(int node) const
+{
+    return m_absGeometries.value(node);
+}
+
+QRect QATreeSnapshot::visibleRect(int node) const
+{
+    return m_visibleRects.value(node);
+}
+
+bool QATreeSnapshot::isVisible(int node) const
+{
+    return m_visible.value(node);
+}
+
+bool QATreeSnapshot::isEnabled(int node) const
+{
+    return m_enabled.value(node);
+}
+
+qreal QATreeSnapshot::z(int node) const
+{
+    return m_z.value(node);
+}
+
+QStringList QATreeSnapshot::properties() const
+{
+    return m_properties;
+}
+
+int QATreeSnapshot::propertyIndex(const QString &name) const
+{
+    return m_properties.indexOf(name);
+}
+
+QString QATreeSnapshot::property(int node, int property) const
+{
+    if (property < 0 || property >= m_propertyValues.size()) {
+        return QString();
+    }
+    return m_propertyValues.at(property).value(node);
+}
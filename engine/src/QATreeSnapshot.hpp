@@ -0,0 +1,110 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#ifndef QATREESNAPSHOT_HPP
+#define QATREESNAPSHOT_HPP
+
+#include "QAXPathEvaluator.hpp"
+
+#include <QHash>
+#include <QPointer>
+#include <QRect>
+#include <QStringList>
+#include <QVector>
+
+// Immutable copy of the visual tree taken on the GUI thread, so selectors can
+// be evaluated in worker threads without touching live objects.
+// Nodes are stored in preorder as columns, node 0 is the root, descendants
+// of a node are the range (node, subtreeEnd(node)).
+class QATreeSnapshot
+{
+public:
+    // Exposes the snapshot to QAXPathEvaluator, node objects are only used as
+    // identities and never dereferenced, so it is safe in any thread
+    class XPathModel : public QAXPathEvaluator::Model
+    {
+    public:
+        explicit XPathModel(const QATreeSnapshot *snapshot);
+
+        QObjectList children(QObject *item) override;
+        QObject *parent(QObject *item) override;
+        QString name(QObject *item) override;
+        QString text(QObject *item) override;
+        bool attribute(QObject *item, const QString &name, QString *value) override;
+
+    private:
+        const QATreeSnapshot *m_snapshot = nullptr;
+    };
+
+    explicit QATreeSnapshot(const QStringList &properties = QStringList());
+
+    // building, owner thread only
+    int append(QObject *item, int parent);
+    // nodes taken over from a previous snapshot of unchanged items
+    int appendCopy(const QATreeSnapshot *other, int node, int parent);
+    void appendSubtreeCopy(const QATreeSnapshot *other, int node, int parent);
+    void setGeneration(int generation);
+    void setClassName(int node, const QString &className);
+    void setObjectName(int node, const QString &objectName);
+    void setText(int node, const QString &text);
+    void setGeometry(int node, const QRect &geometry, const QRect &absGeometry);
+    // part of absGeometry not clipped by ancestors, empty for hidden items
+    void setVisibleRect(int node, const QRect &visibleRect);
+    void setVisible(int node, bool visible);
+    void setEnabled(int node, bool enabled);
+    // stacking order among siblings, negative values are drawn below the parent
+    void setZ(int node, qreal z);
+    // null value means the item has no such property
+    void setProperty(int node, int property, const QString &value);
+    void seal();
+
+    // tree generation the snapshot was taken at
+    int generation() const;
+    int size() const;
+    int parent(int node) const;
+    int subtreeEnd(int node) const;
+    int indexOf(QObject *item) const;
+    QObject *item(int node) const;
+    // null once the object is destroyed, owner thread only
+    QObject *object(int node) const;
+
+    int classId(int node) const;
+    QStringList classNames() const;
+    QString className(int node) const;
+    QString objectName(int node) const;
+    QString text(int node) const;
+    QRect geometry(int node) const;
+    QRect absGeometry(int node) const;
+    QRect visibleRect(int node) const;
+    bool isVisible(int node) const;
+    bool isEnabled(int node) const;
+    qreal z(int node) const;
+
+    QStringList properties() const;
+    int propertyIndex(const QString &name) const;
+    QString property(int node, int property) const;
+
+private:
+    int m_generation = 0;
+
+    QVector<QObject*> m_items;
+    QVector<QPointer<QObject>> m_objects;
+    QHash<QObject*, int> m_indexByObject;
+
+    QVector<int> m_parents;
+    QVector<int> m_subtreeEnds;
+    QVector<int> m_classIds;
+    QStringList m_classNames;
+    QHash<QString, int> m_classIdByName;
+    QVector<QString> m_objectNames;
+    QVector<QString> m_texts;
+    QVector<QRect> m_geometries;
+    QVector<QRect> m_absGeometries;
+    QVector<QRect> m_visibleRects;
+    QVector<bool> m_visible;
+    QVector<bool> m_enabled;
+    QVector<qreal> m_z;
+
+    QStringList m_properties;
+    QVector<QVector<QString>> m_propertyValues;
+};
+
+#endif // QATREESNAPSHOT_HPP
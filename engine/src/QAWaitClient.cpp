@@ -0,0 +1,171 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#include "QAWaitClient.hpp"
+
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QTimer>
+
+Q_LOGGING_CATEGORY(categoryWait, "omp.qaengine.wait", QtWarningMsg)
+
+namespace {
+
+bool isEmptyReply(const QJsonValue &value)
+{
+    return value.isNull()
+        || value.isUndefined()
+        || (value.isString() && value.toString().isEmpty())
+        || (value.isArray() && value.toArray().isEmpty());
+}
+
+}
+
+QAWaitClient::QAWaitClient(ITransportClient *client, int timeout)
+    : ITransportClient(client)
+    , m_client(client)
+    , m_deadlineTimer(new QTimer(this))
+{
+    m_deadlineTimer->setSingleShot(true);
+    m_deadlineTimer->setInterval(timeout);
+    connect(m_deadlineTimer, &QTimer::timeout, this, &QAWaitClient::onTimeout);
+}
+
+ITransportClient *QAWaitClient::client() const
+{
+    return m_client;
+}
+
+void QAWaitClient::start()
+{
+    m_deadlineTimer->start();
+    QMetaObject::invokeMethod(this, "attempt", Qt::QueuedConnection);
+}
+
+void QAWaitClient::setGeneration(int generation)
+{
+    m_generation = generation;
+}
+
+qint64 QAWaitClient::bytesAvailable()
+{
+    return 0;
+}
+
+QByteArray QAWaitClient::readAll()
+{
+    return QByteArray();
+}
+
+bool QAWaitClient::isOpen()
+{
+    return m_client && m_client->isOpen();
+}
+
+bool QAWaitClient::isConnected()
+{
+    return m_client && m_client->isConnected();
+}
+
+void QAWaitClient::close()
+{
+    if (m_client) {
+        m_client->close();
+    }
+}
+
+qint64 QAWaitClient::write(const QByteArray &data)
+{
+    if (!m_pending) {
+        qCWarning(categoryWait)
+            << Q_FUNC_INFO
+            << "Unexpected reply:" << data;
+        return data.size();
+    }
+    m_pending = false;
+
+    const QJsonObject reply = QJsonDocument::fromJson(data).object();
+    m_value = reply.value(QStringLiteral("value"));
+    m_status = reply.value(QStringLiteral("status")).toInt(1);
+
+    if (m_status != 0 || !isEmptyReply(m_value) || m_expired || !m_client) {
+        finish();
+    } else if (m_changedGeneration > m_generation) {
+        // tree has changed while the attempt was evaluated
+        QMetaObject::invokeMethod(this, "attempt", Qt::QueuedConnection);
+    }
+    return data.size();
+}
+
+qint64 QAWaitClient::writeFramePart(const QByteArray &data, bool last)
+{
+    m_parts.append(data);
+    if (last) {
+        const QByteArray reply = m_parts;
+        m_parts.clear();
+        write(reply);
+    }
+    return data.size();
+}
+
+bool QAWaitClient::flush()
+{
+    return true;
+}
+
+bool QAWaitClient::waitForBytesWritten(int)
+{
+    return true;
+}
+
+bool QAWaitClient::waitForReadyRead(int)
+{
+    return false;
+}
+
+void QAWaitClient::onTreeChanged(int generation)
+{
+    m_changedGeneration = qMax(m_changedGeneration, generation);
+    if (!m_pending && m_attempts > 0 && m_changedGeneration > m_generation) {
+        attempt();
+    }
+}
+
+void QAWaitClient::attempt()
+{
+    if (m_pending || m_expired || m_finished) {
+        return;
+    }
+    m_pending = true;
+    m_attempts++;
+
+    qCDebug(categoryWait)
+        << Q_FUNC_INFO
+        << m_attempts << m_generation << m_changedGeneration;
+
+    emit attemptRequested(this);
+}
+
+void QAWaitClient::onTimeout()
+{
+    m_expired = true;
+    // pending attempt is finished by its reply
+    if (!m_pending) {
+        finish();
+    }
+}
+
+void QAWaitClient::finish()
+{
+    qCDebug(categoryWait)
+        << Q_FUNC_INFO
+        << m_attempts << m_status;
+
+    m_finished = true;
+    m_deadlineTimer->stop();
+    if (m_client) {
+        emit finished(m_client, m_value, m_status);
+    }
+    deleteLater();
+}
@@ -0,0 +1,68 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#ifndef QAWAITCLIENT_HPP
+#define QAWAITCLIENT_HPP
+
+#include "ITransportClient.hpp"
+
+#include <QJsonValue>
+#include <QPointer>
+
+class QTimer;
+
+// Repeats a lookup until it finds something or the timeout expires. Every
+// attempt is processed with this object as its socket, so an empty reply is
+// kept here instead of being sent to the bridge. Attempts are requested on
+// tree changes only, the last reply is delivered by finished().
+class QAWaitClient : public ITransportClient
+{
+    Q_OBJECT
+public:
+    explicit QAWaitClient(ITransportClient *client, int timeout);
+
+    ITransportClient *client() const;
+    void start();
+    // tree generation the current attempt is evaluated at
+    void setGeneration(int generation);
+
+    qint64 bytesAvailable() override;
+    QByteArray readAll() override;
+    bool isOpen() override;
+    bool isConnected() override;
+    void close() override;
+    qint64 write(const QByteArray &data) override;
+    qint64 writeFramePart(const QByteArray &data, bool last) override;
+    bool flush() override;
+    bool waitForBytesWritten(int msecs) override;
+    bool waitForReadyRead(int msecs) override;
+
+public slots:
+    void onTreeChanged(int generation);
+
+signals:
+    void attemptRequested(ITransportClient *socket);
+    void finished(ITransportClient *socket, const QJsonValue &value, int status);
+
+private slots:
+    void attempt();
+    void onTimeout();
+
+private:
+    void finish();
+
+    QPointer<ITransportClient> m_client;
+    QTimer *m_deadlineTimer = nullptr;
+
+    bool m_pending = false;
+    bool m_expired = false;
+    bool m_finished = false;
+    int m_generation = -1;
+    int m_changedGeneration = -1;
+    int m_attempts = 0;
+
+    QJsonValue m_value;
+    int m_status = 0;
+    // reply written in parts is handled once it is complete
+    QByteArray m_parts;
+};
+
+#endif // QAWAITCLIENT_HPP
@@ -0,0 +1,1647 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#include "QAXPathEvaluator.hpp"
+
+#include <QHash>
+#include <QRegularExpression>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+namespace {
+
+struct Token
+{
+    enum Type {
+        End,
+        Slash,
+        DoubleSlash,
+        LeftBracket,
+        RightBracket,
+        LeftParen,
+        RightParen,
+        At,
+        Comma,
+        Pipe,
+        Dot,
+        DoubleDot,
+        DoubleColon,
+        Equal,
+        NotEqual,
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual,
+        Plus,
+        Minus,
+        Star,
+        Name,
+        Literal,
+        Number,
+    };
+
+    Type type = End;
+    QString text;
+    double number = 0;
+};
+
+enum Axis {
+    ChildAxis,
+    DescendantAxis,
+    DescendantOrSelfAxis,
+    SelfAxis,
+    ParentAxis,
+    AncestorAxis,
+    AncestorOrSelfAxis,
+    FollowingSiblingAxis,
+    PrecedingSiblingAxis,
+    AttributeAxis,
+};
+
+enum NodeTest {
+    NameTest,
+    AnyElementTest,
+    AnyNodeTest,
+    TextTest,
+};
+
+enum Function {
+    PositionFunction,
+    LastFunction,
+    CountFunction,
+    NotFunction,
+    TrueFunction,
+    FalseFunction,
+    BooleanFunction,
+    StringFunction,
+    NumberFunction,
+    StringLengthFunction,
+    NormalizeSpaceFunction,
+    ContainsFunction,
+    StartsWithFunction,
+    EndsWithFunction,
+    MatchesFunction,
+    ConcatFunction,
+    LowerCaseFunction,
+    UpperCaseFunction,
+    NameFunction,
+};
+
+struct FunctionInfo
+{
+    const char *name;
+    Function function;
+    int minArguments;
+    int maxArguments;
+};
+
+const FunctionInfo c_functions[] = {
+    {"position", PositionFunction, 0, 0},
+    {"last", LastFunction, 0, 0},
+    {"count", CountFunction, 1, 1},
+    {"not", NotFunction, 1, 1},
+    {"true", TrueFunction, 0, 0},
+    {"false", FalseFunction, 0, 0},
+    {"boolean", BooleanFunction, 1, 1},
+    {"string", StringFunction, 0, 1},
+    {"number", NumberFunction, 0, 1},
+    {"string-length", StringLengthFunction, 0, 1},
+    {"normalize-space", NormalizeSpaceFunction, 0, 1},
+    {"contains", ContainsFunction, 2, 2},
+    {"starts-with", StartsWithFunction, 2, 2},
+    {"ends-with", EndsWithFunction, 2, 2},
+    {"matches", MatchesFunction, 2, 3},
+    {"concat", ConcatFunction, 2, std::numeric_limits<int>::max()},
+    {"lower-case", LowerCaseFunction, 1, 1},
+    {"upper-case", UpperCaseFunction, 1, 1},
+    {"name", NameFunction, 0, 1},
+    {"local-name", NameFunction, 0, 1},
+};
+
+struct Expression;
+typedef QSharedPointer<Expression> ExpressionPtr;
+
+struct Step
+{
+    Axis axis = ChildAxis;
+    NodeTest test = NameTest;
+    QString name;
+    QVector<ExpressionPtr> predicates;
+    bool positional = false; // some predicate depends on context position or size
+};
+
+struct Path
+{
+    bool absolute = false;
+    QVector<Step> steps;
+};
+
+struct Expression
+{
+    enum Type {
+        Or,
+        And,
+        Equal,
+        NotEqual,
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual,
+        Add,
+        Subtract,
+        Multiply,
+        Divide,
+        Modulo,
+        Negate,
+        Literal,
+        Number,
+        FunctionCall,
+        LocationPath,
+    };
+
+    Type type = Literal;
+    QVector<ExpressionPtr> arguments;
+    QString string;
+    double number = 0;
+    Function function = PositionFunction;
+    Path path;
+};
+
+bool isNameStart(QChar c)
+{
+    return c.isLetter() || c == QLatin1Char('_');
+}
+
+bool isNameChar(QChar c)
+{
+    return c.isLetterOrNumber() || c == QLatin1Char('_') || c == QLatin1Char('-') || c == QLatin1Char('.');
+}
+
+bool tokenize(const QString &xpath, QVector<Token> *tokens, QString *error)
+{
+    const int size = xpath.size();
+    int i = 0;
+    while (i < size) {
+        const QChar c = xpath.at(i);
+        const QChar n = i + 1 < size ? xpath.at(i + 1) : QChar();
+
+        if (c.isSpace()) {
+            i++;
+            continue;
+        }
+
+        Token token;
+        if (c == QLatin1Char('/')) {
+            token.type = n == QLatin1Char('/') ? Token::DoubleSlash : Token::Slash;
+        } else if (c == QLatin1Char('[')) {
+            token.type = Token::LeftBracket;
+        } else if (c == QLatin1Char(']')) {
+            token.type = Token::RightBracket;
+        } else if (c == QLatin1Char('(')) {
+            token.type = Token::LeftParen;
+        } else if (c == QLatin1Char(')')) {
+            token.type = Token::RightParen;
+        } else if (c == QLatin1Char('@')) {
+            token.type = Token::At;
+        } else if (c == QLatin1Char(',')) {
+            token.type = Token::Comma;
+        } else if (c == QLatin1Char('|')) {
+            token.type = Token::Pipe;
+        } else if (c == QLatin1Char('=')) {
+            token.type = Token::Equal;
+        } else if (c == QLatin1Char('!') && n == QLatin1Char('=')) {
+            token.type = Token::NotEqual;
+        } else if (c == QLatin1Char('<')) {
+            token.type = n == QLatin1Char('=') ? Token::LessEqual : Token::Less;
+        } else if (c == QLatin1Char('>')) {
+            token.type = n == QLatin1Char('=') ? Token::GreaterEqual : Token::Greater;
+        } else if (c == QLatin1Char('+')) {
+            token.type = Token::Plus;
+        } else if (c == QLatin1Char('-')) {
+            token.type = Token::Minus;
+        } else if (c == QLatin1Char('*')) {
+            token.type = Token::Star;
+        } else if (c == QLatin1Char(':') && n == QLatin1Char(':')) {
+            token.type = Token::DoubleColon;
+        } else if (c == QLatin1Char('.') && n == QLatin1Char('.')) {
+            token.type = Token::DoubleDot;
+        } else if (c == QLatin1Char('.') && !n.isDigit()) {
+            token.type = Token::Dot;
+        } else if (c == QLatin1Char('"') || c == QLatin1Char('\'')) {
+            const int end = xpath.indexOf(c, i + 1);
+            if (end < 0) {
+                *error = QStringLiteral("Unterminated literal at %1").arg(i);
+                return false;
+            }
+            token.type = Token::Literal;
+            token.text = xpath.mid(i + 1, end - i - 1);
+            i = end + 1;
+            tokens->append(token);
+            continue;
+        } else if (c.isDigit() || c == QLatin1Char('.')) {
+            int end = i;
+            while (end < size && (xpath.at(end).isDigit() || xpath.at(end) == QLatin1Char('.'))) {
+                end++;
+            }
+            bool ok = false;
+            token.type = Token::Number;
+            token.number = xpath.midRef(i, end - i).toDouble(&ok);
+            if (!ok) {
+                *error = QStringLiteral("Invalid number at %1").arg(i);
+                return false;
+            }
+            i = end;
+            tokens->append(token);
+            continue;
+        } else if (isNameStart(c)) {
+            int end = i + 1;
+            while (end < size && isNameChar(xpath.at(end))) {
+                end++;
+            }
+            token.type = Token::Name;
+            token.text = xpath.mid(i, end - i);
+            i = end;
+            tokens->append(token);
+            continue;
+        } else {
+            *error = QStringLiteral("Unsupported character '%1' at %2").arg(c).arg(i);
+            return false;
+        }
+
+        switch (token.type) {
+        case Token::DoubleSlash:
+        case Token::NotEqual:
+        case Token::LessEqual:
+        case Token::GreaterEqual:
+        case Token::DoubleColon:
+        case Token::DoubleDot:
+            i += 2;
+            break;
+        default:
+            i++;
+            break;
+        }
+        tokens->append(token);
+    }
+
+    tokens->append(Token());
+    return true;
+}
+
+class Parser
+{
+public:
+    explicit Parser(const QVector<Token> &tokens)
+        : m_tokens(tokens)
+    {
+    }
+
+    bool parse(Path *path, QString *error)
+    {
+        *path = parseLocationPath();
+        if (!m_failed && peek().type != Token::End) {
+            fail(QStringLiteral("Unexpected token '%1'").arg(peek().text));
+        }
+        if (!m_failed && path->steps.isEmpty()) {
+            fail(QStringLiteral("Query does not select elements"));
+        }
+        if (!m_failed) {
+            const Step &last = path->steps.last();
+            if (last.axis == AttributeAxis || last.test == TextTest) {
+                fail(QStringLiteral("Query does not select elements"));
+            }
+        }
+
+        *error = m_error;
+        return !m_failed;
+    }
+
+private:
+    const Token &peek(int offset = 0) const
+    {
+        return m_tokens.at(qMin(m_position + offset, m_tokens.size() - 1));
+    }
+
+    const Token &next()
+    {
+        const Token &token = peek();
+        if (m_position < m_tokens.size() - 1) {
+            m_position++;
+        }
+        return token;
+    }
+
+    bool accept(Token::Type type)
+    {
+        if (peek().type != type) {
+            return false;
+        }
+        next();
+        return true;
+    }
+
+    bool acceptOperator(const char *name)
+    {
+        if (peek().type != Token::Name || peek().text != QLatin1String(name)) {
+            return false;
+        }
+        next();
+        return true;
+    }
+
+    bool expect(Token::Type type, const char *what)
+    {
+        if (accept(type)) {
+            return true;
+        }
+        fail(QStringLiteral("Expected %1").arg(QLatin1String(what)));
+        return false;
+    }
+
+    ExpressionPtr fail(const QString &error)
+    {
+        if (!m_failed) {
+            m_failed = true;
+            m_error = error;
+        }
+        return ExpressionPtr();
+    }
+
+    ExpressionPtr binary(Expression::Type type, const ExpressionPtr &left, const ExpressionPtr &right)
+    {
+        if (!left || !right) {
+            return ExpressionPtr();
+        }
+        ExpressionPtr expression(new Expression);
+        expression->type = type;
+        expression->arguments = {left, right};
+        return expression;
+    }
+
+    ExpressionPtr parseOr()
+    {
+        ExpressionPtr left = parseAnd();
+        while (!m_failed && acceptOperator("or")) {
+            left = binary(Expression::Or, left, parseAnd());
+        }
+        return left;
+    }
+
+    ExpressionPtr parseAnd()
+    {
+        ExpressionPtr left = parseEquality();
+        while (!m_failed && acceptOperator("and")) {
+            left = binary(Expression::And, left, parseEquality());
+        }
+        return left;
+    }
+
+    ExpressionPtr parseEquality()
+    {
+        ExpressionPtr left = parseRelational();
+        while (!m_failed) {
+            if (accept(Token::Equal)) {
+                left = binary(Expression::Equal, left, parseRelational());
+            } else if (accept(Token::NotEqual)) {
+                left = binary(Expression::NotEqual, left, parseRelational());
+            } else {
+                break;
+            }
+        }
+        return left;
+    }
+
+    ExpressionPtr parseRelational()
+    {
+        ExpressionPtr left = parseAdditive();
+        while (!m_failed) {
+            if (accept(Token::Less)) {
+                left = binary(Expression::Less, left, parseAdditive());
+            } else if (accept(Token::LessEqual)) {
+                left = binary(Expression::LessEqual, left, parseAdditive());
+            } else if (accept(Token::Greater)) {
+                left = binary(Expression::Greater, left, parseAdditive());
+            } else if (accept(Token::GreaterEqual)) {
+                left = binary(Expression::GreaterEqual, left, parseAdditive());
+            } else {
+                break;
+            }
+        }
+        return left;
+    }
+
+    ExpressionPtr parseAdditive()
+    {
+        ExpressionPtr left = parseMultiplicative();
+        while (!m_failed) {
+            if (accept(Token::Plus)) {
+                left = binary(Expression::Add, left, parseMultiplicative());
+            } else if (accept(Token::Minus)) {
+                left = binary(Expression::Subtract, left, parseMultiplicative());
+            } else {
+                break;
+            }
+        }
+        return left;
+    }
+
+    ExpressionPtr parseMultiplicative()
+    {
+        ExpressionPtr left = parseUnary();
+        while (!m_failed) {
+            if (accept(Token::Star)) {
+                left = binary(Expression::Multiply, left, parseUnary());
+            } else if (acceptOperator("div")) {
+                left = binary(Expression::Divide, left, parseUnary());
+            } else if (acceptOperator("mod")) {
+                left = binary(Expression::Modulo, left, parseUnary());
+            } else {
+                break;
+            }
+        }
+        return left;
+    }
+
+    ExpressionPtr parseUnary()
+    {
+        if (accept(Token::Minus)) {
+            ExpressionPtr operand = parseUnary();
+            if (!operand) {
+                return operand;
+            }
+            ExpressionPtr expression(new Expression);
+            expression->type = Expression::Negate;
+            expression->arguments = {operand};
+            return expression;
+        }
+
+        ExpressionPtr expression = parsePrimary();
+        if (!m_failed && peek().type == Token::Pipe) {
+            return fail(QStringLiteral("Union is not supported"));
+        }
+        return expression;
+    }
+
+    ExpressionPtr parsePrimary()
+    {
+        const Token &token = peek();
+        ExpressionPtr expression(new Expression);
+
+        if (token.type == Token::Literal) {
+            expression->type = Expression::Literal;
+            expression->string = next().text;
+        } else if (token.type == Token::Number) {
+            expression->type = Expression::Number;
+            expression->number = next().number;
+        } else if (token.type == Token::LeftParen) {
+            next();
+            expression = parseOr();
+            if (!expect(Token::RightParen, "')'")) {
+                return ExpressionPtr();
+            }
+        } else if (token.type == Token::Name
+                   && peek(1).type == Token::LeftParen
+                   && token.text != QLatin1String("text")
+                   && token.text != QLatin1String("node")) {
+            return parseFunctionCall();
+        } else {
+            expression->type = Expression::LocationPath;
+            expression->path = parseLocationPath();
+            if (m_failed) {
+                return ExpressionPtr();
+            }
+            if (expression->path.steps.isEmpty() && !expression->path.absolute) {
+                return fail(QStringLiteral("Expected expression"));
+            }
+            return expression;
+        }
+
+        if (!m_failed && (peek().type == Token::LeftBracket || peek().type == Token::Slash || peek().type == Token::DoubleSlash)) {
+            return fail(QStringLiteral("Filter expressions are not supported"));
+        }
+        return m_failed ? ExpressionPtr() : expression;
+    }
+
+    ExpressionPtr parseFunctionCall()
+    {
+        const QString name = next().text;
+        next(); // (
+
+        const FunctionInfo *info = nullptr;
+        for (const FunctionInfo &function : c_functions) {
+            if (name == QLatin1String(function.name)) {
+                info = &function;
+                break;
+            }
+        }
+        if (!info) {
+            return fail(QStringLiteral("Function %1() is not supported").arg(name));
+        }
+
+        ExpressionPtr expression(new Expression);
+        expression->type = Expression::FunctionCall;
+        expression->function = info->function;
+        expression->string = name;
+
+        if (!accept(Token::RightParen)) {
+            do {
+                ExpressionPtr argument = parseOr();
+                if (!argument) {
+                    return ExpressionPtr();
+                }
+                expression->arguments.append(argument);
+            } while (accept(Token::Comma));
+
+            if (!expect(Token::RightParen, "')'")) {
+                return ExpressionPtr();
+            }
+        }
+
+        const int count = expression->arguments.size();
+        if (count < info->minArguments || count > info->maxArguments) {
+            return fail(QStringLiteral("Wrong number of arguments for %1()").arg(name));
+        }
+        if (info->function == CountFunction && expression->arguments.first()->type != Expression::LocationPath) {
+            return fail(QStringLiteral("count() expects a location path"));
+        }
+        return expression;
+    }
+
+    Path parseLocationPath()
+    {
+        Path path;
+        if (accept(Token::Slash)) {
+            path.absolute = true;
+            if (!startsStep()) {
+                return path;
+            }
+        } else if (accept(Token::DoubleSlash)) {
+            path.absolute = true;
+            path.steps.append(descendantOrSelfStep());
+        }
+
+        while (!m_failed) {
+            if (!path.steps.isEmpty() && isTerminal(path.steps.last())) {
+                fail(QStringLiteral("Attribute and text() steps should be last"));
+                break;
+            }
+            path.steps.append(parseStep());
+            if (accept(Token::Slash)) {
+                continue;
+            }
+            if (accept(Token::DoubleSlash)) {
+                path.steps.append(descendantOrSelfStep());
+                continue;
+            }
+            break;
+        }
+        return path;
+    }
+
+    static Step descendantOrSelfStep()
+    {
+        Step step;
+        step.axis = DescendantOrSelfAxis;
+        step.test = AnyNodeTest;
+        return step;
+    }
+
+    static bool isTerminal(const Step &step)
+    {
+        return step.axis == AttributeAxis || step.test == TextTest;
+    }
+
+    bool startsStep() const
+    {
+        switch (peek().type) {
+        case Token::Dot:
+        case Token::DoubleDot:
+        case Token::At:
+        case Token::Star:
+        case Token::Name:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    Step parseStep()
+    {
+        Step step;
+        if (accept(Token::Dot)) {
+            step.axis = SelfAxis;
+            step.test = AnyNodeTest;
+            return step;
+        }
+        if (accept(Token::DoubleDot)) {
+            step.axis = ParentAxis;
+            step.test = AnyNodeTest;
+            return step;
+        }
+
+        if (accept(Token::At)) {
+            step.axis = AttributeAxis;
+            if (peek().type != Token::Name) {
+                fail(QStringLiteral("Expected attribute name"));
+                return step;
+            }
+            step.name = next().text;
+            if (peek().type == Token::LeftBracket) {
+                fail(QStringLiteral("Predicates on attributes are not supported"));
+            }
+            return step;
+        }
+
+        if (peek().type == Token::Name && peek(1).type == Token::DoubleColon) {
+            static const QHash<QString, Axis> axes = {
+                {QStringLiteral("child"), ChildAxis},
+                {QStringLiteral("descendant"), DescendantAxis},
+                {QStringLiteral("descendant-or-self"), DescendantOrSelfAxis},
+                {QStringLiteral("self"), SelfAxis},
+                {QStringLiteral("parent"), ParentAxis},
+                {QStringLiteral("ancestor"), AncestorAxis},
+                {QStringLiteral("ancestor-or-self"), AncestorOrSelfAxis},
+                {QStringLiteral("following-sibling"), FollowingSiblingAxis},
+                {QStringLiteral("preceding-sibling"), PrecedingSiblingAxis},
+                {QStringLiteral("attribute"), AttributeAxis},
+            };
+            const QString axisName = next().text;
+            next(); // ::
+            if (!axes.contains(axisName)) {
+                fail(QStringLiteral("Axis %1 is not supported").arg(axisName));
+                return step;
+            }
+            step.axis = axes.value(axisName);
+        }
+
+        if (accept(Token::Star)) {
+            step.test = AnyElementTest;
+        } else if (peek().type == Token::Name) {
+            step.name = next().text;
+            step.test = NameTest;
+            if ((step.name == QLatin1String("text") || step.name == QLatin1String("node"))
+                    && accept(Token::LeftParen)) {
+                if (!expect(Token::RightParen, "')'")) {
+                    return step;
+                }
+                step.test = step.name == QLatin1String("text") ? TextTest : AnyNodeTest;
+                step.name.clear();
+            }
+        } else {
+            fail(QStringLiteral("Expected node test"));
+            return step;
+        }
+
+        if (step.axis == AttributeAxis && step.test != NameTest) {
+            fail(QStringLiteral("Only named attributes are supported"));
+            return step;
+        }
+        if (step.test == TextTest && step.axis != ChildAxis) {
+            fail(QStringLiteral("text() is supported on child axis only"));
+            return step;
+        }
+
+        while (!m_failed && accept(Token::LeftBracket)) {
+            if (isTerminal(step)) {
+                fail(QStringLiteral("Predicates on attributes and text() are not supported"));
+                break;
+            }
+            ExpressionPtr predicate = parseOr();
+            if (!predicate || !expect(Token::RightBracket, "']'")) {
+                break;
+            }
+            step.positional = step.positional || isPositional(predicate);
+            step.predicates.append(predicate);
+        }
+        return step;
+    }
+
+    static bool returnsNumber(const ExpressionPtr &expression)
+    {
+        switch (expression->type) {
+        case Expression::Number:
+        case Expression::Add:
+        case Expression::Subtract:
+        case Expression::Multiply:
+        case Expression::Divide:
+        case Expression::Modulo:
+        case Expression::Negate:
+            return true;
+        case Expression::FunctionCall:
+            switch (expression->function) {
+            case PositionFunction:
+            case LastFunction:
+            case CountFunction:
+            case NumberFunction:
+            case StringLengthFunction:
+                return true;
+            default:
+                return false;
+            }
+        default:
+            return false;
+        }
+    }
+
+    static bool usesPosition(const ExpressionPtr &expression)
+    {
+        if (expression->type == Expression::FunctionCall
+                && (expression->function == PositionFunction || expression->function == LastFunction)) {
+            return true;
+        }
+        // location paths evaluate their own predicates with their own positions
+        for (const ExpressionPtr &argument : expression->arguments) {
+            if (usesPosition(argument)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool isPositional(const ExpressionPtr &predicate)
+    {
+        return returnsNumber(predicate) || usesPosition(predicate);
+    }
+
+    const QVector<Token> &m_tokens;
+    int m_position = 0;
+    bool m_failed = false;
+    QString m_error;
+};
+
+struct Node
+{
+    QObject *item = nullptr;   // nullptr for the document node
+    int zDepth = 0;            // position among siblings as written by recursiveDumpXml
+};
+
+struct Context
+{
+    Node node;
+    int position = 1;
+    int size = 1;
+};
+
+struct Value
+{
+    enum Type {
+        Nodes,
+        Strings,
+        String,
+        Number,
+        Boolean,
+    };
+
+    Value() = default;
+    explicit Value(const QString &value) : type(String), string(value) {}
+    explicit Value(double value) : type(Number), number(value) {}
+    explicit Value(bool value) : type(Boolean), boolean(value) {}
+
+    bool isSet() const
+    {
+        return type == Nodes || type == Strings;
+    }
+
+    Type type = Nodes;
+    QVector<Node> nodes;
+    QStringList strings;
+    QString string;
+    double number = 0;
+    bool boolean = false;
+};
+
+QString numberToString(double number)
+{
+    if (std::isnan(number)) {
+        return QStringLiteral("NaN");
+    }
+    if (std::isinf(number)) {
+        return number > 0 ? QStringLiteral("Infinity") : QStringLiteral("-Infinity");
+    }
+    if (number == std::floor(number) && std::fabs(number) < 1e15) {
+        return QString::number(qint64(number));
+    }
+    return QString::number(number, 'g', 15);
+}
+
+double stringToNumber(const QString &string)
+{
+    bool ok = false;
+    const double number = string.trimmed().toDouble(&ok);
+    return ok ? number : std::numeric_limits<double>::quiet_NaN();
+}
+
+class Evaluation
+{
+public:
+    Evaluation(QAXPathEvaluator::Model *model, QObject *root)
+        : m_model(model)
+        , m_root(root)
+    {
+    }
+
+    QObjectList evaluate(const Path &path, int limit)
+    {
+        const QVector<Node> nodes = evaluatePath(path, Node(), limit);
+
+        QObjectList result;
+        result.reserve(nodes.size());
+        for (const Node &node : nodes) {
+            if (node.item) {
+                result.append(node.item);
+            }
+        }
+        return result;
+    }
+
+private:
+    QVector<Node> children(const Node &node)
+    {
+        QVector<Node> result;
+        if (!node.item) {
+            Node root;
+            root.item = m_root;
+            result.append(root);
+            return result;
+        }
+
+        const QObjectList items = m_model->children(node.item);
+        result.reserve(items.size());
+        for (int i = 0; i < items.size(); i++) {
+            Node child;
+            child.item = items.at(i);
+            child.zDepth = i + 1;
+            result.append(child);
+        }
+        return result;
+    }
+
+    bool parent(const Node &node, Node *parentNode)
+    {
+        if (!node.item) {
+            return false;
+        }
+
+        *parentNode = Node();
+        if (node.item == m_root) {
+            return true;
+        }
+
+        QObject *item = m_model->parent(node.item);
+        if (!item) {
+            return false;
+        }
+
+        parentNode->item = item;
+        if (item != m_root) {
+            QObject *grandParent = m_model->parent(item);
+            parentNode->zDepth = grandParent ? m_model->children(grandParent).indexOf(item) + 1 : 0;
+        }
+        return true;
+    }
+
+    bool matchesTest(const Node &node, const Step &step)
+    {
+        switch (step.test) {
+        case AnyNodeTest:
+            return true;
+        case AnyElementTest:
+            return node.item != nullptr;
+        case NameTest:
+            return node.item && m_model->name(node.item) == step.name;
+        default:
+            return false;
+        }
+    }
+
+    bool matchesPredicates(const Node &node, const Step &step)
+    {
+        Context context;
+        context.node = node;
+        for (const ExpressionPtr &predicate : step.predicates) {
+            if (!predicateValue(predicate, context)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool predicateValue(const ExpressionPtr &predicate, const Context &context)
+    {
+        // existence test does not need more than one node
+        if (predicate->type == Expression::LocationPath) {
+            return selectsStrings(predicate->path)
+                ? !pathStrings(predicate->path, context.node, 1).isEmpty()
+                : !evaluatePath(predicate->path, context.node, 1).isEmpty();
+        }
+
+        const Value value = evaluateExpression(predicate, context);
+        if (value.type == Value::Number) {
+            return value.number == context.position;
+        }
+        return toBoolean(value);
+    }
+
+    QVector<Node> filter(const QVector<Node> &candidates, const Step &step)
+    {
+        QVector<Node> nodes = candidates;
+        for (const ExpressionPtr &predicate : step.predicates) {
+            QVector<Node> filtered;
+            Context context;
+            context.size = nodes.size();
+            for (int i = 0; i < nodes.size(); i++) {
+                context.node = nodes.at(i);
+                context.position = i + 1;
+                if (predicateValue(predicate, context)) {
+                    filtered.append(nodes.at(i));
+                }
+            }
+            nodes = filtered;
+        }
+        return nodes;
+    }
+
+    // preorder walk, stops when visitor returns false
+    bool walk(const Node &node, bool includeSelf, const std::function<bool(const Node &)> &visitor)
+    {
+        if (includeSelf && !visitor(node)) {
+            return false;
+        }
+
+        QVector<Node> stack = children(node);
+        std::reverse(stack.begin(), stack.end());
+        while (!stack.isEmpty()) {
+            const Node current = stack.takeLast();
+            if (!visitor(current)) {
+                return false;
+            }
+            QVector<Node> nested = children(current);
+            for (int i = nested.size() - 1; i >= 0; i--) {
+                stack.append(nested.at(i));
+            }
+        }
+        return true;
+    }
+
+    // nodes of a reverse axis are returned nearest first
+    QVector<Node> axisNodes(const Node &node, Axis axis)
+    {
+        QVector<Node> result;
+        Node current;
+        switch (axis) {
+        case ChildAxis:
+            return children(node);
+        case SelfAxis:
+            result.append(node);
+            break;
+        case ParentAxis:
+            if (parent(node, &current)) {
+                result.append(current);
+            }
+            break;
+        case AncestorAxis:
+        case AncestorOrSelfAxis:
+            if (axis == AncestorOrSelfAxis) {
+                result.append(node);
+            }
+            current = node;
+            while (parent(current, &current)) {
+                result.append(current);
+            }
+            break;
+        case FollowingSiblingAxis:
+        case PrecedingSiblingAxis: {
+            if (!parent(node, &current)) {
+                break;
+            }
+            const QVector<Node> siblings = children(current);
+            int index = -1;
+            for (int i = 0; i < siblings.size(); i++) {
+                if (siblings.at(i).item == node.item) {
+                    index = i;
+                    break;
+                }
+            }
+            if (index < 0) {
+                break;
+            }
+            if (axis == FollowingSiblingAxis) {
+                result = siblings.mid(index + 1);
+            } else {
+                result = siblings.mid(0, index);
+                std::reverse(result.begin(), result.end());
+            }
+            break;
+        }
+        case DescendantAxis:
+        case DescendantOrSelfAxis:
+            walk(node, axis == DescendantOrSelfAxis, [&result](const Node &descendant) {
+                result.append(descendant);
+                return true;
+            });
+            break;
+        default:
+            break;
+        }
+        return result;
+    }
+
+    static bool isReverseAxis(Axis axis)
+    {
+        return axis == ParentAxis || axis == AncestorAxis || axis == AncestorOrSelfAxis || axis == PrecedingSiblingAxis;
+    }
+
+    static bool isDescendantShortcut(const Step &step)
+    {
+        return step.axis == DescendantOrSelfAxis && step.test == AnyNodeTest && step.predicates.isEmpty();
+    }
+
+    // evaluates step for a single context node, results are in document order
+    void evaluateStep(const Node &context, const Step &step, int limit, QVector<Node> *result)
+    {
+        const bool descendants = step.axis == DescendantAxis || step.axis == DescendantOrSelfAxis;
+        if (descendants && !step.positional) {
+            walk(context, step.axis == DescendantOrSelfAxis, [&](const Node &node) {
+                if (matchesTest(node, step) && matchesPredicates(node, step)) {
+                    result->append(node);
+                }
+                return limit < 0 || result->size() < limit;
+            });
+            return;
+        }
+
+        if (step.axis == ChildAxis && !step.positional) {
+            for (const Node &node : children(context)) {
+                if (matchesTest(node, step) && matchesPredicates(node, step)) {
+                    result->append(node);
+                    if (limit >= 0 && result->size() >= limit) {
+                        return;
+                    }
+                }
+            }
+            return;
+        }
+
+        QVector<Node> candidates;
+        for (const Node &node : axisNodes(context, step.axis)) {
+            if (matchesTest(node, step)) {
+                candidates.append(node);
+            }
+        }
+        QVector<Node> nodes = filter(candidates, step);
+        if (isReverseAxis(step.axis)) {
+            std::reverse(nodes.begin(), nodes.end());
+        }
+        if (limit >= 0 && nodes.size() > limit) {
+            nodes.resize(limit);
+        }
+        *result += nodes;
+    }
+
+    // "//name[predicates]" with positional predicates: positions are counted
+    // among children of every node, results are collected in document order
+    void evaluateDescendantChildren(const Node &context, const Step &step, int limit, QVector<Node> *result)
+    {
+        QSet<QObject*> selected;
+        walk(context, true, [&](const Node &node) {
+            if (node.item && selected.contains(node.item)) {
+                result->append(node);
+                if (limit >= 0 && result->size() >= limit) {
+                    return false;
+                }
+            }
+
+            QVector<Node> candidates;
+            for (const Node &child : children(node)) {
+                if (matchesTest(child, step)) {
+                    candidates.append(child);
+                }
+            }
+            for (const Node &child : filter(candidates, step)) {
+                selected.insert(child.item);
+            }
+            return true;
+        });
+    }
+
+    QVector<Node> evaluatePath(const Path &path, const Node &context, int limit)
+    {
+        QVector<Node> contexts;
+        contexts.append(path.absolute ? Node() : context);
+
+        const int count = path.steps.size();
+        for (int i = 0; i < count; i++) {
+            const Step *step = &path.steps.at(i);
+            if (step->axis == AttributeAxis || step->test == TextTest) {
+                break;
+            }
+
+            const bool shortcut = isDescendantShortcut(*step)
+                    && i + 1 < count
+                    && path.steps.at(i + 1).axis == ChildAxis
+                    && path.steps.at(i + 1).test != TextTest;
+            if (shortcut) {
+                step = &path.steps.at(++i);
+            }
+
+            const bool last = i + 1 == count;
+            const int stepLimit = last && contexts.size() == 1 ? limit : -1;
+
+            QVector<Node> result;
+            for (const Node &node : contexts) {
+                if (!shortcut) {
+                    evaluateStep(node, *step, stepLimit, &result);
+                } else if (step->positional) {
+                    evaluateDescendantChildren(node, *step, stepLimit, &result);
+                } else {
+                    Step descendant = *step;
+                    descendant.axis = DescendantAxis;
+                    evaluateStep(node, descendant, stepLimit, &result);
+                }
+            }
+
+            if (contexts.size() > 1) {
+                sortUnique(&result);
+                if (last && limit >= 0 && result.size() > limit) {
+                    result.resize(limit);
+                }
+            }
+            contexts = result;
+            if (contexts.isEmpty()) {
+                break;
+            }
+        }
+        return contexts;
+    }
+
+    static bool selectsStrings(const Path &path)
+    {
+        if (path.steps.isEmpty()) {
+            return false;
+        }
+        const Step &step = path.steps.last();
+        return step.axis == AttributeAxis || step.test == TextTest;
+    }
+
+    // values selected by trailing attribute or text() step
+    QStringList pathStrings(const Path &path, const Node &context, int limit)
+    {
+        QStringList result;
+        if (!selectsStrings(path)) {
+            return result;
+        }
+        const Step &step = path.steps.last();
+
+        QVector<Node> nodes;
+        if (path.steps.size() == 1) {
+            nodes.append(path.absolute ? Node() : context);
+        } else {
+            Path owners = path;
+            owners.steps.removeLast();
+            nodes = evaluatePath(owners, context, -1);
+        }
+
+        for (const Node &node : nodes) {
+            QString value;
+            if (step.axis == AttributeAxis) {
+                if (!attribute(node, step.name, &value)) {
+                    continue;
+                }
+            } else {
+                if (!node.item) {
+                    continue;
+                }
+                value = m_model->text(node.item);
+                if (value.isEmpty()) {
+                    continue;
+                }
+            }
+            result.append(value);
+            if (limit >= 0 && result.size() >= limit) {
+                break;
+            }
+        }
+        return result;
+    }
+
+    bool attribute(const Node &node, const QString &name, QString *value)
+    {
+        if (!node.item) {
+            return false;
+        }
+        if (name == QLatin1String("zDepth")) {
+            *value = QString::number(node.zDepth);
+            return true;
+        }
+        return m_model->attribute(node.item, name, value);
+    }
+
+    QVector<int> documentPosition(const Node &node, QHash<QObject*, QHash<QObject*, int>> *childIndexes)
+    {
+        QVector<int> position;
+        if (!node.item) {
+            return position;
+        }
+
+        QObject *item = node.item;
+        while (item != m_root) {
+            QObject *parentItem = m_model->parent(item);
+            if (!parentItem) {
+                break;
+            }
+            QHash<QObject*, QHash<QObject*, int>>::iterator indexes = childIndexes->find(parentItem);
+            if (indexes == childIndexes->end()) {
+                indexes = childIndexes->insert(parentItem, QHash<QObject*, int>());
+                const QObjectList items = m_model->children(parentItem);
+                for (int i = 0; i < items.size(); i++) {
+                    indexes->insert(items.at(i), i);
+                }
+            }
+            position.prepend(indexes->value(item, -1));
+            item = parentItem;
+        }
+        position.prepend(0);
+        return position;
+    }
+
+    void sortUnique(QVector<Node> *nodes)
+    {
+        QSet<QObject*> seen;
+        QHash<QObject*, QHash<QObject*, int>> childIndexes;
+        std::vector<std::pair<QVector<int>, Node>> positions;
+        positions.reserve(nodes->size());
+        for (const Node &node : *nodes) {
+            if (seen.contains(node.item)) {
+                continue;
+            }
+            seen.insert(node.item);
+            positions.emplace_back(documentPosition(node, &childIndexes), node);
+        }
+
+        std::stable_sort(positions.begin(), positions.end(), [](const std::pair<QVector<int>, Node> &a, const std::pair<QVector<int>, Node> &b) {
+            return std::lexicographical_compare(a.first.cbegin(), a.first.cend(), b.first.cbegin(), b.first.cend());
+        });
+
+        nodes->clear();
+        for (const auto &position : positions) {
+            nodes->append(position.second);
+        }
+    }
+
+    QString stringValue(const Node &node)
+    {
+        if (!node.item) {
+            Node root;
+            root.item = m_root;
+            return stringValue(root);
+        }
+
+        QString value = m_model->text(node.item);
+        for (const Node &child : children(node)) {
+            value.append(stringValue(child));
+        }
+        return value;
+    }
+
+    QStringList setStrings(const Value &value)
+    {
+        if (value.type == Value::Strings) {
+            return value.strings;
+        }
+        QStringList result;
+        for (const Node &node : value.nodes) {
+            result.append(stringValue(node));
+        }
+        return result;
+    }
+
+    bool toBoolean(const Value &value)
+    {
+        switch (value.type) {
+        case Value::Nodes:
+            return !value.nodes.isEmpty();
+        case Value::Strings:
+            return !value.strings.isEmpty();
+        case Value::String:
+            return !value.string.isEmpty();
+        case Value::Number:
+            return value.number != 0 && !std::isnan(value.number);
+        case Value::Boolean:
+            return value.boolean;
+        }
+        return false;
+    }
+
+    QString toString(const Value &value)
+    {
+        switch (value.type) {
+        case Value::Nodes:
+            return value.nodes.isEmpty() ? QString() : stringValue(value.nodes.first());
+        case Value::Strings:
+            return value.strings.isEmpty() ? QString() : value.strings.first();
+        case Value::String:
+            return value.string;
+        case Value::Number:
+            return numberToString(value.number);
+        case Value::Boolean:
+            return value.boolean ? QStringLiteral("true") : QStringLiteral("false");
+        }
+        return QString();
+    }
+
+    double toNumber(const Value &value)
+    {
+        switch (value.type) {
+        case Value::Number:
+            return value.number;
+        case Value::Boolean:
+            return value.boolean ? 1 : 0;
+        default:
+            return stringToNumber(toString(value));
+        }
+    }
+
+    static bool compareNumbers(Expression::Type type, double left, double right)
+    {
+        switch (type) {
+        case Expression::Equal:
+            return left == right;
+        case Expression::NotEqual:
+            return left != right;
+        case Expression::Less:
+            return left < right;
+        case Expression::LessEqual:
+            return left <= right;
+        case Expression::Greater:
+            return left > right;
+        case Expression::GreaterEqual:
+            return left >= right;
+        default:
+            return false;
+        }
+    }
+
+    static bool compareStrings(Expression::Type type, const QString &left, const QString &right)
+    {
+        if (type == Expression::Equal) {
+            return left == right;
+        }
+        if (type == Expression::NotEqual) {
+            return left != right;
+        }
+        return compareNumbers(type, stringToNumber(left), stringToNumber(right));
+    }
+
+    static Expression::Type mirrored(Expression::Type type)
+    {
+        switch (type) {
+        case Expression::Less:
+            return Expression::Greater;
+        case Expression::LessEqual:
+            return Expression::GreaterEqual;
+        case Expression::Greater:
+            return Expression::Less;
+        case Expression::GreaterEqual:
+            return Expression::LessEqual;
+        default:
+            return type;
+        }
+    }
+
+    bool compare(Expression::Type type, const Value &left, const Value &right)
+    {
+        if (left.isSet() && right.isSet()) {
+            const QStringList rightStrings = setStrings(right);
+            for (const QString &leftString : setStrings(left)) {
+                for (const QString &rightString : rightStrings) {
+                    if (compareStrings(type, leftString, rightString)) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        if (!left.isSet() && right.isSet()) {
+            return compare(mirrored(type), right, left);
+        }
+
+        if (left.isSet()) {
+            if (right.type == Value::Boolean) {
+                return compareNumbers(type, toBoolean(left), right.boolean);
+            }
+            for (const QString &string : setStrings(left)) {
+                const bool match = right.type == Value::Number
+                        ? compareNumbers(type, stringToNumber(string), right.number)
+                        : compareStrings(type, string, right.string);
+                if (match) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        if (type == Expression::Equal || type == Expression::NotEqual) {
+            if (left.type == Value::Boolean || right.type == Value::Boolean) {
+                return compareNumbers(type, toBoolean(left), toBoolean(right));
+            }
+            if (left.type == Value::Number || right.type == Value::Number) {
+                return compareNumbers(type, toNumber(left), toNumber(right));
+            }
+            return compareStrings(type, toString(left), toString(right));
+        }
+        return compareNumbers(type, toNumber(left), toNumber(right));
+    }
+
+    Value evaluateArgument(const ExpressionPtr &expression, int index, const Context &context)
+    {
+        if (index < expression->arguments.size()) {
+            return evaluateExpression(expression->arguments.at(index), context);
+        }
+        // functions called without argument use the context node
+        Value value;
+        value.nodes.append(context.node);
+        return value;
+    }
+
+    Value evaluateFunction(const ExpressionPtr &expression, const Context &context)
+    {
+        switch (expression->function) {
+        case PositionFunction:
+            return Value(double(context.position));
+        case LastFunction:
+            return Value(double(context.size));
+        case CountFunction: {
+            const Value value = evaluateArgument(expression, 0, context);
+            return Value(double(value.type == Value::Strings ? value.strings.size() : value.nodes.size()));
+        }
+        case NotFunction:
+            return Value(!toBoolean(evaluateArgument(expression, 0, context)));
+        case TrueFunction:
+            return Value(true);
+        case FalseFunction:
+            return Value(false);
+        case BooleanFunction:
+            return Value(toBoolean(evaluateArgument(expression, 0, context)));
+        case StringFunction:
+            return Value(toString(evaluateArgument(expression, 0, context)));
+        case NumberFunction:
+            return Value(toNumber(evaluateArgument(expression, 0, context)));
+        case StringLengthFunction:
+            return Value(double(toString(evaluateArgument(expression, 0, context)).size()));
+        case NormalizeSpaceFunction:
+            return Value(toString(evaluateArgument(expression, 0, context)).simplified());
+        case ContainsFunction:
+            return Value(toString(evaluateArgument(expression, 0, context))
+                         .contains(toString(evaluateArgument(expression, 1, context))));
+        case StartsWithFunction:
+            return Value(toString(evaluateArgument(expression, 0, context))
+                         .startsWith(toString(evaluateArgument(expression, 1, context))));
+        case EndsWithFunction:
+            return Value(toString(evaluateArgument(expression, 0, context))
+                         .endsWith(toString(evaluateArgument(expression, 1, context))));
+        case MatchesFunction: {
+            QRegularExpression::PatternOptions options = QRegularExpression::NoPatternOption;
+            if (expression->arguments.size() > 2
+                    && toString(evaluateArgument(expression, 2, context)).contains(QLatin1Char('i'))) {
+                options |= QRegularExpression::CaseInsensitiveOption;
+            }
+            const QRegularExpression rx(toString(evaluateArgument(expression, 1, context)), options);
+            return Value(rx.match(toString(evaluateArgument(expression, 0, context))).hasMatch());
+        }
+        case ConcatFunction: {
+            QString result;
+            for (int i = 0; i < expression->arguments.size(); i++) {
+                result.append(toString(evaluateArgument(expression, i, context)));
+            }
+            return Value(result);
+        }
+        case LowerCaseFunction:
+            return Value(toString(evaluateArgument(expression, 0, context)).toLower());
+        case UpperCaseFunction:
+            return Value(toString(evaluateArgument(expression, 0, context)).toUpper());
+        case NameFunction: {
+            const Value value = evaluateArgument(expression, 0, context);
+            if (value.type != Value::Nodes || value.nodes.isEmpty() || !value.nodes.first().item) {
+                return Value(QString());
+            }
+            return Value(m_model->name(value.nodes.first().item));
+        }
+        }
+        return Value(QString());
+    }
+
+    Value evaluateExpression(const ExpressionPtr &expression, const Context &context)
+    {
+        switch (expression->type) {
+        case Expression::Or:
+            return Value(toBoolean(evaluateExpression(expression->arguments.at(0), context))
+                         || toBoolean(evaluateExpression(expression->arguments.at(1), context)));
+        case Expression::And:
+            return Value(toBoolean(evaluateExpression(expression->arguments.at(0), context))
+                         && toBoolean(evaluateExpression(expression->arguments.at(1), context)));
+        case Expression::Equal:
+        case Expression::NotEqual:
+        case Expression::Less:
+        case Expression::LessEqual:
+        case Expression::Greater:
+        case Expression::GreaterEqual:
+            return Value(compare(expression->type,
+                                 evaluateExpression(expression->arguments.at(0), context),
+                                 evaluateExpression(expression->arguments.at(1), context)));
+        case Expression::Add:
+        case Expression::Subtract:
+        case Expression::Multiply:
+        case Expression::Divide:
+        case Expression::Modulo: {
+            const double left = toNumber(evaluateExpression(expression->arguments.at(0), context));
+            const double right = toNumber(evaluateExpression(expression->arguments.at(1), context));
+            switch (expression->type) {
+            case Expression::Add:
+                return Value(left + right);
+            case Expression::Subtract:
+                return Value(left - right);
+            case Expression::Multiply:
+                return Value(left * right);
+            case Expression::Divide:
+                return Value(left / right);
+            default:
+                return Value(std::fmod(left, right));
+            }
+        }
+        case Expression::Negate:
+            return Value(-toNumber(evaluateExpression(expression->arguments.at(0), context)));
+        case Expression::Literal:
+            return Value(expression->string);
+        case Expression::Number:
+            return Value(expression->number);
+        case Expression::FunctionCall:
+            return evaluateFunction(expression, context);
+        case Expression::LocationPath: {
+            Value value;
+            if (selectsStrings(expression->path)) {
+                value.type = Value::Strings;
+                value.strings = pathStrings(expression->path, context.node, -1);
+            } else {
+                value.nodes = evaluatePath(expression->path, context.node, -1);
+            }
+            return value;
+        }
+        }
+        return Value();
+    }
+
+    QAXPathEvaluator::Model *m_model = nullptr;
+    QObject *m_root = nullptr;
+};
+
+}
+
+struct QAXPathEvaluator::Query
+{
+    Path path;
+};
+
+bool QAXPathEvaluator::setQuery(const QString &xpath)
+{
+    m_query.reset();
+    m_errorString.clear();
+
+    QVector<Token> tokens;
+    if (!tokenize(xpath, &tokens, &m_errorString)) {
+        return false;
+    }
+
+    QSharedPointer<Query> query(new Query);
+    Parser parser(tokens);
+    if (!parser.parse(&query->path, &m_errorString)) {
+        return false;
+    }
+
+    m_query = query;
+    return true;
+}
+
+bool QAXPathEvaluator::isValid() const
+{
+    return !m_query.isNull();
+}
+
+QString QAXPathEvaluator::errorString() const
+{
+    return m_errorString;
+}
+
+QObjectList QAXPathEvaluator::evaluate(QAXPathEvaluator::Model *model, QObject *root, int limit) const
+{
+    if (!m_query || !model || !root) {
+        return QObjectList();
+    }
+
+    Evaluation evaluation(model, root);
+    return evaluation.evaluate(m_query->path, limit);
+}
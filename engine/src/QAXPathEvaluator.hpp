@@ -0,0 +1,46 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#ifndef QAXPATHEVALUATOR_HPP
+#define QAXPATHEVALUATOR_HPP
+
+#include <QObject>
+#include <QSharedPointer>
+#include <QString>
+
+// Evaluates the XPath 1.0 subset used for element lookup directly on the object
+// tree instead of an xml dump: location paths with child, descendant, parent,
+// ancestor, self and sibling axes, predicates on attributes and text(),
+// boolean, relational and arithmetic operators and common string functions.
+// Attributes are read only for the nodes predicates are evaluated on.
+class QAXPathEvaluator
+{
+public:
+    // Tree the query is evaluated on. Element names, attributes and text
+    // should match the xml written by GenericEnginePlatform::recursiveDumpXml,
+    // zDepth attribute is provided by the evaluator itself.
+    class Model
+    {
+    public:
+        virtual ~Model() = default;
+
+        virtual QObjectList children(QObject *item) = 0;
+        virtual QObject *parent(QObject *item) = 0;
+        virtual QString name(QObject *item) = 0;
+        virtual QString text(QObject *item) = 0;
+        virtual bool attribute(QObject *item, const QString &name, QString *value) = 0;
+    };
+
+    struct Query;
+
+    bool setQuery(const QString &xpath);
+    bool isValid() const;
+    QString errorString() const;
+
+    // stops as soon as limit elements are found, negative limit means all of them
+    QObjectList evaluate(Model *model, QObject *root, int limit = -1) const;
+
+private:
+    QSharedPointer<const Query> m_query;
+    QString m_errorString;
+};
+
+#endif // QAXPATHEVALUATOR_HPP
@@ -3,6 +3,7 @@
 #include "QuickEnginePlatform.hpp"
 #include "QAMouseEngine.hpp"
 #include "QAKeyEngine.hpp"
+#include "QAReplyStream.hpp"
 #include "ITransportClient.hpp"
 
 #include <QBuffer>
@@ -58,6 +59,46 @@ QQuickItem *QuickEnginePlatform::getItem(const QString &elementId)
 QuickEnginePlatform::QuickEnginePlatform(QWindow *window)
     : GenericEnginePlatform(window)
 {
+    // items are polished and still in the dirty list when the frame starts
+    if (QQuickWindow *quickWindow = qobject_cast<QQuickWindow*>(window)) {
+        connect(quickWindow, &QQuickWindow::afterAnimating, this, &QuickEnginePlatform::onAfterAnimating);
+    }
+}
+
+void QuickEnginePlatform::onAfterAnimating()
+{
+    collectTreeChanges();
+    // dirty list is consumed by the following synchronization
+    m_lastDirtyItems.clear();
+}
+
+void QuickEnginePlatform::collectTreeChanges()
+{
+    // creation and destruction of items marks their parents dirty,
+    // so changes reported by the hooks are covered by the dirty list
+    m_treeDirty.store(0);
+
+    // dirty list only reports visual changes, text, visible and enabled
+    // are covered by notify signals of watched items
+
+    QObjectList dirtyItems;
+    if (m_rootQuickWindow) {
+        QQuickWindowPrivate *wp = QQuickWindowPrivate::get(m_rootQuickWindow);
+        for (QQuickItem *item = wp->dirtyItemList; item; item = QQuickItemPrivate::get(item)->nextDirtyItem) {
+            dirtyItems.append(item);
+        }
+    }
+
+    if (dirtyItems == m_lastDirtyItems) {
+        dirtyItems.clear();
+    } else {
+        m_lastDirtyItems = dirtyItems;
+    }
+    markItemsChanged(dirtyItems);
+
+    qCDebug(categoryQuickEnginePlatform)
+        << Q_FUNC_INFO
+        << m_treeGeneration << dirtyItems.size();
 }
 
 QQuickItem *QuickEnginePlatform::findParentFlickable(QQuickItem *rootItem)
@@ -134,6 +175,62 @@ QPoint QuickEnginePlatform::getAbsPosition(QObject *item)
     return abs;
 }
 
+GenericEnginePlatform::GeometryContext QuickEnginePlatform::geometryContext(QObject *item)
+{
+    GeometryContext context;
+
+    QQuickItem *q = qobject_cast<QQuickItem*>(item);
+    if (!q) {
+        context.visible = false;
+        return context;
+    }
+    context.absPosition = getAbsPosition(q);
+    context.visible = q->isVisible();
+
+    // starting item of a walk is placed through its parent chain once,
+    // its descendants are placed by childGeometryContext
+    context.transform = QQuickItemPrivate::get(q)->itemToWindowTransform();
+    if (m_rootQuickItem) {
+        context.transform *= QQuickItemPrivate::get(m_rootQuickItem)->windowToItemTransform();
+    }
+    for (QQuickItem *ancestor = q->parentItem(); ancestor; ancestor = ancestor->parentItem()) {
+        if (!ancestor->clip()) {
+            continue;
+        }
+        const QRectF rect = m_rootQuickItem
+            ? ancestor->mapRectToItem(m_rootQuickItem, QRectF(0, 0, ancestor->width(), ancestor->height()))
+            : ancestor->mapRectToScene(QRectF(0, 0, ancestor->width(), ancestor->height()));
+        context.clipRect = context.clipped ? context.clipRect.intersected(rect) : rect;
+        context.clipped = true;
+    }
+    return context;
+}
+
+GenericEnginePlatform::GeometryContext QuickEnginePlatform::childGeometryContext(QObject *child, const GeometryContext &parent)
+{
+    QQuickItem *q = qobject_cast<QQuickItem*>(child);
+    if (!q) {
+        return geometryContext(child);
+    }
+
+    GeometryContext context;
+    // same rounding as getAbsPosition, position is mapped through the parent
+    context.absPosition = parent.transform.map(QPointF(QPointF(q->x(), q->y()).toPoint())).toPoint();
+    context.transform = parent.transform;
+    QQuickItemPrivate::get(q)->itemToParentTransform(context.transform);
+    context.visible = q->isVisible();
+
+    context.clipRect = parent.clipRect;
+    context.clipped = parent.clipped;
+    QQuickItem *parentItem = q->parentItem();
+    if (parentItem && parentItem->clip()) {
+        const QRectF rect = parent.transform.mapRect(QRectF(0, 0, parentItem->width(), parentItem->height()));
+        context.clipRect = context.clipped ? context.clipRect.intersected(rect) : rect;
+        context.clipped = true;
+    }
+    return context;
+}
+
 QPoint QuickEnginePlatform::getPosition(QObject *item)
 {
     qCDebug(categoryQuickEnginePlatform)
@@ -186,6 +283,15 @@ bool QuickEnginePlatform::isItemVisible(QObject *item)
     return q->isVisible();
 }
 
+qreal QuickEnginePlatform::getZ(QObject *item)
+{
+    QQuickItem *q = qobject_cast<QQuickItem*>(item);
+    if (!q) {
+        return 0;
+    }
+    return q->z();
+}
+
 QVariant QuickEnginePlatform::executeJS(const QString &jsCode, QQuickItem *item)
 {
     qCDebug(categoryQuickEnginePlatform)
@@ -281,25 +387,6 @@ void QuickEnginePlatform::grabScreenshot(ITransportClient *socket, QObject *item
     });
 }
 
-void QuickEnginePlatform::pressAndHoldItem(QObject *qitem, int delay)
-{
-    qCDebug(categoryQuickEnginePlatform)
-        << Q_FUNC_INFO
-        << qitem << delay;
-
-    if (!qitem) {
-        return;
-    }
-
-    QQuickItem *item = qobject_cast<QQuickItem*>(qitem);
-    if (!item) {
-        return;
-    }
-
-    const QPointF itemAbs = getAbsPosition(item);
-    pressAndHold(itemAbs.x() + item->width() / 2, itemAbs.y() + item->height() / 2, delay);
-}
-
 void QuickEnginePlatform::clearFocus()
 {
     qCDebug(categoryQuickEnginePlatform)
@@ -339,9 +426,8 @@ void QuickEnginePlatform::getPageSourceCommand(ITransportClient *socket)
         << Q_FUNC_INFO
         << socket;
 
-    // TODO
-
-    socketReply(socket, QString());
+    QAReplyStream out(socket);
+    pageSource(&out);
 }
 
 void QuickEnginePlatform::onKeyEvent(QKeyEvent *event)
@@ -356,8 +442,7 @@ void QuickEnginePlatform::executeCommand_touch_pressAndHold(ITransportClient *so
         << Q_FUNC_INFO
         << socket << posx << posy;
 
-    pressAndHold(posx, posy);
-    socketReply(socket, QString());
+    replyWhenCompleted(socket, startPressAndHold(QPoint(posx, posy)));
 }
 
 void QuickEnginePlatform::executeCommand_touch_mouseSwipe(ITransportClient *socket, double posx, double posy, double stopx, double stopy)
@@ -366,8 +451,7 @@ void QuickEnginePlatform::executeCommand_touch_mouseSwipe(ITransportClient *sock
         << Q_FUNC_INFO
         << socket << posx << posy << stopx << stopy;
 
-    mouseMove(posx, posy, stopx, stopy);
-    socketReply(socket, QString());
+    replyWhenCompleted(socket, startMouseMove(QPoint(posx, posy), QPoint(stopx, stopy)));
 }
 
 void QuickEnginePlatform::executeCommand_touch_mouseDrag(ITransportClient *socket, double posx, double posy, double stopx, double stopy)
@@ -376,8 +460,7 @@ void QuickEnginePlatform::executeCommand_touch_mouseDrag(ITransportClient *socke
         << Q_FUNC_INFO
         << socket << posx << posy << stopx << stopy;
 
-    mouseDrag(posx, posy, stopx, stopy);
-    socketReply(socket, QString());
+    replyWhenCompleted(socket, startMouseDrag(QPoint(posx, posy), QPoint(stopx, stopy)));
 }
 
 void QuickEnginePlatform::executeCommand_app_method(ITransportClient *socket, const QString &elementId, const QString &method, const QVariantList &params)
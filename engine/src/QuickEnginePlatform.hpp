@@ -28,6 +28,10 @@ public slots:
 
 protected:
     QList<QObject*> childrenList(QObject *parentItem) override;
+    void collectTreeChanges() override;
+    GeometryContext geometryContext(QObject *item) override;
+    GeometryContext childGeometryContext(QObject *child, const GeometryContext &parent) override;
+    qreal getZ(QObject *item) override;
 
     QQuickItem *findParentFlickable(QQuickItem *rootItem = nullptr);
     QVariantList findNestedFlickable(QQuickItem *parentItem = nullptr);
@@ -37,7 +41,6 @@ protected:
 
     void grabScreenshot(ITransportClient *socket, QObject *item, bool fillBackground = false) override;
 
-    void pressAndHoldItem(QObject *qitem, int delay = 800) override;
     void clearFocus();
     void clearComponentCache();
 
@@ -46,7 +49,13 @@ protected:
     QQuickItem *m_rootQuickItem = nullptr;
     QQuickWindow *m_rootQuickWindow = nullptr;
 
+private:
+    // dirty items seen since the last frame, the list is kept until the frame is synchronized
+    QObjectList m_lastDirtyItems;
+
 private slots:
+    void onAfterAnimating();
+
     // IEnginePlatform interface
     virtual void getPageSourceCommand(ITransportClient *socket) override;
 
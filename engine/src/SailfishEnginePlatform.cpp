@@ -1,5 +1,6 @@
 // Copyright (c) 2019-2020 Open Mobile Platform LLC.
 #include "SailfishEnginePlatform.hpp"
+#include "QAReplyStream.hpp"
 
 #include <QDBusConnection>
 #include <QDBusMessage>
@@ -32,6 +33,9 @@ Q_LOGGING_CATEGORY(categorySailfishEnginePlatform, "omp.qaengine.platform.sailfi
 
 namespace {
 
+// pulley menus are opened once their flickable has reached the boundary
+const int c_scrollTimeout = 5000;
+
 bool checkIsDeclarativeCache()
 {
     return QFileInfo(qApp->arguments().first()).baseName().startsWith(QLatin1String("mdeclarativecache"));
@@ -151,348 +155,283 @@ void SailfishEnginePlatform::bridgeStatusChanged(const QString &interface, const
     }
 }
 
-void SailfishEnginePlatform::pullDownTo(const QString &text)
+QQuickItem *SailfishEnginePlatform::findMenuColumn(QQuickItem *page, const QString &menuClassName)
 {
-    qCDebug(categorySailfishEnginePlatform)
-        << Q_FUNC_INFO
-        << text;
-
-    QQuickItem *page = getCurrentPage();
-
-    QObjectList flickables = findItemsByProperty(QStringLiteral("flickableDirection"), 2, page);
-    if (flickables.isEmpty()) {
-        return;
-    }
-    QQuickItem *flickable = qobject_cast<QQuickItem*>(flickables.first());
-    bool atYBeginning = flickable->property("atYBeginning").toBool();
-    if (!atYBeginning) {
-        QMetaObject::invokeMethod(flickable, "scrollToTop", Qt::DirectConnection);
-        while (!atYBeginning) {
-            QEventLoop loop;
-#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
-            connect(flickable, SIGNAL(atYBeginningChanged()), &loop, SLOT(quit()));
-#else
-            connect(flickable, SIGNAL(isAtBoundaryChanged()), &loop, SLOT(quit()));
-#endif
-            loop.exec();
-            atYBeginning = flickable->property("atYBeginning").toBool();
-        }
-    }
-
-    QObjectList pullDownMenus = findItemsByClassName(QStringLiteral("PullDownMenu"), page);
-    pullDownMenus = filterVisibleItems(pullDownMenus);
-    if (pullDownMenus.isEmpty()) {
-        return;
+    QObjectList menus = findItemsByClassName(menuClassName, page);
+    menus = filterVisibleItems(menus);
+    if (menus.isEmpty()) {
+        return nullptr;
     }
-    QQuickItem *pullDownMenu = qobject_cast<QQuickItem*>(pullDownMenus.first());
-    QObjectList columns = findItemsByClassName(QStringLiteral("QQuickColumn"), pullDownMenu);
+    QQuickItem *menu = qobject_cast<QQuickItem*>(menus.first());
+    QObjectList columns = findItemsByClassName(QStringLiteral("QQuickColumn"), menu, 1);
     if (columns.isEmpty()) {
-        return;
-    }
-    QQuickItem *column = qobject_cast<QQuickItem*>(columns.first());
-    QObjectList items = findItemsByText(text, false, column);
-    if (items.isEmpty() || items.count() > 1) {
-        return;
+        return nullptr;
     }
-    QQuickItem *item = qobject_cast<QQuickItem*>(items.first());
-    const QPointF itemAbs = getAbsPosition(item);
-
-    const int dragX = page->width() / 2;
-    const int dragY = page->height() / 2;
-    const int dragYEnd = dragY - itemAbs.y() + item->height();
-
-    mouseMove(dragX, dragY, dragX, dragYEnd);
+    return qobject_cast<QQuickItem*>(columns.first());
 }
 
-void SailfishEnginePlatform::pullDownTo(int index)
+bool SailfishEnginePlatform::scrollPage(QQuickItem *page, bool toEnd, const std::function<void()> &done)
 {
     qCDebug(categorySailfishEnginePlatform)
         << Q_FUNC_INFO
-        << index;
-
-    QQuickItem *page = getCurrentPage();
+        << page << toEnd;
 
-    QObjectList flickables = findItemsByProperty(QStringLiteral("flickableDirection"), 2, page);
+    QObjectList flickables = findItemsByProperty(QStringLiteral("flickableDirection"), 2, page, 1);
     if (flickables.isEmpty()) {
-        return;
+        return false;
     }
     QQuickItem *flickable = qobject_cast<QQuickItem*>(flickables.first());
-    bool atYBeginning = flickable->property("atYBeginning").toBool();
-    if (!atYBeginning) {
-        QMetaObject::invokeMethod(flickable, "scrollToTop", Qt::DirectConnection);
-        while (!atYBeginning) {
-            QEventLoop loop;
-#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
-            connect(flickable, SIGNAL(atYBeginningChanged()), &loop, SLOT(quit()));
-#else
-            connect(flickable, SIGNAL(isAtBoundaryChanged()), &loop, SLOT(quit()));
-#endif
-            loop.exec();
-            atYBeginning = flickable->property("atYBeginning").toBool();
-        }
+    const QString boundary = toEnd ? QStringLiteral("atYEnd") : QStringLiteral("atYBeginning");
+    if (!flickable->property(boundary.toLatin1().constData()).toBool()) {
+        QMetaObject::invokeMethod(flickable, toEnd ? "scrollToBottom" : "scrollToTop", Qt::DirectConnection);
     }
+    waitForPropertyChange(flickable, boundary, true, c_scrollTimeout, done);
+    return true;
+}
 
-    QObjectList pullDownMenus = findItemsByClassName(QStringLiteral("PullDownMenu"), page);
-    pullDownMenus = filterVisibleItems(pullDownMenus);
-    if (pullDownMenus.isEmpty()) {
-        return;
-    }
-    QQuickItem *pullDownMenu = qobject_cast<QQuickItem*>(pullDownMenus.first());
-    QObjectList columns = findItemsByClassName(QStringLiteral("QQuickColumn"), pullDownMenu);
-    if (columns.isEmpty()) {
-        return;
-    }
-    QQuickItem *column = qobject_cast<QQuickItem*>(columns.first());
-    QObjectList items = findItemsByClassName(QStringLiteral("MenuItem"), column);
-    if (items.isEmpty() || items.count() < (index + 1)) {
-        return;
-    }
-    QQuickItem *item = qobject_cast<QQuickItem*>(items.at(index));
-    const QPointF itemAbs = getAbsPosition(item);
-
-    const int dragX = page->width() / 2;
-    const int dragY = page->height() / 2;
-    const int dragYEnd = dragY - itemAbs.y() + item->height();
+void SailfishEnginePlatform::pullDownTo(const QString &text, const std::function<void()> &done)
+{
+    qCDebug(categorySailfishEnginePlatform)
+        << Q_FUNC_INFO
+        << text;
 
-    mouseMove(dragX, dragY, dragX, dragYEnd);
+    pullDownToMenuItem([this, text](QQuickItem *column) {
+        QObjectList items = findItemsByText(text, false, column);
+        return items.count() == 1 ? qobject_cast<QQuickItem*>(items.first()) : nullptr;
+    }, done);
 }
 
-void SailfishEnginePlatform::pushUpTo(const QString &text)
+void SailfishEnginePlatform::pullDownTo(int index, const std::function<void()> &done)
 {
     qCDebug(categorySailfishEnginePlatform)
         << Q_FUNC_INFO
-        << text;
+        << index;
 
-    QQuickItem *page = getCurrentPage();
+    pullDownToMenuItem([this, index](QQuickItem *column) {
+        QObjectList items = findItemsByClassName(QStringLiteral("MenuItem"), column);
+        return index >= 0 && index < items.count() ? qobject_cast<QQuickItem*>(items.at(index)) : nullptr;
+    }, done);
+}
 
-    QObjectList flickables = findItemsByProperty(QStringLiteral("flickableDirection"), 2, page);
-    if (flickables.isEmpty()) {
-        return;
-    }
-    QQuickItem *flickable = qobject_cast<QQuickItem*>(flickables.first());
-    bool atYEnd = flickable->property("atYEnd").toBool();
-    if (!atYEnd) {
-        QMetaObject::invokeMethod(flickable, "scrollToBottom", Qt::DirectConnection);
-        while (!atYEnd) {
-            QEventLoop loop;
-#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
-            connect(flickable, SIGNAL(atYEndChanged()), &loop, SLOT(quit()));
-#else
-            connect(flickable, SIGNAL(isAtBoundaryChanged()), &loop, SLOT(quit()));
-#endif
-            loop.exec();
-            atYEnd = flickable->property("atYEnd").toBool();
+void SailfishEnginePlatform::pullDownToMenuItem(const std::function<QQuickItem*(QQuickItem*)> &findMenuItem, const std::function<void()> &done)
+{
+    QPointer<QQuickItem> page(getCurrentPage());
+    const bool scrolled = scrollPage(page, false, [this, page, findMenuItem, done]() {
+        QQuickItem *column = page ? findMenuColumn(page, QStringLiteral("PullDownMenu")) : nullptr;
+        QQuickItem *item = column ? findMenuItem(column) : nullptr;
+        if (!item) {
+            done();
+            return;
         }
-    }
+        const QPointF itemAbs = getAbsPosition(item);
 
-    QObjectList pushUpMenus = findItemsByClassName(QStringLiteral("PushUpMenu"), page);
-    pushUpMenus = filterVisibleItems(pushUpMenus);
-    if (pushUpMenus.isEmpty()) {
-        return;
-    }
-    QQuickItem *pushUpMenu = qobject_cast<QQuickItem*>(pushUpMenus.first());
-    QObjectList columns = findItemsByClassName(QStringLiteral("QQuickColumn"), pushUpMenu);
-    if (columns.isEmpty()) {
-        return;
-    }
-    QQuickItem *column = qobject_cast<QQuickItem*>(columns.first());
-    QObjectList items = findItemsByText(text, false, column);
-    if (items.isEmpty() || items.count() > 1) {
-        return;
+        const int dragX = page->width() / 2;
+        const int dragY = page->height() / 2;
+        const int dragYEnd = dragY - itemAbs.y() + item->height();
+
+        whenCompleted(startMouseMove(QPoint(dragX, dragY), QPoint(dragX, dragYEnd)), done);
+    });
+    if (!scrolled) {
+        done();
     }
-    QQuickItem *item = qobject_cast<QQuickItem*>(items.first());
-    const QPointF itemAbs = getAbsPosition(item);
+}
 
-    const int dragX = page->width() / 2;
-    const int dragY = page->height() / 2;
-    const int dragYEnd = dragY - (itemAbs.y() - page->height() + item->height() + 100);
+void SailfishEnginePlatform::pushUpTo(const QString &text, const std::function<void()> &done)
+{
+    qCDebug(categorySailfishEnginePlatform)
+        << Q_FUNC_INFO
+        << text;
 
-    mouseMove(dragX, dragY, dragX, dragYEnd);
+    pushUpToMenuItem([this, text](QQuickItem *column) {
+        QObjectList items = findItemsByText(text, false, column);
+        return items.count() == 1 ? qobject_cast<QQuickItem*>(items.first()) : nullptr;
+    }, done);
 }
 
-void SailfishEnginePlatform::pushUpTo(int index)
+void SailfishEnginePlatform::pushUpTo(int index, const std::function<void()> &done)
 {
     qCDebug(categorySailfishEnginePlatform)
         << Q_FUNC_INFO
         << index;
 
-    QQuickItem *page = getCurrentPage();
+    pushUpToMenuItem([this, index](QQuickItem *column) {
+        QObjectList items = findItemsByClassName(QStringLiteral("MenuItem"), column);
+        return index >= 0 && index < items.count() ? qobject_cast<QQuickItem*>(items.at(index)) : nullptr;
+    }, done);
+}
 
-    QObjectList flickables = findItemsByProperty(QStringLiteral("flickableDirection"), 2, page);
-    if (flickables.isEmpty()) {
-        return;
-    }
-    QQuickItem *flickable = qobject_cast<QQuickItem*>(flickables.first());
-    bool atYEnd = flickable->property("atYEnd").toBool();
-    if (!atYEnd) {
-        QMetaObject::invokeMethod(flickable, "scrollToBottom", Qt::DirectConnection);
-        while (!atYEnd) {
-            QEventLoop loop;
-#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
-            connect(flickable, SIGNAL(atYEndChanged()), &loop, SLOT(quit()));
-#else
-            connect(flickable, SIGNAL(isAtBoundaryChanged()), &loop, SLOT(quit()));
-#endif
-            loop.exec();
-            atYEnd = flickable->property("atYEnd").toBool();
+void SailfishEnginePlatform::pushUpToMenuItem(const std::function<QQuickItem*(QQuickItem*)> &findMenuItem, const std::function<void()> &done)
+{
+    QPointer<QQuickItem> page(getCurrentPage());
+    const bool scrolled = scrollPage(page, true, [this, page, findMenuItem, done]() {
+        QQuickItem *column = page ? findMenuColumn(page, QStringLiteral("PushUpMenu")) : nullptr;
+        QQuickItem *item = column ? findMenuItem(column) : nullptr;
+        if (!item) {
+            done();
+            return;
         }
-    }
-
-    QObjectList pushUpMenus = findItemsByClassName(QStringLiteral("PushUpMenu"), page);
-    pushUpMenus = filterVisibleItems(pushUpMenus);
-    if (pushUpMenus.isEmpty()) {
-        return;
-    }
-    QQuickItem *pushUpMenu = qobject_cast<QQuickItem*>(pushUpMenus.first());
-    QObjectList columns = findItemsByClassName(QStringLiteral("QQuickColumn"), pushUpMenu);
-    if (columns.isEmpty()) {
-        return;
-    }
-    QQuickItem *column = qobject_cast<QQuickItem*>(columns.first());
-    QObjectList items = findItemsByClassName(QStringLiteral("MenuItem"), column);
-    if (items.isEmpty() || items.count() < (index + 1)) {
-        return;
-    }
-    QQuickItem *item = qobject_cast<QQuickItem*>(items.at(index));
-    const QPointF itemAbs = getAbsPosition(item);
+        const QPointF itemAbs = getAbsPosition(item);
 
-    const int dragX = page->width() / 2;
-    const int dragY = page->height() / 2;
-    const int dragYEnd = dragY - (itemAbs.y() - page->height() + item->height() + 100);
+        const int dragX = page->width() / 2;
+        const int dragY = page->height() / 2;
+        const int dragYEnd = dragY - (itemAbs.y() - page->height() + item->height() + 100);
 
-    mouseMove(dragX, dragY, dragX, dragYEnd);
+        whenCompleted(startMouseMove(QPoint(dragX, dragY), QPoint(dragX, dragYEnd)), done);
+    });
+    if (!scrolled) {
+        done();
+    }
 }
 
-void SailfishEnginePlatform::scrollToItem(QQuickItem *item)
+void SailfishEnginePlatform::scrollToItem(QQuickItem *item, const std::function<void()> &done)
 {
     qCDebug(categorySailfishEnginePlatform)
         << Q_FUNC_INFO
         << item;
 
-    if (!item) {
-        return;
-    }
-    QQuickItem *flickable = findParentFlickable(item);
-    if (!flickable) {
+    if (!item || !findParentFlickable(item)) {
+        done();
         return;
     }
     QQuickItem *rootItem = getApplicationWindow();
-    QPointF itemAbs = getAbsPosition(item);
+    const QPointF itemAbs = getAbsPosition(item);
 
-    while (itemAbs.y() < 0) {
-        mouseMove(rootItem->width() / 2, rootItem->height() * 0.05, rootItem->width() / 2, rootItem->height() * 0.95);
-        itemAbs = getAbsPosition(item);
-    }
-    while (itemAbs.y() + item->height() > rootItem->height()) {
-        mouseMove(rootItem->width() / 2, rootItem->height() * 0.95, rootItem->width() / 2, rootItem->height() * 0.05);
-        itemAbs = getAbsPosition(item);
+    const int dragX = rootItem->width() / 2;
+    const int top = rootItem->height() * 0.05;
+    const int bottom = rootItem->height() * 0.95;
+    QAPendingEvent *event = nullptr;
+    if (itemAbs.y() < 0) {
+        event = startMouseMove(QPoint(dragX, top), QPoint(dragX, bottom));
+    } else if (itemAbs.y() + item->height() > rootItem->height()) {
+        event = startMouseMove(QPoint(dragX, bottom), QPoint(dragX, top));
+    } else {
+        done();
+        return;
     }
+
+    // one swipe at a time until the item is in view
+    QPointer<QQuickItem> guard(item);
+    whenCompleted(event, [this, guard, done]() {
+        scrollToItem(guard, done);
+    });
 }
 
-QObjectList SailfishEnginePlatform::openContextMenu(QQuickItem *item)
+void SailfishEnginePlatform::openContextMenu(QQuickItem *item, const std::function<void(const QObjectList &)> &done)
 {
     qCDebug(categorySailfishEnginePlatform)
         << Q_FUNC_INFO
         << item;
 
     if (!item) {
-        return QObjectList();
+        done(QObjectList());
+        return;
     }
-    pressAndHoldItem(item, 1200);
-    return findItemsByClassName(QStringLiteral("MenuItem"), item);
+    QPointer<QQuickItem> guard(item);
+    whenCompleted(startPressAndHoldItem(item, 1200), [this, guard, done]() {
+        done(guard ? findItemsByClassName(QStringLiteral("MenuItem"), guard) : QObjectList());
+    });
 }
 
-void SailfishEnginePlatform::clickContextMenuItem(QQuickItem *item, const QString &text, bool partial)
+void SailfishEnginePlatform::clickContextMenuItem(QQuickItem *item, const QString &text, bool partial, const std::function<void()> &done)
 {
     qCDebug(categorySailfishEnginePlatform)
         << Q_FUNC_INFO
         << item << text << partial;
 
-    QObjectList contextMenuItems = openContextMenu(item);
-    for (QObject *o : contextMenuItems) {
-        QQuickItem *item = qobject_cast<QQuickItem*>(o);
-        if ((partial && getText(item).contains(text)) || (!partial && getText(item) == text)) {
-            clickItem(item);
-            return;
+    openContextMenu(item, [this, text, partial, done](const QObjectList &contextMenuItems) {
+        for (QObject *o : contextMenuItems) {
+            QQuickItem *item = qobject_cast<QQuickItem*>(o);
+            if ((partial && getText(item).contains(text)) || (!partial && getText(item) == text)) {
+                whenCompleted(startClickItem(item), done);
+                return;
+            }
         }
-    }
+        done();
+    });
 }
 
-void SailfishEnginePlatform::clickContextMenuItem(QQuickItem *item, int index)
+void SailfishEnginePlatform::clickContextMenuItem(QQuickItem *item, int index, const std::function<void()> &done)
 {
     qCDebug(categorySailfishEnginePlatform)
         << Q_FUNC_INFO
         << item << index;
 
-    QObjectList contextMenuItems = openContextMenu(item);
-    if (index < 0 || index >= contextMenuItems.count()) {
-        return;
-    }
-
-    clickItem(qobject_cast<QQuickItem*>(contextMenuItems.at(index)));
+    openContextMenu(item, [this, index, done](const QObjectList &contextMenuItems) {
+        if (index < 0 || index >= contextMenuItems.count()) {
+            done();
+            return;
+        }
+        whenCompleted(startClickItem(contextMenuItems.at(index)), done);
+    });
 }
 
-void SailfishEnginePlatform::waitForPageChange(int timeout)
+void SailfishEnginePlatform::waitForPageChange(int timeout, const std::function<void()> &done)
 {
     qCDebug(categorySailfishEnginePlatform)
         << Q_FUNC_INFO
         << timeout;
 
-    waitForPropertyChange(getPageStack(), QStringLiteral("currentPage"), QVariant(), timeout);
-    waitForPropertyChange(getPageStack(), QStringLiteral("busy"), false, timeout);
+    QPointer<QQuickItem> pageStack(getPageStack());
+    waitForPropertyChange(pageStack, QStringLiteral("currentPage"), QVariant(), timeout, [this, pageStack, timeout, done]() {
+        waitForPropertyChange(pageStack, QStringLiteral("busy"), false, timeout, done);
+    });
 }
 
-void SailfishEnginePlatform::swipe(SailfishEnginePlatform::SwipeDirection direction)
+void SailfishEnginePlatform::swipe(SailfishEnginePlatform::SwipeDirection direction, const std::function<void()> &done)
 {
     qCDebug(categorySailfishEnginePlatform)
         << Q_FUNC_INFO
         << direction;
 
     QRectF rootRect(0, 0, m_rootQuickItem->width(), m_rootQuickItem->height());
+    const QPoint center = rootRect.center().toPoint();
     switch (direction) {
     case SwipeDirectionUp:
-        mouseMove(rootRect.center().x(), rootRect.center().y(), rootRect.center().x(), 0);
+        whenCompleted(startMouseMove(center, QPoint(center.x(), 0)), done);
         break;
     case SwipeDirectionLeft:
-        mouseMove(rootRect.center().x(), rootRect.center().y(), 0, rootRect.center().y());
+        whenCompleted(startMouseMove(center, QPoint(0, center.y())), done);
         break;
     case SwipeDirectionRight:
-        mouseMove(rootRect.center().x(), rootRect.center().y(), rootRect.width(), rootRect.center().y());
+        whenCompleted(startMouseMove(center, QPoint(rootRect.width(), center.y())), done);
         break;
     case SwipeDirectionDown:
-        mouseMove(rootRect.center().x(), rootRect.center().y(), rootRect.center().x(), rootRect.height());
+        whenCompleted(startMouseMove(center, QPoint(center.x(), rootRect.height())), done);
         break;
     default:
+        done();
         break;
     }
 }
 
-void SailfishEnginePlatform::peek(SailfishEnginePlatform::PeekDirection direction)
+void SailfishEnginePlatform::peek(SailfishEnginePlatform::PeekDirection direction, const std::function<void()> &done)
 {
     qCDebug(categorySailfishEnginePlatform)
         << Q_FUNC_INFO
         << direction;
 
     QRectF rootRect(0, 0, m_rootQuickItem->width(), m_rootQuickItem->height());
+    const QPoint center = rootRect.center().toPoint();
     switch (direction) {
     case PeekDirectionUp:
-        mouseMove(rootRect.center().x(), rootRect.height(), rootRect.center().x(), 0);
+        whenCompleted(startMouseMove(QPoint(center.x(), rootRect.height()), QPoint(center.x(), 0)), done);
         break;
     case PeekDirectionLeft:
-        mouseMove(rootRect.width(), rootRect.center().y(), 0, rootRect.center().y());
+        whenCompleted(startMouseMove(QPoint(rootRect.width(), center.y()), QPoint(0, center.y())), done);
         break;
     case PeekDirectionRight:
-        mouseMove(0, rootRect.center().y(), rootRect.height(), rootRect.center().y());
+        whenCompleted(startMouseMove(QPoint(0, center.y()), QPoint(rootRect.height(), center.y())), done);
         break;
     case PeekDirectionDown:
-        mouseMove(rootRect.center().x(), 0, rootRect.center().x(), rootRect.height());
+        whenCompleted(startMouseMove(QPoint(center.x(), 0), QPoint(center.x(), rootRect.height())), done);
         break;
     default:
+        done();
         break;
     }
 }
 
-void SailfishEnginePlatform::enterCode(const QString &code)
+void SailfishEnginePlatform::enterCode(const QString &code, const std::function<void()> &done)
 {
     QQuickItem *keypadItem = nullptr;
     QObjectList keypads = findItemsByClassName(QStringLiteral("Keypad"));
@@ -504,34 +443,36 @@ void SailfishEnginePlatform::enterCode(const QString &code)
         }
     }
     if (!keypadItem) {
+        done();
         return;
     }
     QObjectList keypadButtons = findItemsByClassName(QStringLiteral("KeypadButton"), keypadItem);
+    QList<QPointer<QObject>> clicks;
     for (const QString &number : code) {
         for (QObject *kb : keypadButtons) {
-            QQuickItem *keypadItem = qobject_cast<QQuickItem*>(kb);
-            if (keypadItem->property("text").toString() == number) {
-                clickItem(keypadItem);
+            if (kb->property("text").toString() == number) {
+                clicks.append(kb);
             }
         }
     }
+    clickItems(clicks, done);
 }
 
-void SailfishEnginePlatform::goBack()
+QAPendingEvent *SailfishEnginePlatform::startGoBack()
 {
     qCDebug(categorySailfishEnginePlatform)
         << Q_FUNC_INFO;
 
-    clickPoint(10, 10);
+    return startClick(QPoint(10, 10));
 }
 
-void SailfishEnginePlatform::goForward()
+QAPendingEvent *SailfishEnginePlatform::startGoForward()
 {
     qCDebug(categorySailfishEnginePlatform)
         << Q_FUNC_INFO;
 
     QQuickItem *rootItem = getApplicationWindow();
-    clickPoint(rootItem->width() - 10, 10);
+    return startClick(QPoint(rootItem->width() - 10, 10));
 }
 
 void SailfishEnginePlatform::initialize()
@@ -556,6 +497,7 @@ void SailfishEnginePlatform::initialize()
             blacklisted.append(parts.last());
             m_blacklistedProperties.insert(parts.first(), blacklisted);
         }
+        m_propertySchemas.clear();
         qCDebug(categorySailfishEnginePlatform)
             << "Blacklist:"
             << m_blacklistedProperties;
@@ -692,8 +634,7 @@ void SailfishEnginePlatform::backCommand(ITransportClient *socket)
         << Q_FUNC_INFO
         << socket;
 
-    goBack();
-    socketReply(socket, QString());
+    replyWhenCompleted(socket, startGoBack());
 }
 
 void SailfishEnginePlatform::forwardCommand(ITransportClient *socket)
@@ -702,8 +643,7 @@ void SailfishEnginePlatform::forwardCommand(ITransportClient *socket)
         << Q_FUNC_INFO
         << socket;
 
-    goForward();
-    socketReply(socket, QString());
+    replyWhenCompleted(socket, startGoForward());
 }
 
 void SailfishEnginePlatform::getOrientationCommand(ITransportClient *socket)
@@ -813,8 +753,7 @@ void SailfishEnginePlatform::executeCommand_app_pullDownTo(ITransportClient *soc
         << Q_FUNC_INFO
         << socket << destination;
 
-    pullDownTo(destination);
-    socketReply(socket, QString());
+    pullDownTo(destination, replyWhenDone(socket));
 }
 
 void SailfishEnginePlatform::executeCommand_app_pullDownTo(ITransportClient *socket, double destination)
@@ -823,8 +762,7 @@ void SailfishEnginePlatform::executeCommand_app_pullDownTo(ITransportClient *soc
         << Q_FUNC_INFO
         << socket << destination;
 
-    pullDownTo(destination);
-    socketReply(socket, QString());
+    pullDownTo(destination, replyWhenDone(socket));
 }
 
 void SailfishEnginePlatform::executeCommand_app_pushUpTo(ITransportClient *socket, const QString &destination)
@@ -833,8 +771,7 @@ void SailfishEnginePlatform::executeCommand_app_pushUpTo(ITransportClient *socke
         << Q_FUNC_INFO
         << socket << destination;
 
-    pushUpTo(destination);
-    socketReply(socket, QString());
+    pushUpTo(destination, replyWhenDone(socket));
 }
 
 void SailfishEnginePlatform::executeCommand_app_pushUpTo(ITransportClient *socket, double destination)
@@ -843,8 +780,7 @@ void SailfishEnginePlatform::executeCommand_app_pushUpTo(ITransportClient *socke
         << Q_FUNC_INFO
         << socket << destination;
 
-    pushUpTo(destination);
-    socketReply(socket, QString());
+    pushUpTo(destination, replyWhenDone(socket));
 }
 
 void SailfishEnginePlatform::executeCommand_app_clickContextMenuItem(ITransportClient *socket, const QString &elementId, const QString &destination)
@@ -853,11 +789,7 @@ void SailfishEnginePlatform::executeCommand_app_clickContextMenuItem(ITransportC
         << Q_FUNC_INFO
         << socket << elementId << destination;
 
-    QQuickItem *item = getItem(elementId);
-    if (item) {
-        clickContextMenuItem(item, destination);
-    }
-    socketReply(socket, QString());
+    clickContextMenuItem(getItem(elementId), destination, true, replyWhenDone(socket));
 }
 
 void SailfishEnginePlatform::executeCommand_app_clickContextMenuItem(ITransportClient *socket, const QString &elementId, double destination)
@@ -866,11 +798,7 @@ void SailfishEnginePlatform::executeCommand_app_clickContextMenuItem(ITransportC
         << Q_FUNC_INFO
         << socket << elementId << destination;
 
-    QQuickItem *item = getItem(elementId);
-    if (item) {
-        clickContextMenuItem(item, destination);
-    }
-    socketReply(socket, QString());
+    clickContextMenuItem(getItem(elementId), destination, replyWhenDone(socket));
 }
 
 void SailfishEnginePlatform::executeCommand_app_waitForPageChange(ITransportClient *socket, double timeout)
@@ -879,8 +807,7 @@ void SailfishEnginePlatform::executeCommand_app_waitForPageChange(ITransportClie
         << Q_FUNC_INFO
         << socket << timeout;
 
-    waitForPageChange(timeout);
-    socketReply(socket, QString());
+    waitForPageChange(timeout, replyWhenDone(socket));
 }
 
 void SailfishEnginePlatform::executeCommand_app_swipe(ITransportClient *socket, const QString &directionString)
@@ -899,8 +826,7 @@ void SailfishEnginePlatform::executeCommand_app_swipe(ITransportClient *socket,
     } else if (directionString == QLatin1String("right")) {
         direction = SwipeDirectionRight;
     }
-    swipe(direction);
-    socketReply(socket, QString());
+    swipe(direction, replyWhenDone(socket));
 }
 
 void SailfishEnginePlatform::executeCommand_app_peek(ITransportClient *socket, const QString &directionString)
@@ -919,8 +845,7 @@ void SailfishEnginePlatform::executeCommand_app_peek(ITransportClient *socket, c
     } else if (directionString == QLatin1String("right")) {
         direction = PeekDirectionRight;
     }
-    peek(direction);
-    socketReply(socket, QString());
+    peek(direction, replyWhenDone(socket));
 }
 
 void SailfishEnginePlatform::executeCommand_app_goBack(ITransportClient *socket)
@@ -929,8 +854,7 @@ void SailfishEnginePlatform::executeCommand_app_goBack(ITransportClient *socket)
         << Q_FUNC_INFO
         << socket;
 
-    goBack();
-    socketReply(socket, QString());
+    replyWhenCompleted(socket, startGoBack());
 }
 
 void SailfishEnginePlatform::executeCommand_app_goForward(ITransportClient *socket)
@@ -939,8 +863,7 @@ void SailfishEnginePlatform::executeCommand_app_goForward(ITransportClient *sock
         << Q_FUNC_INFO
         << socket;
 
-    goForward();
-    socketReply(socket, QString());
+    replyWhenCompleted(socket, startGoForward());
 }
 
 void SailfishEnginePlatform::executeCommand_app_enterCode(ITransportClient *socket, const QString &code)
@@ -949,8 +872,7 @@ void SailfishEnginePlatform::executeCommand_app_enterCode(ITransportClient *sock
         << Q_FUNC_INFO
         << socket << code;
 
-    enterCode(code);
-    socketReply(socket, QString());
+    enterCode(code, replyWhenDone(socket));
 }
 
 void SailfishEnginePlatform::executeCommand_app_scrollToItem(ITransportClient *socket, const QString &elementId)
@@ -959,12 +881,7 @@ void SailfishEnginePlatform::executeCommand_app_scrollToItem(ITransportClient *s
         << Q_FUNC_INFO
         << socket << elementId;
 
-    QQuickItem *item = getItem(elementId);
-    if (item) {
-        scrollToItem(item);
-    }
-    socketReply(socket, QString());
-
+    scrollToItem(getItem(elementId), replyWhenDone(socket));
 }
 
 void SailfishEnginePlatform::executeCommand_app_saveScreenshot(ITransportClient *socket, const QString &fileName)
@@ -1007,8 +924,8 @@ void SailfishEnginePlatform::executeCommand_app_dumpCurrentPage(ITransportClient
         socketReply(socket, QString());
         return;
     }
-    QJsonObject reply = recursiveDumpTree(currentPage);
-    socketReply(socket, QJsonDocument(reply).toJson(QJsonDocument::Compact));
+    QAReplyStream out(socket);
+    recursiveDumpTree(&out, currentPage);
 }
 
 void SailfishEnginePlatform::executeCommand_app_dumpCover(ITransportClient *socket)
@@ -1021,9 +938,19 @@ void SailfishEnginePlatform::executeCommand_app_dumpCover(ITransportClient *sock
     if (!coverItem) {
         socketReply(socket, QString());
     } else {
-        QJsonObject reply = recursiveDumpTree(coverItem);
-        socketReply(socket, QJsonDocument(reply).toJson(QJsonDocument::Compact));
+        QAReplyStream out(socket);
+        recursiveDumpTree(&out, coverItem);
+    }
+}
+
+bool SailfishEnginePlatform::findInSnapshot(ITransportClient *socket, const QString &strategy, const QString &selector, bool multiple, QObject *parentItem)
+{
+    // cover and root items of other windows are not part of the snapshot
+    if (strategy == QLatin1String("classname")
+            && (selector == QLatin1String("DeclarativeCover") || selector == QLatin1String("QQuickRootItem"))) {
+        return false;
     }
+    return QuickEnginePlatform::findInSnapshot(socket, strategy, selector, multiple, parentItem);
 }
 
 void SailfishEnginePlatform::findStrategy_classname(ITransportClient *socket, const QString &selector, bool multiple, QObject *parentItem)
@@ -1040,7 +967,7 @@ void SailfishEnginePlatform::findStrategy_classname(ITransportClient *socket, co
             items.append(qw->contentItem());
         }
     } else {
-        items = findItemsByClassName(selector, parentItem);
+        items = findIndexedItems(QAObjectIndex::ClassNameKey, selector, parentItem, multiple ? -1 : 1);
     }
 
     qCDebug(categorySailfishEnginePlatform)
@@ -28,6 +28,9 @@ public:
 public slots:
     virtual void initialize() override;
 
+protected:
+    bool findInSnapshot(ITransportClient *socket, const QString &strategy, const QString &selector, bool multiple = false, QObject *parentItem = nullptr) override;
+
 private slots:
     // IEnginePlatform interface
     virtual void activateAppCommand(ITransportClient *socket, const QString &appName) override;
@@ -76,19 +79,25 @@ private:
     QQuickItem *getPageStack();
     QQuickItem *getCurrentPage();
 
-    void pullDownTo(const QString &text);
-    void pullDownTo(int index);
-    void pushUpTo(const QString &text);
-    void pushUpTo(int index);
-    void scrollToItem(QQuickItem *item);
-    QObjectList openContextMenu(QQuickItem *item);
-    void clickContextMenuItem(QQuickItem *item, const QString &text, bool partial = true);
-    void clickContextMenuItem(QQuickItem *item, int index);
-    void waitForPageChange(int timeout = 1000);
-    void swipe(SwipeDirection direction);
-    void peek(PeekDirection direction);
-    void enterCode(const QString &code);
-    void goBack();
-    void goForward();
+    // gestures call done once performed, or right away if there is nothing to do
+    QQuickItem *findMenuColumn(QQuickItem *page, const QString &menuClassName);
+    // false if the page has no flickable, done is not called then
+    bool scrollPage(QQuickItem *page, bool toEnd, const std::function<void()> &done);
+    void pullDownTo(const QString &text, const std::function<void()> &done);
+    void pullDownTo(int index, const std::function<void()> &done);
+    void pullDownToMenuItem(const std::function<QQuickItem*(QQuickItem*)> &findMenuItem, const std::function<void()> &done);
+    void pushUpTo(const QString &text, const std::function<void()> &done);
+    void pushUpTo(int index, const std::function<void()> &done);
+    void pushUpToMenuItem(const std::function<QQuickItem*(QQuickItem*)> &findMenuItem, const std::function<void()> &done);
+    void scrollToItem(QQuickItem *item, const std::function<void()> &done);
+    void openContextMenu(QQuickItem *item, const std::function<void(const QObjectList &)> &done);
+    void clickContextMenuItem(QQuickItem *item, const QString &text, bool partial, const std::function<void()> &done);
+    void clickContextMenuItem(QQuickItem *item, int index, const std::function<void()> &done);
+    void waitForPageChange(int timeout, const std::function<void()> &done);
+    void swipe(SwipeDirection direction, const std::function<void()> &done);
+    void peek(PeekDirection direction, const std::function<void()> &done);
+    void enterCode(const QString &code, const std::function<void()> &done);
+    QAPendingEvent *startGoBack();
+    QAPendingEvent *startGoForward();
 };
 
@@ -203,9 +203,12 @@ void WidgetsEnginePlatform::executeCommand_app_clickInView(ITransportClient *soc
 
     const QPoint itemPos = getAbsPosition(item);
     const QPoint indexCenter(rect.center().x() + itemPos.x(), rect.center().y() + itemPos.y());
-    clickPoint(indexCenter);
-
-    socketReply(socket, QStringList({QString::number(indexCenter.x()), QString::number(indexCenter.y())}));
+    QPointer<ITransportClient> client(socket);
+    whenCompleted(startClick(indexCenter), [this, client, indexCenter]() {
+        if (client) {
+            socketReply(client, QStringList({QString::number(indexCenter.x()), QString::number(indexCenter.y())}));
+        }
+    });
 }
 
 void WidgetsEnginePlatform::executeCommand_app_scrollInView(ITransportClient *socket, const QString &elementId, const QString &display)
@@ -651,25 +654,6 @@ void WidgetsEnginePlatform::grabScreenshot(ITransportClient *socket, QObject *it
     socketReply(socket, arr.toBase64());
 }
 
-void WidgetsEnginePlatform::pressAndHoldItem(QObject *qitem, int delay)
-{
-    qCDebug(categoryWidgetsEnginePlatform)
-        << Q_FUNC_INFO
-        << qitem << delay;
-
-    if (!qitem) {
-        return;
-    }
-
-    QWidget *item = qobject_cast<QWidget*>(qitem);
-    if (!item) {
-        return;
-    }
-
-    const QPointF itemAbs = getAbsPosition(item);
-    pressAndHold(itemAbs.x() + item->width() / 2, itemAbs.y() + item->height() / 2, delay);
-}
-
 EventHandler::EventHandler(QObject *parent)
     : QObject(parent)
 {
@@ -33,8 +33,6 @@ protected:
 
     void grabScreenshot(ITransportClient *socket, QObject *item, bool fillBackground = false) override;
 
-    void pressAndHoldItem(QObject *qitem, int delay = 800) override;
-
     QHash<QObject*, QWidget*> m_rootWidgets;
     QWidget *m_rootWidget = nullptr;
 
@@ -4,7 +4,8 @@ TEMPLATE = subdirs
 SUBDIRS = \
     hook \
     engine \
-    bridge
+    bridge \
+    tests
 
 contains(DEFINES, Q_OS_SAILFISH) {
     message("Building for SFOS")
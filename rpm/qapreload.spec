@@ -16,6 +16,7 @@ BuildRequires:  pkgconfig(Qt5DBus)
 BuildRequires:  pkgconfig(Qt5Qml)
 BuildRequires:  pkgconfig(Qt5Quick)
 BuildRequires:  pkgconfig(Qt5Network)
+BuildRequires:  pkgconfig(Qt5Test)
 BuildRequires:  pkgconfig(Qt5Xml)
 BuildRequires:  pkgconfig(Qt5XmlPatterns)
 BuildRequires:  pkgconfig(systemd)
@@ -25,6 +26,7 @@ BuildRequires:  pkgconfig(contentaction5)
 BuildRequires:  pkgconfig(connman-qt5)
 BuildRequires:  pkgconfig(mlite5)
 BuildRequires:  pkgconfig(rpm)
+BuildRequires:  pkgconfig(zlib)
 BuildRequires:  qt5-tools
 BuildRequires:  qt5-qtdeclarative-devel-tools
 BuildRequires:  qt5-plugin-platform-minimal
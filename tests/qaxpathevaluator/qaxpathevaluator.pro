@@ -0,0 +1,16 @@
+# Copyright (c) 2019-2020 Open Mobile Platform LLC.
+TARGET = tst_qaxpathevaluator
+QT = core testlib xmlpatterns
+CONFIG += testcase
+CONFIG += console
+CONFIG += c++11
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../../engine/src
+
+SOURCES += \
+    ../../engine/src/QAXPathEvaluator.cpp \
+    tst_qaxpathevaluator.cpp
+
+HEADERS += \
+    ../../engine/src/QAXPathEvaluator.hpp
@@ -0,0 +1,389 @@
+// Copyright (c) 2019-2020 Open Mobile Platform LLC.
+#include "QAXPathEvaluator.hpp"
+
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QScopedPointer>
+#include <QStringList>
+#include <QXmlQuery>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+#include <QtTest>
+
+namespace {
+
+typedef QList<QPair<QString, QString>> Properties;
+
+struct TestItem
+{
+    QString id;
+    QString className;
+    QString text;
+    Properties properties;
+};
+
+// Object tree exposed both to QAXPathEvaluator and as the xml dump
+// GenericEnginePlatform::recursiveDumpXml would write for it
+class TestModel : public QAXPathEvaluator::Model
+{
+public:
+    QObject *add(QObject *parentItem, const QString &className, const QString &text, const Properties &properties)
+    {
+        QObject *item = new QObject(parentItem);
+        TestItem info;
+        info.id = QStringLiteral("item%1").arg(m_items.size() + 1);
+        info.className = className;
+        info.text = text;
+        info.properties = properties;
+        m_items.insert(item, info);
+        return item;
+    }
+
+    QObjectList children(QObject *item) override
+    {
+        return item->children();
+    }
+
+    QObject *parent(QObject *item) override
+    {
+        return item->parent();
+    }
+
+    QString name(QObject *item) override
+    {
+        return m_items.value(item).className;
+    }
+
+    QString text(QObject *item) override
+    {
+        return m_items.value(item).text;
+    }
+
+    bool attribute(QObject *item, const QString &name, QString *value) override
+    {
+        const TestItem info = m_items.value(item);
+        if (name == QLatin1String("id")) {
+            *value = info.id;
+            return true;
+        }
+        if (name == QLatin1String("mainTextProperty")) {
+            *value = info.text;
+            return true;
+        }
+        for (const QPair<QString, QString> &property : info.properties) {
+            if (property.first == name) {
+                *value = property.second;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    QString id(QObject *item) const
+    {
+        return m_items.value(item).id;
+    }
+
+    // Written without auto formatting: the evaluator has no whitespace
+    // text nodes, indentation would only change text() and node() results
+    QString dumpXml(QObject *root) const
+    {
+        QString out;
+        QXmlStreamWriter writer(&out);
+        writer.writeStartDocument();
+        dumpXml(&writer, root, 0);
+        writer.writeEndDocument();
+        return out;
+    }
+
+private:
+    void dumpXml(QXmlStreamWriter *writer, QObject *item, int depth) const
+    {
+        const TestItem info = m_items.value(item);
+        writer->writeStartElement(info.className);
+        writer->writeAttribute(QStringLiteral("id"), info.id);
+        for (const QPair<QString, QString> &property : info.properties) {
+            writer->writeAttribute(property.first, property.second);
+        }
+        writer->writeAttribute(QStringLiteral("zDepth"), QString::number(depth));
+        writer->writeAttribute(QStringLiteral("mainTextProperty"), info.text);
+        if (!info.text.isEmpty()) {
+            writer->writeCharacters(info.text);
+        }
+
+        int z = 0;
+        for (QObject *child : item->children()) {
+            dumpXml(writer, child, ++z);
+        }
+
+        writer->writeEndElement();
+    }
+
+    QHash<QObject*, TestItem> m_items;
+};
+
+Properties textProperties(const QString &text, const QString &width)
+{
+    return { {QStringLiteral("text"), text}, {QStringLiteral("width"), width} };
+}
+
+} // namespace
+
+class tst_QAXPathEvaluator : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void compareWithXmlQuery_data();
+    void compareWithXmlQuery();
+    void limit();
+    void unsupportedQuery_data();
+    void unsupportedQuery();
+
+private:
+    QStringList xmlQueryIds(const QString &xpath, bool *valid) const;
+    QStringList ids(const QObjectList &items) const;
+
+    TestModel m_model;
+    QScopedPointer<QObject> m_root;
+    QString m_xml;
+};
+
+void tst_QAXPathEvaluator::initTestCase()
+{
+    QObject *window = m_model.add(nullptr, QStringLiteral("Window"), QString(),
+                                  { {QStringLiteral("title"), QStringLiteral("Main")} });
+    m_root.reset(window);
+
+    QObject *mainPage = m_model.add(window, QStringLiteral("Page"), QString(),
+                                    { {QStringLiteral("objectName"), QStringLiteral("mainPage")},
+                                      {QStringLiteral("visible"), QStringLiteral("true")} });
+
+    QObject *column = m_model.add(mainPage, QStringLiteral("Column"), QString(),
+                                  { {QStringLiteral("spacing"), QStringLiteral("8")} });
+    m_model.add(column, QStringLiteral("Label"), QStringLiteral("Hello world"),
+                textProperties(QStringLiteral("Hello world"), QStringLiteral("100")));
+    m_model.add(column, QStringLiteral("Label"), QStringLiteral("  Second   label "),
+                textProperties(QStringLiteral("  Second   label "), QStringLiteral("120")));
+    m_model.add(column, QStringLiteral("Button"), QStringLiteral("OK"),
+                textProperties(QStringLiteral("OK"), QStringLiteral("80"))
+                << qMakePair(QStringLiteral("enabled"), QStringLiteral("true")));
+    m_model.add(column, QStringLiteral("Button"), QStringLiteral("Cancel"),
+                textProperties(QStringLiteral("Cancel"), QStringLiteral("80"))
+                << qMakePair(QStringLiteral("enabled"), QStringLiteral("false")));
+
+    QObject *row = m_model.add(mainPage, QStringLiteral("Row"), QString(), Properties());
+    m_model.add(row, QStringLiteral("TextField"), QString(),
+                textProperties(QString(), QStringLiteral("200"))
+                << qMakePair(QStringLiteral("placeholderText"), QStringLiteral("Search")));
+    m_model.add(row, QStringLiteral("Label"), QStringLiteral("Status: ready"),
+                textProperties(QStringLiteral("Status: ready"), QStringLiteral("150")));
+
+    QObject *settingsPage = m_model.add(window, QStringLiteral("Page"), QString(),
+                                        { {QStringLiteral("objectName"), QStringLiteral("settingsPage")},
+                                          {QStringLiteral("visible"), QStringLiteral("false")} });
+    m_model.add(settingsPage, QStringLiteral("Label"), QStringLiteral("Hidden"),
+                textProperties(QStringLiteral("Hidden"), QStringLiteral("60")));
+    m_model.add(settingsPage, QStringLiteral("Button"), QStringLiteral("Back"),
+                textProperties(QStringLiteral("Back"), QStringLiteral("80"))
+                << qMakePair(QStringLiteral("enabled"), QStringLiteral("true")));
+
+    m_xml = m_model.dumpXml(window);
+}
+
+void tst_QAXPathEvaluator::cleanupTestCase()
+{
+    m_root.reset();
+}
+
+void tst_QAXPathEvaluator::compareWithXmlQuery_data()
+{
+    QTest::addColumn<QString>("xpath");
+
+    const QStringList queries = {
+        // location paths and axes
+        QStringLiteral("/Window"),
+        QStringLiteral("Window"),
+        QStringLiteral("Page"),
+        QStringLiteral("./Window/Page"),
+        QStringLiteral("/Window/Page/Column/Label"),
+        QStringLiteral("//Label"),
+        QStringLiteral(".//Button"),
+        QStringLiteral("//Page//Label"),
+        QStringLiteral("//Slider"),
+        QStringLiteral("/Window/*"),
+        QStringLiteral("//*"),
+        QStringLiteral("//Column/child::Label"),
+        QStringLiteral("//Column/self::Column"),
+        QStringLiteral("//Row/node()"),
+        QStringLiteral("//Row/descendant::*"),
+        QStringLiteral("//Page/descendant-or-self::*"),
+        QStringLiteral("//Label/.."),
+        QStringLiteral("//Label/parent::Column"),
+        QStringLiteral("//Button/ancestor::Page"),
+        QStringLiteral("//Label/ancestor-or-self::*"),
+        QStringLiteral("//Button[1]/following-sibling::*"),
+        QStringLiteral("//Label/following-sibling::Button"),
+        QStringLiteral("//Button/preceding-sibling::Label"),
+        // positional predicates
+        QStringLiteral("//Label[1]"),
+        QStringLiteral("//Label[last()]"),
+        QStringLiteral("//Label[position() > 1]"),
+        QStringLiteral("//*[position() = 2]"),
+        QStringLiteral("//Page/*[last()]"),
+        QStringLiteral("//Page[2]//Button"),
+        QStringLiteral("//Label[@width][2]"),
+        // attributes, text() and zDepth
+        QStringLiteral("//*[@enabled]"),
+        QStringLiteral("//*[not(@enabled)]"),
+        QStringLiteral("//Button[@enabled='true']"),
+        QStringLiteral("//Button[not(@enabled='true')]"),
+        QStringLiteral("//*[@text != 'OK']"),
+        QStringLiteral("//*[@id='item5']"),
+        QStringLiteral("//*[@mainTextProperty='Back']"),
+        QStringLiteral("//*[@visible='false']//Button"),
+        QStringLiteral("//Page[@objectName='mainPage']//Label[2]"),
+        QStringLiteral("//Label[text()='Hello world']"),
+        QStringLiteral("//Label[. = 'Hidden']"),
+        QStringLiteral("//Column[contains(., 'OK')]"),
+        QStringLiteral("//*[@zDepth=2]"),
+        QStringLiteral("//Label[@zDepth=1]"),
+        QStringLiteral("/Window/Page[@zDepth=2]/*"),
+        // operators
+        QStringLiteral("//*[@width > 90]"),
+        QStringLiteral("//*[@width >= 80 and @width < 120]"),
+        QStringLiteral("//Button[@enabled='false' or @width <= 60]"),
+        QStringLiteral("//*[@spacing = 8]"),
+        QStringLiteral("//*[@width + 20 = 100]"),
+        QStringLiteral("//*[@width - 20 = 60]"),
+        QStringLiteral("//*[@width * 2 = 160]"),
+        QStringLiteral("//*[@width div 2 = 40]"),
+        QStringLiteral("//*[@width mod 3 = 1]"),
+        // functions
+        QStringLiteral("//*[count(Label) = 2]"),
+        QStringLiteral("//*[count(*) > 1]"),
+        QStringLiteral("/Window[count(//Button) = 3]"),
+        QStringLiteral("//*[true()]"),
+        QStringLiteral("//*[false()]"),
+        QStringLiteral("//*[boolean(@placeholderText)]"),
+        QStringLiteral("//*[string(@width) = '80']"),
+        QStringLiteral("//*[number(@width) = 100]"),
+        QStringLiteral("//*[string-length(@text) = 6]"),
+        QStringLiteral("//Label[normalize-space(text()) = 'Second label']"),
+        QStringLiteral("//Label[contains(text(), 'label')]"),
+        QStringLiteral("//*[starts-with(@placeholderText, 'Se')]"),
+        QStringLiteral("//*[ends-with(@text, 'ready')]"),
+        QStringLiteral("//*[matches(@text, '^S')]"),
+        QStringLiteral("//*[concat(@text, '!') = 'OK!']"),
+        QStringLiteral("//*[lower-case(@text) = 'ok']"),
+        QStringLiteral("//*[upper-case(name()) = 'LABEL']"),
+        QStringLiteral("//*[local-name() = 'Row']"),
+    };
+
+    for (const QString &xpath : queries) {
+        QTest::newRow(qPrintable(xpath)) << xpath;
+    }
+}
+
+void tst_QAXPathEvaluator::compareWithXmlQuery()
+{
+    QFETCH(QString, xpath);
+
+    QAXPathEvaluator evaluator;
+    QVERIFY2(evaluator.setQuery(xpath), qPrintable(evaluator.errorString()));
+
+    bool valid = false;
+    const QStringList expected = xmlQueryIds(xpath, &valid);
+    QVERIFY(valid);
+
+    QCOMPARE(ids(evaluator.evaluate(&m_model, m_root.data())), expected);
+}
+
+void tst_QAXPathEvaluator::limit()
+{
+    const QString xpath = QStringLiteral("//Label");
+
+    QAXPathEvaluator evaluator;
+    QVERIFY(evaluator.setQuery(xpath));
+
+    bool valid = false;
+    const QStringList expected = xmlQueryIds(xpath, &valid);
+    QVERIFY(valid);
+    QVERIFY(expected.size() > 2);
+
+    QCOMPARE(ids(evaluator.evaluate(&m_model, m_root.data(), 2)), expected.mid(0, 2));
+}
+
+void tst_QAXPathEvaluator::unsupportedQuery_data()
+{
+    QTest::addColumn<QString>("xpath");
+
+    QTest::newRow("union") << QStringLiteral("//Label | //Button");
+    QTest::newRow("filter expression") << QStringLiteral("(//Label)[1]");
+    QTest::newRow("attribute result") << QStringLiteral("//Label/@text");
+    QTest::newRow("text result") << QStringLiteral("//Label/text()");
+    QTest::newRow("unsupported axis") << QStringLiteral("//Column/following::Label");
+    QTest::newRow("unsupported function") << QStringLiteral("//*[translate(@text, 'O', 'o') = 'oK']");
+}
+
+void tst_QAXPathEvaluator::unsupportedQuery()
+{
+    QFETCH(QString, xpath);
+
+    QAXPathEvaluator evaluator;
+    QVERIFY(!evaluator.setQuery(xpath));
+    QVERIFY(!evaluator.isValid());
+    QVERIFY(!evaluator.errorString().isEmpty());
+}
+
+// Same evaluation GenericEnginePlatform::findItemsByXpath falls back to
+QStringList tst_QAXPathEvaluator::xmlQueryIds(const QString &xpath, bool *valid) const
+{
+    QStringList result;
+
+    QXmlQuery query;
+    query.setFocus(m_xml);
+    query.setQuery(xpath);
+
+    *valid = query.isValid();
+    if (!*valid) {
+        return result;
+    }
+
+    QString tempString;
+    query.evaluateTo(&tempString);
+
+    if (tempString.trimmed().isEmpty()) {
+        return result;
+    }
+
+    const QString resultData = QLatin1String("<results>") + tempString + QLatin1String("</results>");
+    QXmlStreamReader reader(resultData);
+    reader.readNextStartElement();
+    while (!reader.atEnd()) {
+        reader.readNext();
+        if (reader.isStartElement()) {
+            result.append(reader.attributes().value(QStringLiteral("id")).toString());
+            reader.skipCurrentElement();
+        }
+    }
+
+    return result;
+}
+
+QStringList tst_QAXPathEvaluator::ids(const QObjectList &items) const
+{
+    QStringList result;
+    for (QObject *item : items) {
+        result.append(m_model.id(item));
+    }
+    return result;
+}
+
+QTEST_GUILESS_MAIN(tst_QAXPathEvaluator)
+
+#include "tst_qaxpathevaluator.moc"
@@ -0,0 +1,5 @@
+# Copyright (c) 2019-2020 Open Mobile Platform LLC.
+TEMPLATE = subdirs
+
+SUBDIRS = \
+    qaxpathevaluator